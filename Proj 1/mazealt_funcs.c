@@ -0,0 +1,440 @@
+#include "mazesolve.h"
+#include <stdint.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Landmark (ALT) heuristics for A*
+//
+// A* with the Manhattan distance as heuristic expands nearly as many
+// tiles as BFS in winding mazes where the path to the end leads far
+// away from it. Landmarks give much better lower bounds: with the
+// distance d(L,x) from a landmark L to every tile x, the triangle
+// inequality gives |d(L,v) - d(L,t)| <= d(v,t) for any tiles v and t.
+// The largest such bound over several landmarks is an admissible and
+// consistent heuristic. Landmarks are chosen and their distances found
+// once per maze by mazealt_build() and saved in a file which later
+// runs map into memory rather than reading.
+////////////////////////////////////////////////////////////////////////////////
+
+static size_t mazealt_data_len(altfile_header_t *header)
+// Returns the bytes of header and distances for `header`.
+{
+    return sizeof(altfile_header_t) +
+        (size_t)header->count * header->rows * header->cols * header->elem_size;
+}
+
+static void mazealt_set(mazealt_t *alt, int k, long i, long d)
+// Stores distance d, or -1 for unreachable, for landmark k at tile
+// index i of the row-major distance arrays.
+{
+    long offset = (long)k * alt->header->rows * alt->header->cols + i;
+    if (alt->header->elem_size == sizeof(uint16_t)) {
+        ((uint16_t *)alt->dists)[offset] = (d < 0) ? UINT16_MAX : d;
+    } else {
+        ((uint32_t *)alt->dists)[offset] = (d < 0) ? UINT32_MAX : d;
+    }
+}
+
+static long mazealt_get(mazealt_t *alt, int k, long i)
+// Returns the distance of landmark k at tile index i or -1 if the
+// landmark cannot reach that tile.
+{
+    long offset = (long)k * alt->header->rows * alt->header->cols + i;
+    if (alt->header->elem_size == sizeof(uint16_t)) {
+        uint16_t d = ((uint16_t *)alt->dists)[offset];
+        return (d == UINT16_MAX) ? -1 : d;
+    }
+    uint32_t d = ((uint32_t *)alt->dists)[offset];
+    return (d == UINT32_MAX) ? -1 : (long)d;
+}
+
+mazealt_t *mazealt_build(maze_t *maze, int count)
+// Chooses up to `count` landmarks in `maze` and finds the distance
+// from each to every tile with the maze's movement. Landmarks are
+// picked one at a time as the reachable tile farthest from those
+// already chosen, starting with the tile farthest from START, which
+// spreads them around the edges of the maze where they give the best
+// bounds. Fewer landmarks are chosen if the tiles reachable from
+// START run out. Returns NULL if START is blocked or if the maze has
+// more tiles than maze_astar_path() can number.
+//
+// NOTES: Every landmark is reachable from START, so all distances
+// stored are at most twice the greatest distance from START to any
+// tile. That decides whether 16-bit distances suffice before any are
+// stored.
+{
+    if (maze_tile_blocked(maze, maze->start_row, maze->start_col) ||
+        !maze_astar_fits(maze)) {
+        return NULL;
+    }
+    count = (count < 1) ? 1 : (count > ALT_LANDMARKS_MAX) ? ALT_LANDMARKS_MAX : count;
+    mazegrid_t *grid = mazegrid_from_maze(maze, GRID_LAYOUT_ROWMAJOR);
+    int *dist = malloc(sizeof(int) * grid->ncells);
+    long ntiles = (long)maze->rows * maze->cols;
+    long *mindist = malloc(sizeof(long) * ntiles);
+
+    // The first landmark is the tile farthest from START
+    mazegrid_bfs(grid, maze->start_row, maze->start_col, dist);
+    long far = -1, far_dist = -1;
+    for (int i = 0; i < maze->rows; i++) {
+        for (int j = 0; j < maze->cols; j++) {
+            long d = dist[mazegrid_index(grid, i, j)];
+            mindist[(long)i * maze->cols + j] = (d < 0) ? -1 : LONG_MAX;
+            if (d > far_dist) {
+                far_dist = d;
+                far = (long)i * maze->cols + j;
+            }
+        }
+    }
+
+    altfile_header_t header;
+    memset(&header, 0, sizeof(header));
+    strcpy(header.magic, ALTFILE_MAGIC);
+    header.key = mazecache_maze_key(maze, 0);
+    header.rows = maze->rows;
+    header.cols = maze->cols;
+    header.movement = maze->movement;
+    header.count = count;
+    header.elem_size = (2 * far_dist < UINT16_MAX) ? sizeof(uint16_t) : sizeof(uint32_t);
+    mazealt_t *alt = malloc(sizeof(mazealt_t));
+    alt->data_len = mazealt_data_len(&header);
+    alt->header = malloc(alt->data_len);
+    *alt->header = header;
+    alt->dists = alt->header + 1;
+    alt->mapped = 0;
+
+    // Each landmark's BFS lowers the distance of tiles to their
+    // nearest landmark; the next landmark is the tile where it is
+    // greatest, stopping early if every reachable tile is a landmark
+    int k;
+    for (k = 0; k < count && far >= 0; k++) {
+        int row = far / maze->cols, col = far % maze->cols;
+        alt->header->landmarks[2 * k] = row;
+        alt->header->landmarks[2 * k + 1] = col;
+        mazegrid_bfs(grid, row, col, dist);
+        far = -1;
+        far_dist = 0;
+        for (int i = 0; i < maze->rows; i++) {
+            for (int j = 0; j < maze->cols; j++) {
+                long t = (long)i * maze->cols + j;
+                long d = dist[mazegrid_index(grid, i, j)];
+                mazealt_set(alt, k, t, d);
+                if (d >= 0 && d < mindist[t]) {
+                    mindist[t] = d;
+                }
+                if (mindist[t] > far_dist) {
+                    far_dist = mindist[t];
+                    far = t;
+                }
+            }
+        }
+    }
+    alt->header->count = k;
+    alt->data_len = mazealt_data_len(alt->header);
+    free(mindist);
+    free(dist);
+    mazegrid_free(grid);
+    if (LOG_LEVEL >= LOG_BFS_STEPS) {
+        printf("LOG: chose %d landmarks with %d-byte distances\n", k, alt->header->elem_size);
+    }
+    return alt;
+}
+
+int mazealt_write(mazealt_t *alt, char *fname)
+// Writes the header and distances of `alt` to the binary file
+// `fname` with a single fwrite(). Returns 1 on success and 0 if the
+// file could not be written.
+{
+    FILE *fout = fopen(fname, "wb");
+    if (fout == NULL) {
+        printf("ERROR: could not open file %s\n", fname);
+        return 0;
+    }
+    int ok = fwrite(alt->header, alt->data_len, 1, fout) == 1;
+    if (fclose(fout) != 0 || !ok) {
+        printf("ERROR: failed writing landmarks to %s\n", fname);
+        return 0;
+    }
+    return 1;
+}
+
+mazealt_t *mazealt_open(char *fname, int use_mmap)
+// Loads landmarks written by mazealt_write(). If `use_mmap` is 1 the
+// file is mapped read-only so only the pages of distances a search
+// looks at are read, otherwise the whole file is read into memory.
+// Returns NULL if the file cannot be opened or is not a complete
+// landmark file. Callers compare header->key with
+// mazecache_maze_key() of their maze before using the distances as
+// landmarks of another maze give bounds that are not admissible.
+{
+    int fd = open(fname, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || sb.st_size < (off_t)sizeof(altfile_header_t)) {
+        printf("ERROR: %s is not a landmark file\n", fname);
+        close(fd);
+        return NULL;
+    }
+    void *data;
+    if (use_mmap) {
+        data = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        data = (data == MAP_FAILED) ? NULL : data;
+    } else {
+        data = malloc(sb.st_size);
+        if (read(fd, data, sb.st_size) != sb.st_size) {
+            free(data);
+            data = NULL;
+        }
+    }
+    close(fd);
+    if (data == NULL) {
+        printf("ERROR: could not read file %s\n", fname);
+        return NULL;
+    }
+
+    // Check the header and that the file holds all the distances
+    altfile_header_t *header = data;
+    if (strncmp(header->magic, ALTFILE_MAGIC, sizeof(header->magic)) != 0 ||
+        (header->elem_size != sizeof(uint16_t) && header->elem_size != sizeof(uint32_t)) ||
+        header->count < 1 || header->count > ALT_LANDMARKS_MAX ||
+        header->rows < 0 || header->cols < 0 || (size_t)sb.st_size < mazealt_data_len(header)) {
+        printf("ERROR: %s is not a landmark file\n", fname);
+        if (use_mmap) {
+            munmap(data, sb.st_size);
+        } else {
+            free(data);
+        }
+        return NULL;
+    }
+    mazealt_t *alt = malloc(sizeof(mazealt_t));
+    alt->header = header;
+    alt->dists = header + 1;
+    alt->data_len = sb.st_size;
+    alt->mapped = use_mmap;
+    return alt;
+}
+
+void mazealt_free(mazealt_t *alt)
+// Unmaps or frees the data of `alt` and frees it. Does nothing if
+// alt is NULL.
+{
+    if (alt == NULL) {
+        return;
+    }
+    if (alt->mapped) {
+        munmap(alt->header, alt->data_len);
+    } else {
+        free(alt->header);
+    }
+    free(alt);
+}
+
+long mazealt_dist(mazealt_t *alt, int k, int row, int col)
+// Returns the distance from landmark k to tile row/col or -1 if the
+// landmark cannot reach it or the tile is out of bounds.
+{
+    if (k < 0 || k >= alt->header->count || row < 0 || row >= alt->header->rows ||
+        col < 0 || col >= alt->header->cols) {
+        return -1;
+    }
+    return mazealt_get(alt, k, (long)row * alt->header->cols + col);
+}
+
+static long mazealt_bound_to(mazealt_t *alt, long t, long *end_dists)
+// Returns the landmark lower bound on the distance from tile index t
+// to the tile whose landmark distances are in end_dists. Landmarks
+// that cannot reach one of the two tiles give no bound.
+{
+    long bound = 0;
+    for (int k = 0; k < alt->header->count; k++) {
+        long d = mazealt_get(alt, k, t);
+        if (d >= 0 && end_dists[k] >= 0) {
+            long diff = (d > end_dists[k]) ? d - end_dists[k] : end_dists[k] - d;
+            bound = (diff > bound) ? diff : bound;
+        }
+    }
+    return bound;
+}
+
+long mazealt_bound(mazealt_t *alt, int row, int col, int end_row, int end_col)
+// Returns the largest lower bound |d(L,v) - d(L,t)| on the distance
+// between tile v at row/col and tile t at end_row/col over all
+// landmarks L, or 0 if no landmark gives a bound.
+{
+    long end_dists[ALT_LANDMARKS_MAX];
+    for (int k = 0; k < alt->header->count; k++) {
+        end_dists[k] = mazealt_dist(alt, k, end_row, end_col);
+    }
+    if (row < 0 || row >= alt->header->rows || col < 0 || col >= alt->header->cols) {
+        return 0;
+    }
+    return mazealt_bound_to(alt, (long)row * alt->header->cols + col, end_dists);
+}
+
+static long maze_geometric_bound(maze_t *maze, int row, int col, int end_row, int end_col)
+// Returns the Manhattan distance between the tiles for 4-way movement
+// or the larger of the row and column differences for 8-way movement.
+{
+    int dr = abs(row - end_row), dc = abs(col - end_col);
+    if (maze->movement == MOVEMENT_8WAY) {
+        return (dr > dc) ? dr : dc;
+    }
+    return dr + dc;
+}
+
+int maze_astar_fits(maze_t *maze)
+// Returns 1 if `maze` has few enough tiles for maze_astar_path() to
+// number them with ints and 0 otherwise.
+{
+    return (long)maze->rows * maze->cols <= INT_MAX;
+}
+
+direction_t *maze_astar_path(maze_t *maze, mazealt_t *alt, int start_row, int start_col,
+                             int end_row, int end_col, long *lenp, long *expandedp)
+// Finds a shortest path from start_row/col to end_row/col in `maze`
+// with A*. The heuristic is the Manhattan distance (or its 8-way
+// equivalent) and, if `alt` is not NULL and was built for a maze of
+// the same size and movement, the larger landmark bound. Both are
+// consistent so each tile is expanded at most once. Among tiles with
+// equal estimates, those farther from the start are expanded first.
+// Returns a malloc()'d array of directions and sets *lenp to its
+// length, or returns NULL with *lenp set to -1 if no path exists. The
+// number of tiles expanded is stored in *expandedp if not NULL.
+// Tile numbers, distances, and heap items are ints, so mazes of more
+// than INT_MAX tiles are not searched and give NULL as well; callers
+// check maze_astar_fits() to tell them apart.
+{
+    *lenp = -1;
+    if (expandedp != NULL) {
+        *expandedp = 0;
+    }
+    if (!maze_astar_fits(maze) ||
+        maze_tile_blocked(maze, start_row, start_col) || maze_tile_blocked(maze, end_row, end_col)) {
+        return NULL;
+    }
+    if (alt != NULL && (alt->header->rows != maze->rows || alt->header->cols != maze->cols ||
+                        alt->header->movement != maze->movement)) {
+        alt = NULL;
+    }
+    long end_dists[ALT_LANDMARKS_MAX];
+    for (int k = 0; alt != NULL && k < alt->header->count; k++) {
+        end_dists[k] = mazealt_dist(alt, k, end_row, end_col);
+    }
+    int delta_end = (maze->movement == MOVEMENT_8WAY) ? DELTA_COUNT_8WAY : DELTA_COUNT;
+    long ntiles = (long)maze->rows * maze->cols;
+    int *g = malloc(sizeof(int) * ntiles);
+    unsigned char *dir = malloc(ntiles);
+    for (long t = 0; t < ntiles; t++) {
+        g[t] = -1;
+    }
+
+    // Heap keys order by f = g + h and then by larger g; the low 32
+    // bits hold the complement of g so it can be recovered
+    minheap_t *heap = minheap_allocate(64);
+    long start = (long)start_row * maze->cols + start_col;
+    long target = (long)end_row * maze->cols + end_col;
+    g[start] = 0;
+    dir[start] = NONE;
+    long h = maze_geometric_bound(maze, start_row, start_col, end_row, end_col);
+    if (alt != NULL) {
+        long bound = mazealt_bound_to(alt, start, end_dists);
+        h = (bound > h) ? bound : h;
+    }
+    minheap_push(heap, (h << 32) | UINT32_MAX, start);
+    long key, expanded = 0;
+    int item;
+    while (minheap_pop(heap, &key, &item)) {
+        long t = item;
+        long popped_g = UINT32_MAX - (key & UINT32_MAX);
+        if (popped_g != g[t]) {
+            continue;           // stale entry for an improved tile
+        }
+        expanded++;
+        if (t == target) {
+            break;
+        }
+        int row = t / maze->cols, col = t % maze->cols;
+        for (int d = DELTA_START; d < delta_end; d++) {
+            int nrow = row + row_delta[d];
+            int ncol = col + col_delta[d];
+            if (maze_tile_blocked(maze, nrow, ncol)) {
+                continue;
+            }
+            long n = (long)nrow * maze->cols + ncol;
+            int next = g[t] + 1;
+            if (g[n] >= 0 && g[n] <= next) {
+                continue;
+            }
+            g[n] = next;
+            dir[n] = dir_delta[d];
+            h = maze_geometric_bound(maze, nrow, ncol, end_row, end_col);
+            if (alt != NULL) {
+                long bound = mazealt_bound_to(alt, n, end_dists);
+                h = (bound > h) ? bound : h;
+            }
+            minheap_push(heap, ((next + h) << 32) | (UINT32_MAX - next), n);
+        }
+    }
+    minheap_free(heap);
+    if (expandedp != NULL) {
+        *expandedp = expanded;
+    }
+
+    // Follow the moves back from the end, filling the path from its end
+    direction_t *path = NULL;
+    if (g[target] >= 0) {
+        *lenp = g[target];
+        path = malloc(sizeof(direction_t) * (*lenp > 0 ? *lenp : 1));
+        int row = end_row, col = end_col;
+        for (long k = *lenp - 1; k >= 0; k--) {
+            direction_t move = dir[(long)row * maze->cols + col];
+            path[k] = move;
+            row -= row_delta[move];
+            col -= col_delta[move];
+        }
+    }
+    free(g);
+    free(dir);
+    return path;
+}
+
+int maze_solve_astar(maze_t *maze, mazealt_t *alt, long *expandedp)
+// Solves `maze` with maze_astar_path() from START to END, using the
+// landmarks `alt` if not NULL, in place of maze_bfs_iterate(). The
+// path is stored in the END tile which is marked FOUND so that
+// maze_set_solution() can follow it. Returns 1 if a path was found
+// and 0 otherwise, or -1 without searching if the maze is too large
+// for maze_astar_path(); the number of tiles expanded is stored in
+// *expandedp if it is not NULL.
+{
+    if (!maze_astar_fits(maze)) {
+        if (expandedp != NULL) {
+            *expandedp = 0;
+        }
+        return -1;
+    }
+    long len;
+    direction_t *path = maze_astar_path(maze, alt, maze->start_row, maze->start_col,
+                                        maze->end_row, maze->end_col, &len, expandedp);
+    if (path == NULL) {
+        return 0;
+    }
+    tile_t *end_tile = &maze->tiles[maze->end_row][maze->end_col];
+    free(end_tile->path);
+    free(end_tile->packed);
+    end_tile->packed = NULL;
+    end_tile->path = path;
+    end_tile->path_len = len;
+    end_tile->state = FOUND;
+    maze_note_path(maze, maze->end_row, maze->end_col);
+    if (LOG_LEVEL >= LOG_BFS_STEPS) {
+        printf("LOG: A* path of length %ld\n", len);
+    }
+    return 1;
+}
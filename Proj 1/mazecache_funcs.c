@@ -0,0 +1,380 @@
+#include "mazesolve.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <limits.h>
+#include <utime.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// On-disk cache of maze solutions
+//
+// The same maze files are often solved again and again. A cache
+// directory keeps the solution of each maze, found by a key hashed
+// from the bytes of the maze file along with its START/END tiles and
+// movement, so later runs read the stored path rather than searching
+// again. Paths are stored run-length encoded as rlepath_t runs which
+// keeps entries small for the long straight corridors typical of
+// mazes. The directory is kept below a size limit by removing the
+// least recently used entries; a hit updates the modification time of
+// its file to mark it as used.
+////////////////////////////////////////////////////////////////////////////////
+
+#define CACHE_HASH_MULT 0x9E3779B97F4A7C15UL  // odd constant for hash mixing
+#define CACHE_READ_SIZE (1 << 16)             // bytes read at a time when hashing
+
+static unsigned long cache_hash_mix(unsigned long hash, unsigned long word)
+// Mixes `word` into `hash` so that every bit of each affects the
+// high and low bits of the result.
+{
+    hash = (hash ^ word) * CACHE_HASH_MULT;
+    return hash ^ (hash >> 32);
+}
+
+unsigned long mazecache_key(char *fname, maze_t *maze)
+// Returns the cache key for `maze` loaded from the file `fname`: a
+// hash of the file bytes, 8 at a time, and the file length mixed with
+// the START/END coordinates and movement of the maze. Returns 0 if
+// the file cannot be read.
+{
+    int fd = open(fname, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    unsigned char *buf = malloc(CACHE_READ_SIZE);
+    unsigned long hash = 0, total = 0;
+    ssize_t nread;
+    while ((nread = read(fd, buf, CACHE_READ_SIZE)) > 0) {
+        // Whole words are mixed directly; a final partial word is
+        // padded with zeros as the length is mixed in at the end
+        ssize_t k = 0;
+        for (; k + 8 <= nread; k += 8) {
+            unsigned long word;
+            memcpy(&word, buf + k, 8);
+            hash = cache_hash_mix(hash, word);
+        }
+        if (k < nread) {
+            unsigned long word = 0;
+            memcpy(&word, buf + k, nread - k);
+            hash = cache_hash_mix(hash, word);
+        }
+        total += nread;
+    }
+    free(buf);
+    close(fd);
+    if (nread < 0) {
+        return 0;
+    }
+    hash = cache_hash_mix(hash, total);
+    hash = cache_hash_mix(hash, ((unsigned long)maze->start_row << 32) | (unsigned)maze->start_col);
+    hash = cache_hash_mix(hash, ((unsigned long)maze->end_row << 32) | (unsigned)maze->end_col);
+    hash = cache_hash_mix(hash, maze->movement);
+    return hash != 0 ? hash : 1;
+}
+
+unsigned long mazecache_maze_key(maze_t *maze, int with_ends)
+// Returns a key for the tiles of `maze` rather than its file: a hash
+// of which tiles are WALL, 64 tiles to a word, mixed with its size
+// and movement and, if with_ends is nonzero, its START/END
+// coordinates. Files of data derived from the walls alone such as
+// abstractions and landmarks store this key so they can be reused
+// for other START/END tiles but never for a different maze.
+{
+    unsigned long hash = 0, word = 0;
+    int bits = 0;
+    for (int i = 0; i < maze->rows; i++) {
+        for (int j = 0; j < maze->cols; j++) {
+            word = (word << 1) | (maze->tiles[i][j].type == WALL);
+            if (++bits == 64) {
+                hash = cache_hash_mix(hash, word);
+                word = 0;
+                bits = 0;
+            }
+        }
+    }
+    hash = cache_hash_mix(hash, word);
+    hash = cache_hash_mix(hash, ((unsigned long)maze->rows << 32) | (unsigned)maze->cols);
+    hash = cache_hash_mix(hash, maze->movement);
+    if (with_ends) {
+        hash = cache_hash_mix(hash, ((unsigned long)maze->start_row << 32) | (unsigned)maze->start_col);
+        hash = cache_hash_mix(hash, ((unsigned long)maze->end_row << 32) | (unsigned)maze->end_col);
+    }
+    return hash != 0 ? hash : 1;
+}
+
+mazecache_t *mazecache_open(char *dir, long max_bytes)
+// Opens the cache directory `dir`, creating it if it does not exist,
+// with solutions kept to at most `max_bytes` in total; max_bytes of 0
+// or less uses CACHE_MAX_BYTES. Returns NULL if the directory cannot
+// be created.
+{
+    struct stat st;
+    if (mkdir(dir, 0777) != 0 && (stat(dir, &st) != 0 || !S_ISDIR(st.st_mode))) {
+        printf("ERROR: could not open cache directory %s\n", dir);
+        return NULL;
+    }
+    mazecache_t *cache = malloc(sizeof(mazecache_t));
+    cache->dir = strdup(dir);
+    cache->max_bytes = (max_bytes > 0) ? max_bytes : CACHE_MAX_BYTES;
+    cache->hits = 0;
+    cache->misses = 0;
+    return cache;
+}
+
+static int cache_header_matches(cachefile_header_t *header, unsigned long key, maze_t *maze)
+// Returns 1 if `header` is for the maze with `key` and 0 otherwise.
+// Besides the key the maze size, START/END tiles, and movement must
+// also match so that a collision of keys is not taken as a hit.
+{
+    return strncmp(header->magic, CACHEFILE_MAGIC, sizeof(header->magic)) == 0 &&
+        header->key == key && header->rows == maze->rows && header->cols == maze->cols &&
+        header->start_row == maze->start_row && header->start_col == maze->start_col &&
+        header->end_row == maze->end_row && header->end_col == maze->end_col &&
+        header->movement == maze->movement && header->path_len >= -1 &&
+        header->run_count >= 0 && header->run_count <= header->path_len + 1;
+}
+
+static int cache_path_valid(maze_t *maze, rlepath_t *rle)
+// Returns 1 if the moves of `rle` walk from START to END of `maze`
+// through tiles that are not blocked and 0 otherwise. The path is
+// followed with no checks once it is in the END tile, so one from a
+// damaged file or a key collision must not leave the maze.
+{
+    int row = maze->start_row, col = maze->start_col;
+    for (long r = 0; r < rle->run_count; r++) {
+        for (long k = 0; k < rle->runs[r].count; k++) {
+            row += row_delta[rle->runs[r].dir];
+            col += col_delta[rle->runs[r].dir];
+            if (maze_tile_blocked(maze, row, col)) {
+                return 0;
+            }
+        }
+    }
+    return row == maze->end_row && col == maze->end_col;
+}
+
+int mazecache_lookup(mazecache_t *cache, unsigned long key, maze_t *maze)
+// Looks up the solution of `maze` with the given key. If the maze
+// had a path when stored, the path is expanded into the path field of
+// the END tile which is marked FOUND so that maze_set_solution() can
+// follow it, and 1 is returned. Returns 0 if the maze was stored as
+// having no solution. Either counts as a hit. Returns CACHE_MISS if
+// there is no valid entry for the maze, counting a miss; a stored path
+// is only valid if it walks from START to END over open tiles.
+{
+    char fname[PATH_MAX];
+    snprintf(fname, sizeof(fname), "%s/%016lx.sol", cache->dir, key);
+    FILE *fin = fopen(fname, "rb");
+    cachefile_header_t header;
+    rlepath_t rle = {NULL, 0, 0};
+    int ok = fin != NULL && fread(&header, sizeof(header), 1, fin) == 1 &&
+        cache_header_matches(&header, key, maze);
+    if (ok) {
+        rle.run_count = header.run_count;
+        rle.runs = malloc(sizeof(dirrun_t) * (rle.run_count > 0 ? rle.run_count : 1));
+        ok = fread(rle.runs, sizeof(dirrun_t), rle.run_count, fin) == (size_t)rle.run_count;
+        int delta_end = (maze->movement == MOVEMENT_8WAY) ? DELTA_COUNT_8WAY : DELTA_COUNT;
+        for (long r = 0; ok && r < rle.run_count; r++) {
+            ok = (int)rle.runs[r].dir >= DELTA_START && (int)rle.runs[r].dir < delta_end &&
+                rle.runs[r].count > 0 && rle.runs[r].count <= header.path_len - rle.path_len;
+            rle.path_len += rle.runs[r].count;
+        }
+        ok = ok && (header.path_len < 0 ||
+                    (rle.path_len == header.path_len && cache_path_valid(maze, &rle)));
+    }
+    if (fin != NULL) {
+        fclose(fin);
+    }
+    if (!ok) {
+        free(rle.runs);
+        cache->misses++;
+        return CACHE_MISS;
+    }
+    utime(fname, NULL);         // mark as recently used
+    cache->hits++;
+    if (header.path_len < 0) {
+        free(rle.runs);
+        return 0;
+    }
+    tile_t *end_tile = &maze->tiles[maze->end_row][maze->end_col];
+    free(end_tile->path);
+    free(end_tile->packed);
+    end_tile->packed = NULL;
+    end_tile->path = rlepath_expand(&rle);
+    end_tile->path_len = rle.path_len;
+    end_tile->state = FOUND;
+    maze_note_path(maze, maze->end_row, maze->end_col);
+    free(rle.runs);
+    if (LOG_LEVEL >= LOG_BFS_STEPS) {
+        printf("LOG: cached path of length %ld from %s\n", header.path_len, fname);
+    }
+    return 1;
+}
+
+int mazecache_store(mazecache_t *cache, unsigned long key, maze_t *maze, int found)
+// Stores the solution of `maze` under `key`: the path of the END tile
+// if `found` is 1 or that there is no solution if it is 0. The entry
+// is written to a temporary file then renamed so other processes
+// never read a partial entry. Least recently used entries are then
+// evicted to keep the cache within its size limit. Returns 1 on
+// success and 0 if the entry could not be written.
+{
+    tile_t *end_tile = &maze->tiles[maze->end_row][maze->end_col];
+    rlepath_t *rle = found ? rlepath_from_tile(end_tile) : NULL;
+    cachefile_header_t header;
+    memset(&header, 0, sizeof(header));
+    strcpy(header.magic, CACHEFILE_MAGIC);
+    header.key = key;
+    header.rows = maze->rows;
+    header.cols = maze->cols;
+    header.start_row = maze->start_row;
+    header.start_col = maze->start_col;
+    header.end_row = maze->end_row;
+    header.end_col = maze->end_col;
+    header.movement = maze->movement;
+    header.path_len = (rle != NULL) ? rle->path_len : -1;
+    header.run_count = (rle != NULL) ? rle->run_count : 0;
+
+    char tmp_name[PATH_MAX], fname[PATH_MAX];
+    snprintf(tmp_name, sizeof(tmp_name), "%s/%016lx.tmp%d", cache->dir, key, (int)getpid());
+    snprintf(fname, sizeof(fname), "%s/%016lx.sol", cache->dir, key);
+    FILE *fout = fopen(tmp_name, "wb");
+    int ok = fout != NULL && fwrite(&header, sizeof(header), 1, fout) == 1 &&
+        (rle == NULL ||
+         fwrite(rle->runs, sizeof(dirrun_t), rle->run_count, fout) == (size_t)rle->run_count);
+    if (fout != NULL && fclose(fout) != 0) {
+        ok = 0;
+    }
+    rlepath_free(rle);
+    if (!ok || rename(tmp_name, fname) != 0) {
+        printf("ERROR: failed writing cache entry %s\n", fname);
+        remove(tmp_name);
+        return 0;
+    }
+    mazecache_evict(cache);
+    return 1;
+}
+
+typedef struct {                // .sol file considered for eviction
+    char name[NAME_MAX + 1];
+    off_t size;
+    struct timespec mtime;
+} cacheentry_t;
+
+static int compare_cache_entries(const void *a, const void *b)
+// qsort() comparison ordering entries from least to most recently
+// used, breaking ties by name so the order is always the same.
+{
+    const cacheentry_t *x = a, *y = b;
+    if (x->mtime.tv_sec != y->mtime.tv_sec) {
+        return (x->mtime.tv_sec < y->mtime.tv_sec) ? -1 : 1;
+    }
+    if (x->mtime.tv_nsec != y->mtime.tv_nsec) {
+        return (x->mtime.tv_nsec < y->mtime.tv_nsec) ? -1 : 1;
+    }
+    return strcmp(x->name, y->name);
+}
+
+long mazecache_evict(mazecache_t *cache)
+// Removes the least recently used solutions from the cache until the
+// .sol files total at most cache->max_bytes. Returns the number of
+// entries removed.
+{
+    DIR *dir = opendir(cache->dir);
+    if (dir == NULL) {
+        return 0;
+    }
+    int count = 0, capacity = 16;
+    cacheentry_t *entries = malloc(sizeof(cacheentry_t) * capacity);
+    long total = 0;
+    char fname[PATH_MAX];
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        int len = strlen(ent->d_name);
+        struct stat st;
+        snprintf(fname, sizeof(fname), "%s/%s", cache->dir, ent->d_name);
+        if (len < 4 || strcmp(ent->d_name + len - 4, ".sol") != 0 || stat(fname, &st) != 0) {
+            continue;
+        }
+        if (count == capacity) {
+            capacity *= 2;
+            entries = realloc(entries, sizeof(cacheentry_t) * capacity);
+        }
+        strcpy(entries[count].name, ent->d_name);
+        entries[count].size = st.st_size;
+        entries[count].mtime = st.st_mtim;
+        total += st.st_size;
+        count++;
+    }
+    closedir(dir);
+
+    long removed = 0;
+    if (total > cache->max_bytes) {
+        qsort(entries, count, sizeof(cacheentry_t), compare_cache_entries);
+        for (int k = 0; k < count && total > cache->max_bytes; k++) {
+            snprintf(fname, sizeof(fname), "%s/%s", cache->dir, entries[k].name);
+            if (remove(fname) == 0) {
+                total -= entries[k].size;
+                removed++;
+            }
+        }
+        if (LOG_LEVEL >= LOG_BFS_STEPS) {
+            printf("LOG: evicted %ld cache entries, %ld bytes remain\n", removed, total);
+        }
+    }
+    free(entries);
+    return removed;
+}
+
+void mazecache_close(mazecache_t *cache, long *total_hitsp, long *total_missesp)
+// Adds the hits and misses of `cache` to the counts in the stats file
+// of its directory, then de-allocates it. The counts over all runs
+// are stored in *total_hitsp and *total_missesp if they are not NULL.
+// Does nothing if cache is NULL.
+//
+// NOTES: The stats file is replaced by renaming a temporary file so a
+// lock on it would not be seen by a process that opened the new one.
+// Instead the directory itself is locked with flock() for the whole
+// read-modify-write so runs closing at the same time add their counts
+// one after another rather than overwriting each other's.
+{
+    if (cache == NULL) {
+        return;
+    }
+    char fname[PATH_MAX], tmp_name[PATH_MAX];
+    snprintf(fname, sizeof(fname), "%s/stats", cache->dir);
+    snprintf(tmp_name, sizeof(tmp_name), "%s/stats.tmp%d", cache->dir, (int)getpid());
+    int lock_fd = open(cache->dir, O_RDONLY);
+    if (lock_fd >= 0) {
+        flock(lock_fd, LOCK_EX);
+    }
+    long hits = 0, misses = 0;
+    FILE *fin = fopen(fname, "r");
+    if (fin != NULL) {
+        if (fscanf(fin, "hits %ld misses %ld", &hits, &misses) != 2) {
+            hits = misses = 0;
+        }
+        fclose(fin);
+    }
+    hits += cache->hits;
+    misses += cache->misses;
+    FILE *fout = fopen(tmp_name, "w");
+    if (fout != NULL) {
+        fprintf(fout, "hits %ld\nmisses %ld\n", hits, misses);
+        if (fclose(fout) != 0 || rename(tmp_name, fname) != 0) {
+            remove(tmp_name);
+        }
+    }
+    if (lock_fd >= 0) {
+        close(lock_fd);         // releases the lock
+    }
+    if (total_hitsp != NULL) {
+        *total_hitsp = hits;
+    }
+    if (total_missesp != NULL) {
+        *total_missesp = misses;
+    }
+    free(cache->dir);
+    free(cache);
+}
@@ -0,0 +1,258 @@
+#include "mazesolve.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Checkpoints of BFS searches in progress
+//
+// A BFS over a large maze may run long enough that it is worth saving
+// so that it can be continued later rather than started over. The
+// state of a search is the FOUND tiles with their paths and the queue
+// of tiles still to be expanded. Storing every path would take space
+// proportional to the sum of path lengths; instead a checkpoint holds
+// one byte per tile with its state and the last move of its path. As
+// each path extends the path of the tile it was reached from, paths
+// are rebuilt on resume by following these moves back to the origin.
+////////////////////////////////////////////////////////////////////////////////
+
+int maze_bfs_checkpoint(maze_t *maze, char *fname)
+// Writes the state of the BFS in progress on `maze` to the binary
+// file `fname`: a ckptfile_header_t, then rows*cols bytes of
+// CKPT_TILE(state,dir) in row-major order, then the row/col pairs of
+// the queue from front to rear as ints. The tile bytes and the queue
+// are each written with a single fwrite(). The header holds
+// mazecache_maze_key() of the maze and its START/END so the search is
+// only resumed in the same maze. Returns 1 on success and 0 if the
+// file could not be written.
+{
+    FILE *fout = fopen(fname, "wb");
+    if (fout == NULL) {
+        printf("ERROR: could not open file %s\n", fname);
+        return 0;
+    }
+    ckptfile_header_t header;
+    memset(&header, 0, sizeof(header));
+    strcpy(header.magic, CKPTFILE_MAGIC);
+    header.key = mazecache_maze_key(maze, 1);
+    header.rows = maze->rows;
+    header.cols = maze->cols;
+    header.movement = maze->movement;
+    header.pack_paths = maze->pack_paths;
+    header.queue_count = (maze->queue != NULL) ? maze->queue->count : 0;
+
+    // One byte per tile: FOUND tiles record the last move of their path
+    long ntiles = (long)maze->rows * maze->cols;
+    unsigned char *tiles = malloc(ntiles > 0 ? ntiles : 1);
+    for (int i = 0; i < maze->rows; i++) {
+        for (int j = 0; j < maze->cols; j++) {
+            tile_t *tile = &maze->tiles[i][j];
+            direction_t dir = NONE;
+            if (tile->state == FOUND && tile->path_len > 0) {
+                dir = tile_path_dir(tile, tile->path_len - 1);
+            }
+            tiles[(long)i * maze->cols + j] = CKPT_TILE(tile->state, dir);
+        }
+    }
+
+    // Queue contents from front to rear as row/col pairs
+    int *queue = malloc(sizeof(int) * 2 * (header.queue_count > 0 ? header.queue_count : 1));
+    long k = 0;
+    if (maze->queue != NULL) {
+        for (rcnode_t *node = maze->queue->front; node != NULL; node = node->next) {
+            queue[k++] = node->row;
+            queue[k++] = node->col;
+        }
+    }
+
+    int ok = fwrite(&header, sizeof(header), 1, fout) == 1 &&
+        fwrite(tiles, 1, ntiles, fout) == (size_t)ntiles &&
+        fwrite(queue, sizeof(int), k, fout) == (size_t)k;
+    free(tiles);
+    free(queue);
+    if (fclose(fout) != 0 || !ok) {
+        printf("ERROR: failed writing checkpoint to %s\n", fname);
+        return 0;
+    }
+    if (LOG_LEVEL >= LOG_BFS_STEPS) {
+        printf("LOG: checkpoint with %ld queued tiles written to %s\n", header.queue_count, fname);
+    }
+    return 1;
+}
+
+int maze_bfs_resume(maze_t *maze, char *fname)
+// Restores the BFS state saved by maze_bfs_checkpoint() into `maze`
+// which must have the same tiles and START/END as the maze that was
+// saved. Any paths the maze has are freed, then the tile states and
+// queue are restored and the movement and pack_paths settings of the
+// search are taken from the checkpoint. Afterwards maze_bfs_step()
+// continues the search exactly as it would have without the
+// interruption. Returns 1 on success and 0, leaving the maze
+// unchanged, if the file cannot be read, was saved from a different
+// maze, or holds a search that BFS could not have produced.
+//
+// NOTES: Path lengths are found by following each FOUND tile's last
+// move back to the tile it was reached from, remembering lengths
+// already known so each tile is followed once. A chain longer than
+// the number of tiles must be a cycle so the file is rejected. A
+// counting sort by length then orders the tiles so each path is built
+// by tile_extend_path() from the already rebuilt path of the tile
+// before it, just as the BFS built them.
+{
+    FILE *fin = fopen(fname, "rb");
+    if (fin == NULL) {
+        return 0;
+    }
+    ckptfile_header_t header;
+    long ntiles = (long)maze->rows * maze->cols;
+    int ok = fread(&header, sizeof(header), 1, fin) == 1 &&
+        strncmp(header.magic, CKPTFILE_MAGIC, sizeof(header.magic)) == 0 &&
+        header.rows == maze->rows && header.cols == maze->cols &&
+        (header.movement == MOVEMENT_4WAY || header.movement == MOVEMENT_8WAY) &&
+        (header.pack_paths == 0 || header.pack_paths == 1) &&
+        header.queue_count >= 0 && header.queue_count <= ntiles;
+    if (ok) {
+        // The key covers the movement of the search being resumed
+        int movement = maze->movement;
+        maze->movement = header.movement;
+        ok = header.key == mazecache_maze_key(maze, 1);
+        maze->movement = movement;
+    }
+    if (!ok) {
+        printf("ERROR: %s is not a checkpoint for this maze\n", fname);
+        fclose(fin);
+        return 0;
+    }
+    unsigned char *tiles = malloc(ntiles > 0 ? ntiles : 1);
+    int *queue = malloc(sizeof(int) * 2 * (header.queue_count > 0 ? header.queue_count : 1));
+    ok = fread(tiles, 1, ntiles, fin) == (size_t)ntiles &&
+        fread(queue, sizeof(int), 2 * header.queue_count, fin) == (size_t)(2 * header.queue_count);
+    fclose(fin);
+
+    // Each move must be one of the search's movement and lead back to
+    // a FOUND tile inside the maze; queued tiles must be in the maze
+    int dir_end = (header.movement == MOVEMENT_8WAY) ? DELTA_COUNT_8WAY : DELTA_COUNT;
+    for (long t = 0; ok && t < ntiles; t++) {
+        searchstate_t state = CKPT_STATE(tiles[t]);
+        direction_t dir = CKPT_DIR(tiles[t]);
+        ok = state <= FOUND && (dir == NONE || (state == FOUND && (int)dir < dir_end));
+        if (ok && dir != NONE) {
+            int row = t / maze->cols - row_delta[dir];
+            int col = t % maze->cols - col_delta[dir];
+            ok = row >= 0 && row < maze->rows && col >= 0 && col < maze->cols &&
+                CKPT_STATE(tiles[(long)row * maze->cols + col]) == FOUND;
+        }
+    }
+    for (long k = 0; ok && k < header.queue_count; k++) {
+        ok = queue[2 * k] >= 0 && queue[2 * k] < maze->rows &&
+            queue[2 * k + 1] >= 0 && queue[2 * k + 1] < maze->cols;
+    }
+
+    // Find each FOUND tile's path length by following last moves back
+    // until reaching a tile whose length is known or an origin
+    long *len = malloc(sizeof(long) * (ntiles > 0 ? ntiles : 1));
+    long *chain = malloc(sizeof(long) * (ntiles > 0 ? ntiles : 1));
+    for (long t = 0; t < ntiles; t++) {
+        len[t] = -1;
+    }
+    long max_len = 0;
+    for (long t = 0; ok && t < ntiles; t++) {
+        if (CKPT_STATE(tiles[t]) != FOUND || len[t] >= 0) {
+            continue;
+        }
+        long nchain = 0, cur = t;
+        long known = -1;
+        while (len[cur] < 0 && CKPT_DIR(tiles[cur]) != NONE) {
+            if (nchain == ntiles) {
+                ok = 0;
+                break;
+            }
+            chain[nchain++] = cur;
+            direction_t dir = CKPT_DIR(tiles[cur]);
+            cur -= (long)row_delta[dir] * maze->cols + col_delta[dir];
+        }
+        known = (len[cur] >= 0) ? len[cur] : 0;
+        len[cur] = known;
+        while (nchain > 0) {
+            len[chain[--nchain]] = ++known;
+        }
+        if (known > max_len) {
+            max_len = known;
+        }
+    }
+    if (!ok) {
+        printf("ERROR: %s is not a checkpoint for this maze\n", fname);
+        free(len);
+        free(chain);
+        free(tiles);
+        free(queue);
+        return 0;
+    }
+    maze->movement = header.movement;
+    maze->pack_paths = header.pack_paths;
+
+    // Clear any existing search state
+    for (int i = 0; i < maze->rows; i++) {
+        for (int j = 0; j < maze->cols; j++) {
+            tile_t *tile = &maze->tiles[i][j];
+            free(tile->path);
+            free(tile->packed);
+            tile->path = NULL;
+            tile->packed = NULL;
+            tile->path_len = -1;
+            tile->state = NOTFOUND;
+        }
+    }
+
+    // Order tiles by path length and rebuild their paths in that order
+    long *first = calloc(max_len + 2, sizeof(long));
+    for (long t = 0; t < ntiles; t++) {
+        if (len[t] >= 0) {
+            first[len[t] + 1]++;
+        }
+    }
+    for (long l = 0; l < max_len + 1; l++) {
+        first[l + 1] += first[l];
+    }
+    for (long t = 0; t < ntiles; t++) {
+        if (len[t] >= 0) {
+            chain[first[len[t]]++] = t;
+        }
+    }
+    long nfound = first[max_len];
+    for (long k = 0; k < nfound; k++) {
+        long t = chain[k];
+        int row = t / maze->cols, col = t % maze->cols;
+        tile_t *tile = &maze->tiles[row][col];
+        if (len[t] == 0) {
+            // Origins get a length 0 path of the kind the BFS uses
+            if (maze->pack_paths && maze->movement == MOVEMENT_4WAY) {
+                tile->packed = malloc(1);
+            } else {
+                tile->path = malloc(sizeof(direction_t));
+            }
+            tile->path_len = 0;
+        } else {
+            direction_t dir = CKPT_DIR(tiles[t]);
+            tile_extend_path(&maze->tiles[row - row_delta[dir]][col - col_delta[dir]], tile, dir);
+        }
+        tile->state = FOUND;
+        maze_note_path(maze, row, col);
+    }
+    free(first);
+    free(chain);
+    free(len);
+    free(tiles);
+
+    // Restore the queue in its original order
+    if (maze->queue != NULL) {
+        rcqueue_free(maze->queue);
+    }
+    maze->queue = rcqueue_allocate();
+    for (long k = 0; k < header.queue_count; k++) {
+        rcqueue_add_rear(maze->queue, queue[2 * k], queue[2 * k + 1]);
+    }
+    free(queue);
+    if (LOG_LEVEL >= LOG_BFS_STEPS) {
+        printf("LOG: resumed %ld found tiles and %ld queued tiles from %s\n",
+               nfound, header.queue_count, fname);
+    }
+    return 1;
+}
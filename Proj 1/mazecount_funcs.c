@@ -0,0 +1,166 @@
+#include "mazesolve.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Counting and enumerating shortest paths
+//
+// A BFS keeps only the first path that reaches each tile, yet there
+// may be many shortest paths between two tiles. The number of shortest
+// paths to a tile is the sum of the numbers for its neighbors one move
+// closer to the start, so it is found for every tile during a single
+// BFS. Counts grow exponentially in open areas and stop at
+// PATHS_SATURATED rather than overflowing. Listing the paths could take
+// exponential memory, so a pathenum_t instead walks back from the end
+// through tiles one move closer to the start and produces one path at
+// a time, keeping only the current path.
+////////////////////////////////////////////////////////////////////////////////
+
+long mazegrid_count_paths(mazegrid_t *grid, int start_row, int start_col,
+                          int *dist, unsigned long *counts)
+// Breadth-first search of `grid` from start_row/col which fills
+// `dist` as mazegrid_bfs() does and `counts` with the number of
+// distinct shortest paths from the start to each tile, 0 for tiles
+// that cannot be reached. Both arrays have grid->ncells elements laid
+// out like the grid cells. Counts that would not fit in an unsigned
+// long are PATHS_SATURATED. Returns the number of tiles reached or 0
+// if the start is not an open tile.
+//
+// NOTES: A tile's count is final once it is expanded as all tiles one
+// move closer to the start are expanded before it. Expanding a tile
+// adds its count to each neighbor at the next distance, whether it
+// first reaches the neighbor or another tile already did, so the time
+// is that of one BFS.
+{
+    for (long i = 0; i < grid->ncells; i++) {
+        dist[i] = -1;
+        counts[i] = 0;
+    }
+    if (!mazegrid_open(grid, start_row, start_col)) {
+        return 0;
+    }
+    int delta_end = (grid->movement == MOVEMENT_8WAY) ? DELTA_COUNT_8WAY : DELTA_COUNT;
+    int *queue = malloc(sizeof(int) * 2 * ((long)grid->rows * grid->cols));
+    long front = 0, rear = 0;
+    long start_idx = mazegrid_index(grid, start_row, start_col);
+    dist[start_idx] = 0;
+    counts[start_idx] = 1;
+    queue[rear++] = start_row;
+    queue[rear++] = start_col;
+    while (front < rear) {
+        int row = queue[front++];
+        int col = queue[front++];
+        long idx = mazegrid_index(grid, row, col);
+        int next_dist = dist[idx] + 1;
+        for (int d = DELTA_START; d < delta_end; d++) {
+            int nrow = row + row_delta[d];
+            int ncol = col + col_delta[d];
+            long nidx = mazegrid_index(grid, nrow, ncol);
+            if (grid->cells[nidx] != GRID_OPEN) {
+                continue;
+            }
+            if (dist[nidx] == -1) {
+                dist[nidx] = next_dist;
+                queue[rear++] = nrow;
+                queue[rear++] = ncol;
+            }
+            if (dist[nidx] == next_dist) {
+                // Saturating add: a sum below either term has wrapped
+                unsigned long sum = counts[nidx] + counts[idx];
+                counts[nidx] = (sum < counts[idx]) ? PATHS_SATURATED : sum;
+            }
+        }
+    }
+    free(queue);
+    return rear / 2;
+}
+
+static int pathenum_descend(pathenum_t *pe, long k, int first)
+// Chooses the move into the tile at distance k of the current path,
+// trying moves from index `first` of dir_delta[] onward, then the
+// first move into each tile closer to the start down to the start.
+// Returns 1 on success or 0 if no move from index `first` on comes
+// from a tile one move closer to the start.
+{
+    int delta_end = (pe->grid->movement == MOVEMENT_8WAY) ? DELTA_COUNT_8WAY : DELTA_COUNT;
+    for (; k > 0; k--, first = DELTA_START) {
+        int d = first;
+        for (; d < delta_end; d++) {
+            int prow = pe->rows[k] - row_delta[d];
+            int pcol = pe->cols[k] - col_delta[d];
+            if (pe->dist[mazegrid_index(pe->grid, prow, pcol)] == k - 1) {
+                break;
+            }
+        }
+        if (d == delta_end) {
+            return 0;
+        }
+        pe->choice[k] = d;
+        pe->path[k - 1] = dir_delta[d];
+        pe->rows[k - 1] = pe->rows[k] - row_delta[d];
+        pe->cols[k - 1] = pe->cols[k] - col_delta[d];
+    }
+    return 1;
+}
+
+pathenum_t *pathenum_start(mazegrid_t *grid, int *dist, int end_row, int end_col)
+// Prepares to enumerate the shortest paths to end_row/col using the
+// distances `dist` found by mazegrid_count_paths() or mazegrid_bfs()
+// on `grid`; both must outlive the enumeration. Returns NULL if the
+// end tile was not reached. Paths are produced by pathenum_next().
+{
+    if (!mazegrid_open(grid, end_row, end_col) ||
+        dist[mazegrid_index(grid, end_row, end_col)] < 0) {
+        return NULL;
+    }
+    pathenum_t *pe = malloc(sizeof(pathenum_t));
+    pe->grid = grid;
+    pe->dist = dist;
+    pe->len = dist[mazegrid_index(grid, end_row, end_col)];
+    pe->rows = malloc(sizeof(int) * (pe->len + 1));
+    pe->cols = malloc(sizeof(int) * (pe->len + 1));
+    pe->choice = malloc(sizeof(int) * (pe->len + 1));
+    pe->path = malloc(sizeof(direction_t) * (pe->len > 0 ? pe->len : 1));
+    pe->rows[pe->len] = end_row;
+    pe->cols[pe->len] = end_col;
+    pe->started = 0;
+    return pe;
+}
+
+int pathenum_next(pathenum_t *pe)
+// Advances to the next shortest path, leaving its pe->len directions
+// in pe->path, and returns 1, or returns 0 once every path has been
+// produced. Each path is produced once. Paths are in order of the
+// moves into the tiles nearest the end, compared in dir_delta[] order,
+// then of the moves into tiles further back.
+//
+// NOTES: The enumeration is a depth-first search back from the end
+// that keeps only its current path. The next path changes the move
+// into the tile nearest the start that has another move left to try
+// and takes the first move into each tile closer to the start after
+// it. Every tile chosen was reached from the start, so each choice
+// leads back to the start and no work is spent on dead ends.
+{
+    if (!pe->started) {
+        pe->started = 1;
+        return pathenum_descend(pe, pe->len, DELTA_START);
+    }
+    for (long k = 1; k <= pe->len; k++) {
+        if (pathenum_descend(pe, k, pe->choice[k] + 1)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void pathenum_free(pathenum_t *pe)
+// De-allocates `pe` and its arrays but not the grid or distances it
+// uses. Does nothing if pe is NULL.
+{
+    if (pe == NULL) {
+        return;
+    }
+    free(pe->rows);
+    free(pe->cols);
+    free(pe->choice);
+    free(pe->path);
+    free(pe);
+}
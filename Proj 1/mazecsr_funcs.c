@@ -0,0 +1,347 @@
+#include "mazesolve.h"
+#include <limits.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// mazecsr_t: open tiles as a compressed sparse row graph
+//
+// Walls are often more than half the tiles of a maze, yet a search of
+// a maze_t or mazegrid_t checks every wall next to each tile it
+// expands. A mazecsr_t numbers only the open tiles and lists the open
+// neighbors of each in one array, in compressed sparse row form, so a
+// BFS touches open tiles alone and needs no bounds or wall checks.
+// Nodes are numbered in BFS order or along a Hilbert curve so that
+// neighboring tiles tend to get nearby numbers and their entries share
+// cache lines. Indices are ints, half the size of a long, which limits
+// a graph to 2^31-1 open tiles and neighbor entries.
+////////////////////////////////////////////////////////////////////////////////
+
+typedef struct {                // open tile and its position on the Hilbert curve
+  long key;
+  int row, col;
+} hilbert_tile_t;
+
+static long mazecsr_hilbert(long side, long row, long col)
+// Returns the distance along a Hilbert curve filling a `side` by
+// `side` square, side a power of 2, of the point row/col.
+{
+    long d = 0;
+    for (long s = side / 2; s > 0; s /= 2) {
+        int rx = (col & s) > 0;
+        int ry = (row & s) > 0;
+        d += s * s * ((3 * rx) ^ ry);
+        // Rotate the quadrant so the curve inside it has the base shape
+        if (ry == 0) {
+            if (rx == 1) {
+                row = side - 1 - row;
+                col = side - 1 - col;
+            }
+            long tmp = row;
+            row = col;
+            col = tmp;
+        }
+    }
+    return d;
+}
+
+static int hilbert_tile_cmp(const void *a, const void *b)
+// qsort() comparison of hilbert_tile_t by key.
+{
+    long ka = ((hilbert_tile_t *)a)->key, kb = ((hilbert_tile_t *)b)->key;
+    return (ka > kb) - (ka < kb);
+}
+
+static void mazecsr_number_bfs(mazecsr_t *csr, maze_t *maze, unsigned char *open,
+                               int delta_end)
+// Numbers the open tiles of `maze`, flagged in the row-major array
+// `open`, in the order a BFS reaches them, starting with the region
+// containing START and then each region not yet numbered in row-major
+// order of its first tile. The node_row and node_col arrays double as
+// the BFS queue as nodes are queued in the order they are numbered.
+{
+    int count = 0;
+    for (long k = -1; k < (long)maze->rows * maze->cols; k++) {
+        int row = (k < 0) ? maze->start_row : k / maze->cols;
+        int col = (k < 0) ? maze->start_col : k % maze->cols;
+        if (row < 0 || col < 0 || !open[(long)row * maze->cols + col] ||
+            mazecsr_node(csr, row, col) >= 0) {
+            continue;
+        }
+        int front = count;
+        csr->node_of[(long)row * maze->cols + col] = count;
+        csr->node_row[count] = row;
+        csr->node_col[count++] = col;
+        while (front < count) {
+            int r = csr->node_row[front];
+            int c = csr->node_col[front++];
+            for (int d = DELTA_START; d < delta_end; d++) {
+                int nrow = r + row_delta[d];
+                int ncol = c + col_delta[d];
+                if (nrow >= 0 && nrow < maze->rows && ncol >= 0 && ncol < maze->cols &&
+                    open[(long)nrow * maze->cols + ncol] && mazecsr_node(csr, nrow, ncol) < 0) {
+                    csr->node_of[(long)nrow * maze->cols + ncol] = count;
+                    csr->node_row[count] = nrow;
+                    csr->node_col[count++] = ncol;
+                }
+            }
+        }
+    }
+}
+
+static void mazecsr_number_hilbert(mazecsr_t *csr, maze_t *maze, unsigned char *open)
+// Numbers the open tiles of `maze`, flagged in the row-major array
+// `open`, in order along a Hilbert curve over the smallest power of 2
+// square holding the maze.
+{
+    long side = 1;
+    while (side < maze->rows || side < maze->cols) {
+        side *= 2;
+    }
+    hilbert_tile_t *tiles = malloc(sizeof(hilbert_tile_t) * (csr->node_count > 0 ? csr->node_count : 1));
+    int count = 0;
+    for (int i = 0; i < maze->rows; i++) {
+        for (int j = 0; j < maze->cols; j++) {
+            if (open[(long)i * maze->cols + j]) {
+                tiles[count].key = mazecsr_hilbert(side, i, j);
+                tiles[count].row = i;
+                tiles[count++].col = j;
+            }
+        }
+    }
+    qsort(tiles, count, sizeof(hilbert_tile_t), hilbert_tile_cmp);
+    for (int n = 0; n < count; n++) {
+        csr->node_row[n] = tiles[n].row;
+        csr->node_col[n] = tiles[n].col;
+        csr->node_of[(long)tiles[n].row * maze->cols + tiles[n].col] = n;
+    }
+    free(tiles);
+}
+
+mazecsr_t *mazecsr_from_maze(maze_t *maze, int order)
+// Creates the graph of the open tiles of `maze`, numbered in the given
+// order, one of CSR_ORDER_BFS or CSR_ORDER_HILBERT. A tile is open
+// unless maze_tile_blocked() reports it as blocked and its neighbors
+// are the open tiles one move away with the maze's movement. Returns
+// NULL if the maze has too many open tiles or moves for int indices.
+{
+    // Tiles are checked once here rather than on every visit as a
+    // tile_t is far larger than a byte
+    int delta_end = (maze->movement == MOVEMENT_8WAY) ? DELTA_COUNT_8WAY : DELTA_COUNT;
+    long tiles = (long)maze->rows * maze->cols;
+    unsigned char *is_open = malloc(tiles > 0 ? tiles : 1);
+    long open = 0;
+    for (int i = 0; i < maze->rows; i++) {
+        for (int j = 0; j < maze->cols; j++) {
+            is_open[(long)i * maze->cols + j] = !maze_tile_blocked(maze, i, j);
+            open += is_open[(long)i * maze->cols + j];
+        }
+    }
+    if (open * (delta_end - DELTA_START) > INT_MAX) {
+        free(is_open);
+        return NULL;
+    }
+    mazecsr_t *csr = malloc(sizeof(mazecsr_t));
+    csr->rows = maze->rows;
+    csr->cols = maze->cols;
+    csr->movement = maze->movement;
+    csr->order = order;
+    csr->node_count = open;
+    csr->node_row = malloc(sizeof(int) * (open > 0 ? open : 1));
+    csr->node_col = malloc(sizeof(int) * (open > 0 ? open : 1));
+    csr->node_of = malloc(sizeof(int) * (tiles > 0 ? tiles : 1));
+    for (long k = 0; k < tiles; k++) {
+        csr->node_of[k] = -1;
+    }
+    if (order == CSR_ORDER_HILBERT) {
+        mazecsr_number_hilbert(csr, maze, is_open);
+    } else {
+        mazecsr_number_bfs(csr, maze, is_open, delta_end);
+    }
+
+    // Count the neighbors of each node, then fill them in a second
+    // pass; both passes go through tiles in row-major order so the
+    // tiles and their neighbors are read sequentially whatever the
+    // numbering
+    csr->first = malloc(sizeof(int) * (open + 1));
+    csr->first[0] = 0;
+    for (int i = 0; i < maze->rows; i++) {
+        for (int j = 0; j < maze->cols; j++) {
+            int n = csr->node_of[(long)i * maze->cols + j];
+            if (n < 0) {
+                continue;
+            }
+            int degree = 0;
+            for (int d = DELTA_START; d < delta_end; d++) {
+                degree += mazecsr_node(csr, i + row_delta[d], j + col_delta[d]) >= 0;
+            }
+            csr->first[n + 1] = degree;
+        }
+    }
+    for (int n = 0; n < open; n++) {
+        csr->first[n + 1] += csr->first[n];
+    }
+    csr->targets = malloc(sizeof(int) * (csr->first[open] > 0 ? csr->first[open] : 1));
+    for (int i = 0; i < maze->rows; i++) {
+        for (int j = 0; j < maze->cols; j++) {
+            int n = csr->node_of[(long)i * maze->cols + j];
+            if (n < 0) {
+                continue;
+            }
+            int e = csr->first[n];
+            for (int d = DELTA_START; d < delta_end; d++) {
+                int target = mazecsr_node(csr, i + row_delta[d], j + col_delta[d]);
+                if (target >= 0) {
+                    csr->targets[e++] = target;
+                }
+            }
+        }
+    }
+    free(is_open);
+    return csr;
+}
+
+void mazecsr_free(mazecsr_t *csr)
+// De-allocates `csr` and its arrays. Does nothing if csr is NULL.
+{
+    if (csr == NULL) {
+        return;
+    }
+    free(csr->first);
+    free(csr->targets);
+    free(csr->node_row);
+    free(csr->node_col);
+    free(csr->node_of);
+    free(csr);
+}
+
+int mazecsr_node(mazecsr_t *csr, int row, int col)
+// Returns the node of tile row/col or -1 if the tile is out of bounds
+// or blocked.
+{
+    if (row < 0 || row >= csr->rows || col < 0 || col >= csr->cols) {
+        return -1;
+    }
+    return csr->node_of[(long)row * csr->cols + col];
+}
+
+static int mazecsr_search(mazecsr_t *csr, int source, int target, int *dist, int *parent)
+// BFS of `csr` from node `source` which stops once node `target` is
+// reached or, if target is -1, once every node reachable is. Fills
+// `dist` and, if it is not NULL, `parent` as mazecsr_bfs() does; nodes
+// not reached before stopping have distance -1. Returns the number of
+// nodes reached.
+{
+    for (int n = 0; n < csr->node_count; n++) {
+        dist[n] = -1;
+    }
+    if (source < 0 || source >= csr->node_count) {
+        return 0;
+    }
+    int *queue = malloc(sizeof(int) * csr->node_count);
+    int front = 0, rear = 0;
+    dist[source] = 0;
+    if (parent != NULL) {
+        parent[source] = -1;
+    }
+    queue[rear++] = source;
+    while (front < rear && (target < 0 || dist[target] < 0)) {
+        int n = queue[front++];
+        int next_dist = dist[n] + 1;
+        for (int e = csr->first[n]; e < csr->first[n + 1]; e++) {
+            int m = csr->targets[e];
+            if (dist[m] == -1) {
+                dist[m] = next_dist;
+                if (parent != NULL) {
+                    parent[m] = n;
+                }
+                queue[rear++] = m;
+            }
+        }
+    }
+    free(queue);
+    return rear;
+}
+
+int mazecsr_bfs(mazecsr_t *csr, int source, int *dist, int *parent)
+// Breadth-first search of `csr` from node `source` which fills `dist`
+// with the number of moves from the source to every node or -1 for
+// nodes that cannot be reached. If `parent` is not NULL it is filled
+// with the node each reached node was reached from, -1 for the
+// source. Both arrays have csr->node_count elements. Returns the
+// number of nodes reached including the source or 0 if source is not
+// a node.
+//
+// NOTES: The queue is a plain array of node numbers which each node
+// enters at most once. Expanding a node reads its consecutive entries
+// of targets with no wall or bounds checks.
+{
+    return mazecsr_search(csr, source, -1, dist, parent);
+}
+
+direction_t *mazecsr_shortest_path(mazecsr_t *csr, int start_row, int start_col,
+                                   int end_row, int end_col, long *lenp)
+// Finds a shortest path from start_row/col to end_row/col with a BFS
+// of `csr` that stops when the end is reached. Returns a malloc()'d
+// array of the directions of the path and stores its length in *lenp
+// or returns NULL if either tile is blocked or no path exists. The
+// path is the one maze_bfs_iterate() finds as neighbors are searched
+// in the same order.
+{
+    int start = mazecsr_node(csr, start_row, start_col);
+    int end = mazecsr_node(csr, end_row, end_col);
+    if (start < 0 || end < 0) {
+        return NULL;
+    }
+    int *dist = malloc(sizeof(int) * csr->node_count);
+    int *parent = malloc(sizeof(int) * csr->node_count);
+    mazecsr_search(csr, start, end, dist, parent);
+    int len = dist[end];
+    direction_t *path = NULL;
+    if (len >= 0) {
+        // Walk back through the parents, turning each step between
+        // node tiles back into a direction
+        path = malloc(sizeof(direction_t) * (len > 0 ? len : 1));
+        int n = end;
+        for (int k = len - 1; k >= 0; k--) {
+            int p = parent[n];
+            int drow = csr->node_row[n] - csr->node_row[p];
+            int dcol = csr->node_col[n] - csr->node_col[p];
+            for (int d = DELTA_START; d < DELTA_COUNT_8WAY; d++) {
+                if (row_delta[d] == drow && col_delta[d] == dcol) {
+                    path[k] = dir_delta[d];
+                }
+            }
+            n = p;
+        }
+        *lenp = len;
+    }
+    free(dist);
+    free(parent);
+    return path;
+}
+
+int maze_solve_csr(maze_t *maze, mazecsr_t *csr)
+// Solves `maze` by a BFS of `csr`, built from it by
+// mazecsr_from_maze(), in place of maze_bfs_iterate(). The shortest
+// path from START to END is stored in the path field of the END tile
+// which is marked FOUND so that maze_set_solution() can follow it.
+// Returns 1 if a path was found and 0 otherwise.
+{
+    long len;
+    direction_t *path = mazecsr_shortest_path(csr, maze->start_row, maze->start_col,
+                                              maze->end_row, maze->end_col, &len);
+    if (path == NULL) {
+        return 0;
+    }
+    tile_t *end_tile = &maze->tiles[maze->end_row][maze->end_col];
+    free(end_tile->path);
+    free(end_tile->packed);
+    end_tile->packed = NULL;
+    end_tile->path = path;
+    end_tile->path_len = len;
+    end_tile->state = FOUND;
+    maze_note_path(maze, maze->end_row, maze->end_col);
+    if (LOG_LEVEL >= LOG_BFS_STEPS) {
+        printf("LOG: open tile graph path of length %ld\n", len);
+    }
+    return 1;
+}
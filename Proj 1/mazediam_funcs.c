@@ -0,0 +1,201 @@
+#include "mazesolve.h"
+#include <limits.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Diameter of a maze with few BFS passes
+//
+// The diameter is the largest distance between two tiles that can
+// reach each other. Running a BFS from every tile finds it but takes
+// time quadratic in the number of tiles. The iFUB algorithm (iterative
+// Fringe Upper Bound) usually needs only a few BFS passes: from a
+// tile u near the middle of the maze, any two tiles at distance at
+// most i from u are within 2i of each other, so after finding the
+// largest eccentricity among the tiles farthest from u, the tiles
+// nearer to u only need to be searched while 2i could still exceed
+// the best diameter found so far.
+////////////////////////////////////////////////////////////////////////////////
+
+static int mazediam_sweep(mazegrid_t *grid, int row, int col, int *dist,
+                          int *far_rowp, int *far_colp, int *ecc_lo, int *ecc_hi)
+// Runs a BFS from row/col, filling `dist` as mazegrid_bfs() does, and
+// returns the eccentricity of the tile: the distance to the farthest
+// tile it reaches, whose coordinates are stored in *far_rowp and
+// *far_colp. If ecc_lo and ecc_hi are not NULL, the bounds of every
+// reached tile v are tightened with ecc(v) >= max(d, ecc - d) and
+// ecc(v) <= ecc + d where d is its distance from row/col.
+{
+    mazegrid_bfs(grid, row, col, dist);
+    int ecc = 0;
+    *far_rowp = row;
+    *far_colp = col;
+    for (int i = 0; i < grid->rows; i++) {
+        for (int j = 0; j < grid->cols; j++) {
+            int d = dist[mazegrid_index(grid, i, j)];
+            if (d > ecc) {
+                ecc = d;
+                *far_rowp = i;
+                *far_colp = j;
+            }
+        }
+    }
+    if (ecc_lo != NULL && ecc_hi != NULL) {
+        for (int i = 0; i < grid->rows; i++) {
+            for (int j = 0; j < grid->cols; j++) {
+                long idx = mazegrid_index(grid, i, j);
+                int d = dist[idx];
+                if (d < 0) {
+                    continue;
+                }
+                int lo = (d > ecc - d) ? d : ecc - d;
+                ecc_lo[idx] = (lo > ecc_lo[idx]) ? lo : ecc_lo[idx];
+                ecc_hi[idx] = (ecc + d < ecc_hi[idx]) ? ecc + d : ecc_hi[idx];
+            }
+        }
+    }
+    return ecc;
+}
+
+static void mazediam_midpoint(mazegrid_t *grid, int *dist, int row, int col,
+                              int *mid_rowp, int *mid_colp)
+// Walks back from row/col along decreasing `dist` from a BFS and
+// stores in *mid_rowp and *mid_colp the tile halfway along the
+// shortest path to the BFS origin.
+{
+    int delta_end = (grid->movement == MOVEMENT_8WAY) ? DELTA_COUNT_8WAY : DELTA_COUNT;
+    int half = dist[mazegrid_index(grid, row, col)] / 2;
+    while (dist[mazegrid_index(grid, row, col)] > half) {
+        int here = dist[mazegrid_index(grid, row, col)];
+        for (int d = DELTA_START; d < delta_end; d++) {
+            int nrow = row + row_delta[d];
+            int ncol = col + col_delta[d];
+            if (grid->cells[mazegrid_index(grid, nrow, ncol)] == GRID_OPEN &&
+                dist[mazegrid_index(grid, nrow, ncol)] == here - 1) {
+                row = nrow;
+                col = ncol;
+                break;
+            }
+        }
+    }
+    *mid_rowp = row;
+    *mid_colp = col;
+}
+
+long mazegrid_diameter(mazegrid_t *grid, int row, int col, int *sweepsp,
+                       int *ecc_lo, int *ecc_hi)
+// Returns the exact diameter of the part of `grid` reachable from
+// row/col, or -1 if that tile is not open, and stores the number of
+// BFS passes used in *sweepsp. If ecc_lo and ecc_hi are not NULL they
+// must have grid->ncells elements laid out like the grid cells; they
+// are filled with lower and upper bounds on the eccentricity of each
+// reachable tile found from the passes made, and -1 for other tiles.
+//
+// NOTES: A 4-sweep picks the tile u: two double sweeps, each a BFS
+// from a tile and then from the farthest tile it reached, with the
+// second starting from the middle of the path found by the first. The
+// two far eccentricities are lower bounds on the diameter and u is
+// the middle of the second path. A BFS from u then orders tiles by
+// their distance from u and iFUB searches from the farthest tiles
+// inward, stopping once no tile nearer to u can improve the bound.
+{
+    *sweepsp = 0;
+    if (!mazegrid_open(grid, row, col)) {
+        // Nothing is reachable so every tile gets the unreached bounds
+        if (ecc_lo != NULL && ecc_hi != NULL) {
+            for (long i = 0; i < grid->ncells; i++) {
+                ecc_lo[i] = ecc_hi[i] = -1;
+            }
+        }
+        return -1;
+    }
+    int *dist = malloc(sizeof(int) * grid->ncells);
+    int *lo = ecc_lo, *hi = ecc_hi;
+    if (ecc_lo == NULL || ecc_hi == NULL) {
+        lo = malloc(sizeof(int) * grid->ncells);
+        hi = malloc(sizeof(int) * grid->ncells);
+    }
+    for (long i = 0; i < grid->ncells; i++) {
+        lo[i] = 0;
+        hi[i] = INT_MAX;
+    }
+
+    // 4-sweep for a lower bound and a central tile
+    int a_row, a_col, b_row, b_col, u_row, u_col;
+    mazediam_sweep(grid, row, col, dist, &a_row, &a_col, lo, hi);
+    long lower = mazediam_sweep(grid, a_row, a_col, dist, &b_row, &b_col, lo, hi);
+    mazediam_midpoint(grid, dist, b_row, b_col, &u_row, &u_col);
+    mazediam_sweep(grid, u_row, u_col, dist, &a_row, &a_col, lo, hi);
+    int ecc = mazediam_sweep(grid, a_row, a_col, dist, &b_row, &b_col, lo, hi);
+    lower = (ecc > lower) ? ecc : lower;
+    mazediam_midpoint(grid, dist, b_row, b_col, &u_row, &u_col);
+    int ecc_u = mazediam_sweep(grid, u_row, u_col, dist, &a_row, &a_col, lo, hi);
+    lower = (ecc_u > lower) ? ecc_u : lower;
+    *sweepsp = 5;
+
+    // Order the reachable tiles by distance from u, farthest first
+    long *first = calloc(ecc_u + 2, sizeof(long));
+    for (int i = 0; i < grid->rows; i++) {
+        for (int j = 0; j < grid->cols; j++) {
+            int d = dist[mazegrid_index(grid, i, j)];
+            if (d >= 0) {
+                first[ecc_u - d + 1]++;
+            }
+        }
+    }
+    for (int level = 0; level <= ecc_u; level++) {
+        first[level + 1] += first[level];
+    }
+    long count = first[ecc_u + 1];
+    int *fringe = malloc(sizeof(int) * 2 * (count > 0 ? count : 1));
+    for (int i = 0; i < grid->rows; i++) {
+        for (int j = 0; j < grid->cols; j++) {
+            int d = dist[mazegrid_index(grid, i, j)];
+            if (d >= 0) {
+                long pos = first[ecc_u - d]++;
+                fringe[2 * pos] = i;
+                fringe[2 * pos + 1] = j;
+            }
+        }
+    }
+
+    // Search from the farthest tiles inward a whole level at a time.
+    // Tiles at distance i from u are within 2i of each other, so once
+    // the lower bound reaches 2i the levels from i inward cannot hold
+    // an end of a longer path. Tiles whose eccentricity bound from
+    // earlier passes is no more than the lower bound are skipped.
+    int *sweep_dist = malloc(sizeof(int) * grid->ncells);
+    long pos = 0;
+    for (int level = ecc_u; level > 0 && lower < 2L * level; level--) {
+        for (; pos < count &&
+                 dist[mazegrid_index(grid, fringe[2 * pos], fringe[2 * pos + 1])] == level; pos++) {
+            if (hi[mazegrid_index(grid, fringe[2 * pos], fringe[2 * pos + 1])] <= lower) {
+                continue;
+            }
+            int far_row, far_col;
+            int e = mazediam_sweep(grid, fringe[2 * pos], fringe[2 * pos + 1], sweep_dist,
+                                   &far_row, &far_col, lo, hi);
+            lower = (e > lower) ? e : lower;
+            (*sweepsp)++;
+        }
+    }
+    free(sweep_dist);
+    free(fringe);
+    free(first);
+    free(dist);
+    // No eccentricity exceeds the diameter
+    if (lo == ecc_lo) {
+        for (int i = 0; i < grid->rows; i++) {
+            for (int j = 0; j < grid->cols; j++) {
+                long idx = mazegrid_index(grid, i, j);
+                if (hi[idx] == INT_MAX) {
+                    lo[idx] = hi[idx] = -1;
+                } else if (hi[idx] > lower) {
+                    hi[idx] = lower;
+                }
+            }
+        }
+    } else {
+        free(lo);
+        free(hi);
+    }
+    return lower;
+}
@@ -0,0 +1,341 @@
+#include "mazesolve.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// minheap_t: binary heap of keyed items
+////////////////////////////////////////////////////////////////////////////////
+
+minheap_t *minheap_allocate(int capacity)
+// Allocates an empty heap with room for `capacity` entries; the heap
+// grows as needed when more are pushed.
+{
+    minheap_t *heap = malloc(sizeof(minheap_t));
+    heap->capacity = (capacity > 0) ? capacity : 16;
+    heap->count = 0;
+    heap->entries = malloc(sizeof(heapentry_t) * heap->capacity);
+    return heap;
+}
+
+void minheap_push(minheap_t *heap, long key, int item)
+// Adds `item` with priority `key` to the heap. Searches push an item
+// again when its key improves rather than updating it in place and
+// skip the stale copies when they are popped.
+{
+    if (heap->count == heap->capacity) {
+        heap->capacity *= 2;
+        heap->entries = realloc(heap->entries, sizeof(heapentry_t) * heap->capacity);
+    }
+    // Sift the new entry up from the bottom of the heap
+    int i = heap->count++;
+    while (i > 0 && heap->entries[(i - 1) / 2].key > key) {
+        heap->entries[i] = heap->entries[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap->entries[i].key = key;
+    heap->entries[i].item = item;
+}
+
+int minheap_pop(minheap_t *heap, long *keyp, int *itemp)
+// Removes the entry with the smallest key, setting *keyp and *itemp
+// to its key and item. Returns 0 if the heap is empty and 1
+// otherwise.
+{
+    if (heap->count == 0) {
+        return 0;
+    }
+    *keyp = heap->entries[0].key;
+    *itemp = heap->entries[0].item;
+
+    // Sift the last entry down from the top of the heap
+    heapentry_t last = heap->entries[--heap->count];
+    int i = 0;
+    while (2 * i + 1 < heap->count) {
+        int child = 2 * i + 1;
+        if (child + 1 < heap->count &&
+            heap->entries[child + 1].key < heap->entries[child].key) {
+            child++;
+        }
+        if (heap->entries[child].key >= last.key) {
+            break;
+        }
+        heap->entries[i] = heap->entries[child];
+        i = child;
+    }
+    heap->entries[i] = last;
+    return 1;
+}
+
+void minheap_free(minheap_t *heap)
+// De-allocates `heap`. Does nothing if heap is NULL.
+{
+    if (heap == NULL) {
+        return;
+    }
+    free(heap->entries);
+    free(heap);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// mazegraph_t: corridors contracted into weighted edges
+//
+// In mazes that are mostly corridors, BFS spends nearly all its time
+// stepping along tiles with exactly two open neighbors. The graph
+// built here keeps only the tiles where a choice is made (junctions),
+// dead ends, and START/END tiles. Searches run Dijkstra on this much
+// smaller graph and the corridors of the result are expanded back
+// into the moves of a path.
+////////////////////////////////////////////////////////////////////////////////
+
+static int mazegraph_degree(maze_t *maze, int row, int col, int delta_end)
+// Returns the number of neighbors of row/col that are not blocked.
+{
+    int count = 0;
+    for (int d = DELTA_START; d < delta_end; d++) {
+        count += !maze_tile_blocked(maze, row + row_delta[d], col + col_delta[d]);
+    }
+    return count;
+}
+
+static void mazegraph_add_move(mazegraph_t *graph, graphedge_t *edge,
+                               direction_t dir, long *run_capacity)
+// Appends a move to `edge`, the last edge of `graph`, extending its
+// last run if it is in the same direction.
+{
+    if (edge->run_count > 0 && graph->runs[graph->run_count - 1].dir == dir) {
+        graph->runs[graph->run_count - 1].count++;
+    } else {
+        if (graph->run_count == *run_capacity) {
+            *run_capacity *= 2;
+            graph->runs = realloc(graph->runs, sizeof(dirrun_t) * *run_capacity);
+        }
+        graph->runs[graph->run_count].dir = dir;
+        graph->runs[graph->run_count].count = 1;
+        graph->run_count++;
+        edge->run_count++;
+    }
+    edge->length++;
+}
+
+mazegraph_t *mazegraph_from_maze(maze_t *maze)
+// Compiles the tiles of `maze` into a junction graph. Every open tile
+// which does not have exactly two open neighbors, or is a START or
+// END tile, becomes a node. From each node, each open neighbor starts
+// a corridor which is followed through tiles with two open neighbors
+// until it reaches another node; the corridor becomes an edge with
+// its length and runs of directions. Neighbors follow the maze
+// movement. Open tiles in loops with no node are not part of the
+// graph as no path between nodes passes through them. Returns NULL
+// for mazes too large for int node, edge, and run numbers.
+//
+// NOTES: Every tile can leave by each of its neighbors at most once
+// and each corridor tile is walked once in each direction, so edges
+// and runs are bounded by the tiles times two more than the neighbors
+// of a tile. Mazes past that bound are rejected before anything is
+// allocated, as mazecsr_from_maze() does.
+{
+    int delta_end = (maze->movement == MOVEMENT_8WAY) ? DELTA_COUNT_8WAY : DELTA_COUNT;
+    long ntiles = (long)maze->rows * maze->cols;
+    if (ntiles * (delta_end - DELTA_START + 2) > INT_MAX) {
+        return NULL;
+    }
+    mazegraph_t *graph = malloc(sizeof(mazegraph_t));
+    graph->rows = maze->rows;
+    graph->cols = maze->cols;
+    graph->node_of = malloc(sizeof(int) * (ntiles > 0 ? ntiles : 1));
+
+    // Number the nodes in row-major order
+    int node_count = 0;
+    for (int i = 0; i < maze->rows; i++) {
+        for (int j = 0; j < maze->cols; j++) {
+            tile_t *tile = &maze->tiles[i][j];
+            int node = tile->type != WALL &&
+                (tile->type == START || tile->type == END ||
+                 mazegraph_degree(maze, i, j, delta_end) != 2);
+            graph->node_of[(long)i * maze->cols + j] = node ? node_count++ : -1;
+        }
+    }
+    graph->node_count = node_count;
+    graph->nodes = malloc(sizeof(graphnode_t) * (node_count > 0 ? node_count : 1));
+
+    // Follow the corridor in each open direction from every node
+    long edge_capacity = 16, run_capacity = 16;
+    graph->edges = malloc(sizeof(graphedge_t) * edge_capacity);
+    graph->runs = malloc(sizeof(dirrun_t) * run_capacity);
+    graph->edge_count = 0;
+    graph->run_count = 0;
+    for (int i = 0; i < maze->rows; i++) {
+        for (int j = 0; j < maze->cols; j++) {
+            int n = graph->node_of[(long)i * maze->cols + j];
+            if (n < 0) {
+                continue;
+            }
+            graphnode_t *node = &graph->nodes[n];
+            node->row = i;
+            node->col = j;
+            node->first_edge = graph->edge_count;
+            node->edge_count = 0;
+            for (int d = DELTA_START; d < delta_end; d++) {
+                int row = i + row_delta[d];
+                int col = j + col_delta[d];
+                if (maze_tile_blocked(maze, row, col)) {
+                    continue;
+                }
+                if (graph->edge_count == edge_capacity) {
+                    edge_capacity *= 2;
+                    graph->edges = realloc(graph->edges, sizeof(graphedge_t) * edge_capacity);
+                }
+                graphedge_t *edge = &graph->edges[graph->edge_count++];
+                edge->length = 0;
+                edge->first_run = graph->run_count;
+                edge->run_count = 0;
+                mazegraph_add_move(graph, edge, dir_delta[d], &run_capacity);
+
+                // Step along corridor tiles, leaving each by the
+                // neighbor that is not the tile just left
+                int prev_row = i, prev_col = j;
+                while (graph->node_of[(long)row * maze->cols + col] < 0) {
+                    int e;
+                    for (e = DELTA_START; e < delta_end; e++) {
+                        int nrow = row + row_delta[e];
+                        int ncol = col + col_delta[e];
+                        if ((nrow != prev_row || ncol != prev_col) &&
+                            !maze_tile_blocked(maze, nrow, ncol)) {
+                            break;
+                        }
+                    }
+                    mazegraph_add_move(graph, edge, dir_delta[e], &run_capacity);
+                    prev_row = row;
+                    prev_col = col;
+                    row += row_delta[e];
+                    col += col_delta[e];
+                }
+                edge->target = graph->node_of[(long)row * maze->cols + col];
+                node->edge_count++;
+            }
+        }
+    }
+    return graph;
+}
+
+void mazegraph_free(mazegraph_t *graph)
+// De-allocates `graph` and its arrays. Does nothing if graph is NULL.
+{
+    if (graph == NULL) {
+        return;
+    }
+    free(graph->nodes);
+    free(graph->edges);
+    free(graph->runs);
+    free(graph->node_of);
+    free(graph);
+}
+
+direction_t *mazegraph_shortest_path(mazegraph_t *graph, int start_row, int start_col,
+                                     int end_row, int end_col, long *lenp)
+// Finds a shortest path between the tiles at start_row/col and
+// end_row/col, both of which must be nodes of `graph` such as START
+// and END tiles. Runs Dijkstra's algorithm over the nodes with
+// corridor lengths as edge weights, then expands the runs of each
+// edge on the shortest route into a malloc()'d array of directions
+// like the path field of a tile. Sets *lenp to the number of moves
+// and returns the array, or returns NULL with *lenp set to -1 if
+// either tile is not a node or the end cannot be reached.
+{
+    *lenp = -1;
+    if (start_row < 0 || start_row >= graph->rows || start_col < 0 || start_col >= graph->cols ||
+        end_row < 0 || end_row >= graph->rows || end_col < 0 || end_col >= graph->cols) {
+        return NULL;
+    }
+    int source = graph->node_of[(long)start_row * graph->cols + start_col];
+    int target = graph->node_of[(long)end_row * graph->cols + end_col];
+    if (source < 0 || target < 0) {
+        return NULL;
+    }
+
+    // Dijkstra from the source; parent/parent_edge record the node
+    // and edge by which each node is reached at its best distance
+    long *dist = malloc(sizeof(long) * graph->node_count);
+    int *parent = malloc(sizeof(int) * graph->node_count);
+    int *parent_edge = malloc(sizeof(int) * graph->node_count);
+    for (int n = 0; n < graph->node_count; n++) {
+        dist[n] = -1;
+        parent[n] = -1;
+        parent_edge[n] = -1;
+    }
+    minheap_t *heap = minheap_allocate(graph->node_count);
+    dist[source] = 0;
+    minheap_push(heap, 0, source);
+    long key;
+    int n;
+    while (minheap_pop(heap, &key, &n)) {
+        if (key != dist[n]) {
+            continue;           // stale entry for an improved node
+        }
+        if (n == target) {
+            break;
+        }
+        graphnode_t *node = &graph->nodes[n];
+        for (int e = node->first_edge; e < node->first_edge + node->edge_count; e++) {
+            graphedge_t *edge = &graph->edges[e];
+            long next = key + edge->length;
+            if (dist[edge->target] < 0 || next < dist[edge->target]) {
+                dist[edge->target] = next;
+                parent[edge->target] = n;
+                parent_edge[edge->target] = e;
+                minheap_push(heap, next, edge->target);
+            }
+        }
+    }
+    minheap_free(heap);
+
+    // Expand the edges from the target back to the source in reverse,
+    // filling the path from its end
+    direction_t *path = NULL;
+    if (dist[target] >= 0) {
+        *lenp = dist[target];
+        path = malloc(sizeof(direction_t) * (*lenp > 0 ? *lenp : 1));
+        long pos = *lenp;
+        for (int t = target; t != source; t = parent[t]) {
+            graphedge_t *edge = &graph->edges[parent_edge[t]];
+            pos -= edge->length;
+            long p = pos;
+            for (int r = edge->first_run; r < edge->first_run + edge->run_count; r++) {
+                for (int k = 0; k < graph->runs[r].count; k++) {
+                    path[p++] = graph->runs[r].dir;
+                }
+            }
+        }
+    }
+    free(dist);
+    free(parent);
+    free(parent_edge);
+    return path;
+}
+
+int maze_solve_graph(maze_t *maze, mazegraph_t *graph)
+// Solves `maze` using its junction graph `graph`, built by
+// mazegraph_from_maze(), in place of maze_bfs_iterate(). The shortest
+// path from START to END is stored in the path field of the END tile
+// which is marked FOUND so that maze_set_solution() can follow it.
+// Returns 1 if a path was found and 0 otherwise. Paths have the same
+// length as those found by BFS but may take a different route among
+// equally short ones.
+{
+    long len;
+    direction_t *path = mazegraph_shortest_path(graph, maze->start_row, maze->start_col,
+                                                maze->end_row, maze->end_col, &len);
+    if (path == NULL) {
+        return 0;
+    }
+    tile_t *end_tile = &maze->tiles[maze->end_row][maze->end_col];
+    free(end_tile->path);
+    free(end_tile->packed);
+    end_tile->packed = NULL;
+    end_tile->path = path;
+    end_tile->path_len = len;
+    end_tile->state = FOUND;
+    maze_note_path(maze, maze->end_row, maze->end_col);
+    if (LOG_LEVEL >= LOG_BFS_STEPS) {
+        printf("LOG: junction graph path of length %ld\n", len);
+    }
+    return 1;
+}
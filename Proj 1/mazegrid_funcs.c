@@ -0,0 +1,480 @@
+#include "mazesolve.h"
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// mazegrid_t: compact maze copy for fast searches
+//
+// The maze_t tile array is kept row-major with a tile_t per position
+// as its tiles[row][col] form is used throughout the program. For
+// large searches the functions here copy the maze into a grid of one
+// byte per tile which may also be stored in 8x8 blocks so that a tile
+// and its NORTH/SOUTH neighbors usually share a cache line. All
+// access to cells goes through mazegrid_index() so the search code is
+// the same for either layout. A border of GRID_WALL cells surrounds
+// the tiles so searches never need to check bounds.
+//
+// Only searches on a mazegrid_t use the blocked layout: the -diameter,
+// -paths, and -queries modes. Searches on maze_t tiles such as
+// maze_bfs_iterate() stay row-major. "mazesolve_bench layout" reports
+// cache misses of both layouts, from hardware counters where
+// available and otherwise from a model of an L2 cache; the blocked
+// layout only has fewer misses once rows are wider than the cache
+// holds a few of.
+////////////////////////////////////////////////////////////////////////////////
+
+mazegrid_t *mazegrid_allocate(int rows, int cols, int layout)
+// Allocates a grid with the given rows/cols and layout with every
+// tile set to GRID_WALL. Cells are allocated for rows+2 by cols+2
+// tiles to include the border and, for the blocked layout, rounded up
+// to whole 8x8 blocks; border and padding cells remain walls.
+{
+    mazegrid_t *grid = malloc(sizeof(mazegrid_t));
+    grid->rows = rows;
+    grid->cols = cols;
+    grid->layout = layout;
+    grid->movement = MOVEMENT_4WAY;
+    grid->block_cols = (cols + 2 + GRID_BLOCK_MASK) >> GRID_BLOCK_SHIFT;
+    if (layout == GRID_LAYOUT_BLOCKED) {
+        long block_rows = (rows + 2 + GRID_BLOCK_MASK) >> GRID_BLOCK_SHIFT;
+        grid->ncells = (block_rows * grid->block_cols) << (2 * GRID_BLOCK_SHIFT);
+    } else {
+        grid->ncells = (long)(rows + 2) * (cols + 2);
+    }
+    grid->cells = calloc(grid->ncells > 0 ? grid->ncells : 1, sizeof(unsigned char));
+    return grid;
+}
+
+mazegrid_t *mazegrid_from_maze(maze_t *maze, int layout)
+// Creates a grid from the tiles of `maze` in the given layout. Tiles
+// that maze_tile_blocked() reports as blocked become GRID_WALL and
+// all others GRID_OPEN. The grid uses the movement of the maze.
+{
+    mazegrid_t *grid = mazegrid_allocate(maze->rows, maze->cols, layout);
+    grid->movement = maze->movement;
+    for (int i = 0; i < maze->rows; i++) {
+        for (int j = 0; j < maze->cols; j++) {
+            grid->cells[mazegrid_index(grid, i, j)] =
+                maze_tile_blocked(maze, i, j) ? GRID_WALL : GRID_OPEN;
+        }
+    }
+    return grid;
+}
+
+void mazegrid_free(mazegrid_t *grid)
+// De-allocates `grid` and its cells. Does nothing if grid is NULL.
+{
+    if (grid == NULL) {
+        return;
+    }
+    free(grid->cells);
+    free(grid);
+}
+
+int mazegrid_open(mazegrid_t *grid, int row, int col)
+// Returns 1 if row/col is in bounds for `grid` and the tile there is
+// GRID_OPEN and 0 otherwise.
+{
+    if (row < 0 || row >= grid->rows || col < 0 || col >= grid->cols) {
+        return 0;
+    }
+    return grid->cells[mazegrid_index(grid, row, col)] == GRID_OPEN;
+}
+
+long mazegrid_bfs(mazegrid_t *grid, int start_row, int start_col, int *dist)
+// Breadth-first search of `grid` from start_row/start_col which
+// fills `dist` with the number of moves from the start to every tile
+// or -1 for tiles that cannot be reached. The `dist` array must have
+// grid->ncells elements and is laid out like the grid cells so that
+// dist[mazegrid_index(grid,r,c)] is the distance to tile (r,c).
+// Neighbors are visited in the order of dir_delta[] as in
+// maze_bfs_step(). Returns the number of tiles reached including the
+// start or 0 if the start is not an open tile.
+//
+// NOTES: The queue is a plain array of row/col pairs; each tile is
+// queued at most once so rows*cols pairs always suffice. Thanks to
+// the border, expanding a tile only checks whether each neighbor is
+// open and unreached.
+{
+    for (long i = 0; i < grid->ncells; i++) {
+        dist[i] = -1;
+    }
+    if (!mazegrid_open(grid, start_row, start_col)) {
+        return 0;
+    }
+    int delta_end = (grid->movement == MOVEMENT_8WAY) ? DELTA_COUNT_8WAY : DELTA_COUNT;
+    int *queue = malloc(sizeof(int) * 2 * ((long)grid->rows * grid->cols));
+    long front = 0, rear = 0;
+
+    // Seed the queue with the start tile at distance 0
+    dist[mazegrid_index(grid, start_row, start_col)] = 0;
+    queue[rear++] = start_row;
+    queue[rear++] = start_col;
+
+    // Expand tiles in queue order, giving unreached open neighbors the
+    // next distance and queueing them
+    while (front < rear) {
+        int row = queue[front++];
+        int col = queue[front++];
+        int next_dist = dist[mazegrid_index(grid, row, col)] + 1;
+        for (int d = DELTA_START; d < delta_end; d++) {
+            int nrow = row + row_delta[d];
+            int ncol = col + col_delta[d];
+            long nidx = mazegrid_index(grid, nrow, ncol);
+            if (grid->cells[nidx] == GRID_OPEN && dist[nidx] == -1) {
+                dist[nidx] = next_dist;
+                queue[rear++] = nrow;
+                queue[rear++] = ncol;
+            }
+        }
+    }
+    free(queue);
+    return rear / 2;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Multi-source BFS
+//
+// Distances from many sources are found by advancing up to 64 BFS
+// searches together, one bit of a 64-bit word per source. Each tile
+// has a mask of the sources that have reached it and a mask of the
+// sources for which it is on the current frontier. Expanding a tile
+// passes its whole frontier mask to each neighbor with a few word
+// operations so sources that reach a tile at the same distance share
+// the work of expanding it. That happens most for sources near each
+// other; sources spread far apart reach most tiles at different
+// distances so each tile is still expanded about once per source,
+// and the wider masks make that slower than separate searches.
+//
+// Each batch is therefore searched bit-parallel only if its sources
+// lie within a bounding box whose rows plus cols are at most
+// MSBFS_SPREAD, and with one mazegrid_bfs() per source otherwise.
+// "mazesolve_bench msbfs" measured the crossover with 64 sources on
+// an 8x8 lattice: the full matrix was faster bit-parallel up to a
+// spread of 56 on 1024x1024 mazes and about 224 on 512x512 ones, so
+// the default of 64 searches separately from about where that stops.
+////////////////////////////////////////////////////////////////////////////////
+
+// Widest source spread searched bit-parallel; 0 searches every
+// source separately and INT_MAX always searches bit-parallel.
+int MSBFS_SPREAD = MSBFS_SPREAD_DEFAULT;
+
+int mazegrid_source_spread(mazegrid_t *grid, int count, int *rows, int *cols)
+// Returns the rows plus cols of the bounding box of the open tiles
+// among the `count` sources at rows[k]/cols[k], or 0 if there are
+// none, which mazegrid_msbfs() compares with MSBFS_SPREAD.
+{
+    int top = INT_MAX, bottom = -1, left = INT_MAX, right = -1;
+    for (int k = 0; k < count; k++) {
+        if (!mazegrid_open(grid, rows[k], cols[k])) {
+            continue;
+        }
+        top = (rows[k] < top) ? rows[k] : top;
+        bottom = (rows[k] > bottom) ? rows[k] : bottom;
+        left = (cols[k] < left) ? cols[k] : left;
+        right = (cols[k] > right) ? cols[k] : right;
+    }
+    return (bottom < 0) ? 0 : (bottom - top) + (right - left);
+}
+
+static long mazegrid_msbfs_batch(mazegrid_t *grid, unsigned char *open, int count,
+                                 int *rows, int *cols, int *dist)
+// Runs one batch of at most MSBFS_BATCH sources for mazegrid_msbfs().
+// The `open` array has GRID_OPEN/GRID_WALL for each tile of `grid` in
+// the row-major layout, with its border, so that every neighbor is a
+// fixed offset away whatever the layout of `grid`. Source k sets bit
+// k of the masks and fills dist[k*ncells + idx]. Returns the number
+// of source/tile pairs reached.
+{
+    long ncells = grid->ncells;
+    long stride = grid->cols + 2;
+    long nopen = (long)(grid->rows + 2) * stride;
+    int delta_end = (grid->movement == MOVEMENT_8WAY) ? DELTA_COUNT_8WAY : DELTA_COUNT;
+    long offset[DELTA_COUNT_8WAY];
+    for (int d = DELTA_START; d < delta_end; d++) {
+        offset[d] = row_delta[d] * stride + col_delta[d];
+    }
+    uint64_t *seen = calloc(nopen, sizeof(uint64_t));
+    uint64_t *visit = calloc(nopen, sizeof(uint64_t));
+    uint64_t *next = calloc(nopen, sizeof(uint64_t));
+    long *frontier = malloc(sizeof(long) * ((long)grid->rows * grid->cols + 1));
+    long *next_frontier = malloc(sizeof(long) * ((long)grid->rows * grid->cols + 1));
+    long frontier_len = 0, reached = 0;
+
+    // Each open source is reached by itself at distance 0; several
+    // sources may share a tile
+    for (int k = 0; k < count; k++) {
+        if (!mazegrid_open(grid, rows[k], cols[k])) {
+            continue;
+        }
+        long pos = (rows[k] + 1) * stride + cols[k] + 1;
+        long idx = mazegrid_index(grid, rows[k], cols[k]);
+        uint64_t bit = (uint64_t)1 << k;
+        if (visit[pos] == 0) {
+            frontier[frontier_len++] = pos;
+        }
+        visit[pos] |= bit;
+        seen[pos] |= bit;
+        dist[k * ncells + idx] = 0;
+        reached++;
+    }
+
+    // Advance all sources one level at a time. A tile joins the next
+    // frontier the first time it gains bits during a level.
+    for (int level = 1; frontier_len > 0; level++) {
+        long next_len = 0;
+        for (long f = 0; f < frontier_len; f++) {
+            long pos = frontier[f];
+            uint64_t bits = visit[pos];
+            visit[pos] = 0;
+            for (int d = DELTA_START; d < delta_end; d++) {
+                long npos = pos + offset[d];
+                uint64_t fresh = bits & ~seen[npos];
+                if (fresh == 0 || open[npos] != GRID_OPEN) {
+                    continue;
+                }
+                if (next[npos] == 0) {
+                    next_frontier[next_len++] = npos;
+                }
+                next[npos] |= fresh;
+                seen[npos] |= fresh;
+            }
+        }
+
+        // Record the level as the distance of each newly reached bit
+        for (long f = 0; f < next_len; f++) {
+            long pos = next_frontier[f];
+            uint64_t fresh = next[pos];
+            visit[pos] = fresh;
+            next[pos] = 0;
+            reached += __builtin_popcountll(fresh);
+            long idx = (grid->layout == GRID_LAYOUT_ROWMAJOR) ? pos :
+                mazegrid_index(grid, pos / stride - 1, pos % stride - 1);
+            for (; fresh != 0; fresh &= fresh - 1) {
+                dist[__builtin_ctzll(fresh) * ncells + idx] = level;
+            }
+        }
+        long *tmp = frontier;
+        frontier = next_frontier;
+        next_frontier = tmp;
+        frontier_len = next_len;
+    }
+    free(seen);
+    free(visit);
+    free(next);
+    free(frontier);
+    free(next_frontier);
+    return reached;
+}
+
+static unsigned char *mazegrid_open_rowmajor(mazegrid_t *grid)
+// Returns a malloc()'d copy of the cells of `grid` in the row-major
+// layout with its border, or the cells themselves if `grid` already
+// uses that layout.
+{
+    if (grid->layout == GRID_LAYOUT_ROWMAJOR) {
+        return grid->cells;
+    }
+    long stride = grid->cols + 2;
+    unsigned char *open = calloc((grid->rows + 2) * stride, 1);
+    for (int i = 0; i < grid->rows; i++) {
+        for (int j = 0; j < grid->cols; j++) {
+            open[(i + 1) * stride + j + 1] = grid->cells[mazegrid_index(grid, i, j)];
+        }
+    }
+    return open;
+}
+
+long mazegrid_msbfs(mazegrid_t *grid, int count, int *rows, int *cols, int *dist)
+// Finds the distances from each of `count` sources at rows[k]/cols[k]
+// to every tile of `grid`. The `dist` array must have count*ncells
+// elements: dist[k*grid->ncells + mazegrid_index(grid,r,c)] is set to
+// the distance from source k to tile (r,c) or -1 if it cannot be
+// reached, which is the case for every tile if the source is not
+// open. Sources are searched MSBFS_BATCH at a time, bit-parallel if
+// their spread is at most MSBFS_SPREAD and separately otherwise.
+// Returns the number of source/tile pairs reached.
+{
+    for (long i = 0; i < (long)count * grid->ncells; i++) {
+        dist[i] = -1;
+    }
+    unsigned char *open = mazegrid_open_rowmajor(grid);
+    long reached = 0;
+    for (int first = 0; first < count; first += MSBFS_BATCH) {
+        int batch = (count - first < MSBFS_BATCH) ? count - first : MSBFS_BATCH;
+        if (mazegrid_source_spread(grid, batch, rows + first, cols + first) > MSBFS_SPREAD) {
+            for (int k = first; k < first + batch; k++) {
+                reached += mazegrid_bfs(grid, rows[k], cols[k], dist + (long)k * grid->ncells);
+            }
+            continue;
+        }
+        reached += mazegrid_msbfs_batch(grid, open, batch, rows + first, cols + first,
+                                        dist + (long)first * grid->ncells);
+    }
+    if (open != grid->cells) {
+        free(open);
+    }
+    return reached;
+}
+
+void mazegrid_msbfs_to(mazegrid_t *grid, int count, int *rows, int *cols,
+                       int target_row, int target_col, int *target_dist)
+// Finds the distance from each of `count` sources at rows[k]/cols[k]
+// to the single tile target_row/col such as the END of a maze,
+// setting target_dist[k] to the distance or -1 if source k cannot
+// reach it. Distances are symmetric so a single mazegrid_bfs() from
+// the target answers every source: that needs memory for only one
+// distance field and "mazesolve_bench msbfs" found it faster than
+// the bit-parallel search at every source spread.
+{
+    for (int k = 0; k < count; k++) {
+        target_dist[k] = -1;
+    }
+    if (!mazegrid_open(grid, target_row, target_col)) {
+        return;
+    }
+    int *from_target = malloc(sizeof(int) * grid->ncells);
+    mazegrid_bfs(grid, target_row, target_col, from_target);
+    for (int k = 0; k < count; k++) {
+        if (mazegrid_open(grid, rows[k], cols[k])) {
+            target_dist[k] = from_target[mazegrid_index(grid, rows[k], cols[k])];
+        }
+    }
+    free(from_target);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Distance field files
+////////////////////////////////////////////////////////////////////////////////
+
+long maze_write_distances(maze_t *maze, char *fname)
+// Runs a single BFS from the START tile of `maze` and writes the
+// distance to every tile to the binary file `fname`: a
+// distfile_header_t followed by rows*cols distances in row-major
+// order (see mazesolve.h). Distances are written as uint16_t if they
+// all fit and as int32_t otherwise; each row is converted into a
+// buffer and written with a single fwrite(). Other programs can read
+// the file with distmap_open() rather than solving the maze again.
+// Returns the number of tiles reached or -1 if the file could not be
+// written.
+{
+    FILE *fout = fopen(fname, "wb");
+    if (fout == NULL) {
+        printf("ERROR: could not open file %s\n", fname);
+        return -1;
+    }
+
+    // One BFS over a compact copy of the maze gives all distances
+    mazegrid_t *grid = mazegrid_from_maze(maze, GRID_LAYOUT_ROWMAJOR);
+    int *dist = malloc(sizeof(int) * grid->ncells);
+    long reached = mazegrid_bfs(grid, maze->start_row, maze->start_col, dist);
+    int max_dist = 0;
+    for (long i = 0; i < grid->ncells; i++) {
+        if (dist[i] > max_dist) {
+            max_dist = dist[i];
+        }
+    }
+
+    // Header describing the element size used for distances
+    distfile_header_t header;
+    memset(&header, 0, sizeof(header));
+    strcpy(header.magic, DISTFILE_MAGIC);
+    header.rows = maze->rows;
+    header.cols = maze->cols;
+    header.elem_size = (max_dist < 0xFFFF) ? sizeof(uint16_t) : sizeof(int32_t);
+    header.start_row = maze->start_row;
+    header.start_col = maze->start_col;
+    int ok = fwrite(&header, sizeof(header), 1, fout) == 1;
+
+    // Convert each row to the element type and write it in bulk
+    void *row_buf = malloc((size_t)header.elem_size * (maze->cols > 0 ? maze->cols : 1));
+    for (int i = 0; ok && i < maze->rows; i++) {
+        for (int j = 0; j < maze->cols; j++) {
+            int d = dist[mazegrid_index(grid, i, j)];
+            if (header.elem_size == sizeof(uint16_t)) {
+                ((uint16_t *)row_buf)[j] = (d < 0) ? 0xFFFF : d;
+            } else {
+                ((int32_t *)row_buf)[j] = d;
+            }
+        }
+        ok = fwrite(row_buf, header.elem_size, maze->cols, fout) == (size_t)maze->cols;
+    }
+    free(row_buf);
+    free(dist);
+    mazegrid_free(grid);
+    if (fclose(fout) != 0 || !ok) {
+        printf("ERROR: failed writing distances to %s\n", fname);
+        return -1;
+    }
+    return reached;
+}
+
+distmap_t *distmap_open(char *fname)
+// Memory maps the distance field file `fname` read-only so that
+// distances can be looked up with distmap_get() without reading the
+// whole file. Returns NULL if the file cannot be opened or is not a
+// complete distance field file.
+{
+    int fd = open(fname, O_RDONLY);
+    if (fd < 0) {
+        printf("ERROR: could not open file %s\n", fname);
+        return NULL;
+    }
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || sb.st_size < (off_t)sizeof(distfile_header_t)) {
+        printf("ERROR: %s is not a distance field file\n", fname);
+        close(fd);
+        return NULL;
+    }
+    void *mapped = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);                  // mapping stays valid after close
+    if (mapped == MAP_FAILED) {
+        printf("ERROR: could not map file %s\n", fname);
+        return NULL;
+    }
+
+    // Check the header and that the file holds all the distances
+    distfile_header_t *header = mapped;
+    size_t expect = sizeof(distfile_header_t) +
+        (size_t)header->elem_size * header->rows * header->cols;
+    if (strcmp(header->magic, DISTFILE_MAGIC) != 0 ||
+        (header->elem_size != sizeof(uint16_t) && header->elem_size != sizeof(int32_t)) ||
+        (size_t)sb.st_size < expect) {
+        printf("ERROR: %s is not a distance field file\n", fname);
+        munmap(mapped, sb.st_size);
+        return NULL;
+    }
+    distmap_t *map = malloc(sizeof(distmap_t));
+    map->header = header;
+    map->dists = (char *)mapped + sizeof(distfile_header_t);
+    map->map_len = sb.st_size;
+    return map;
+}
+
+int distmap_get(distmap_t *map, int row, int col)
+// Returns the distance stored in `map` for tile row/col or -1 if the
+// tile is unreachable or row/col is out of bounds.
+{
+    if (row < 0 || row >= map->header->rows || col < 0 || col >= map->header->cols) {
+        return -1;
+    }
+    long i = (long)row * map->header->cols + col;
+    if (map->header->elem_size == sizeof(uint16_t)) {
+        uint16_t d = ((uint16_t *)map->dists)[i];
+        return (d == 0xFFFF) ? -1 : d;
+    }
+    return ((int32_t *)map->dists)[i];
+}
+
+void distmap_close(distmap_t *map)
+// Unmaps the file of `map` and frees it. Does nothing if map is NULL.
+{
+    if (map == NULL) {
+        return;
+    }
+    munmap(map->header, map->map_len);
+    free(map);
+}
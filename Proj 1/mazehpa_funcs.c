@@ -0,0 +1,649 @@
+#include "mazesolve.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// mazehpa_t: hierarchical abstraction for repeated queries
+//
+// Answering many START/END queries on one large maze with BFS repeats
+// a search over the whole maze each time. The abstraction here is
+// built once: the maze is divided into square clusters and each
+// entrance between neighboring clusters contributes a node on both
+// sides of the cluster border. Edges join the two nodes of an
+// entrance (length 1) and every pair of nodes in a cluster that can
+// reach each other within it (the length of the BFS path inside the
+// cluster). A query joins its START/END to the nodes of their
+// clusters, runs A* over the abstract graph, and refines only the
+// clusters along the result back into tile moves.
+//
+// As in HPA*, paths are near-shortest rather than shortest: a route
+// must cross cluster borders at entrance nodes so it may be a few
+// moves longer than a BFS path. The abstraction uses 4-way movement.
+////////////////////////////////////////////////////////////////////////////////
+
+// Working space for searches limited to a single cluster
+typedef struct {
+    int size;                   // cluster_size of the abstraction
+    int *dist;                  // size*size distances, -1 if not reached
+    unsigned char *dir;         // size*size direction each tile was reached by
+    int *queue;                 // size*size row/col offsets packed as r*size+c
+} hpascratch_t;
+
+static hpascratch_t *hpascratch_allocate(int size){
+    hpascratch_t *scratch = malloc(sizeof(hpascratch_t));
+    scratch->size = size;
+    scratch->dist = malloc(sizeof(int) * size * size);
+    scratch->dir = malloc(size * size);
+    scratch->queue = malloc(sizeof(int) * size * size);
+    return scratch;
+}
+
+static void hpascratch_free(hpascratch_t *scratch){
+    free(scratch->dist);
+    free(scratch->dir);
+    free(scratch->queue);
+    free(scratch);
+}
+
+static void mazehpa_cluster_bfs(maze_t *maze, mazehpa_t *hpa, hpascratch_t *scratch,
+                                int cluster, int start_row, int start_col)
+// Runs BFS from start_row/col, which must lie in `cluster`, without
+// leaving the cluster. Afterwards scratch->dist/dir hold the distance
+// and last move to each tile of the cluster indexed by its offset
+// (row-top)*size + (col-left) from the cluster's top left corner.
+{
+    int size = hpa->cluster_size;
+    int top = (cluster / hpa->cluster_cols) * size;
+    int left = (cluster % hpa->cluster_cols) * size;
+    int bottom = (top + size < maze->rows) ? top + size : maze->rows;
+    int right = (left + size < maze->cols) ? left + size : maze->cols;
+    for (int k = 0; k < size * size; k++) {
+        scratch->dist[k] = -1;
+    }
+    int front = 0, rear = 0;
+    int first = (start_row - top) * size + (start_col - left);
+    scratch->dist[first] = 0;
+    scratch->dir[first] = NONE;
+    scratch->queue[rear++] = first;
+    while (front < rear) {
+        int cur = scratch->queue[front++];
+        int row = top + cur / size;
+        int col = left + cur % size;
+        for (int d = DELTA_START; d < DELTA_COUNT; d++) {
+            int nrow = row + row_delta[d];
+            int ncol = col + col_delta[d];
+            if (nrow < top || nrow >= bottom || ncol < left || ncol >= right ||
+                maze->tiles[nrow][ncol].type == WALL) {
+                continue;
+            }
+            int next = (nrow - top) * size + (ncol - left);
+            if (scratch->dist[next] < 0) {
+                scratch->dist[next] = scratch->dist[cur] + 1;
+                scratch->dir[next] = dir_delta[d];
+                scratch->queue[rear++] = next;
+            }
+        }
+    }
+}
+
+static int mazehpa_cluster_of(mazehpa_t *hpa, int row, int col){
+    return (row / hpa->cluster_size) * hpa->cluster_cols + col / hpa->cluster_size;
+}
+
+// Node position while building: its cluster and tile
+typedef struct {
+    int cluster, row, col;
+} hpapos_t;
+
+static int hpapos_compare(const void *a, const void *b){
+    const hpapos_t *x = a, *y = b;
+    if (x->cluster != y->cluster) {
+        return x->cluster - y->cluster;
+    }
+    if (x->row != y->row) {
+        return x->row - y->row;
+    }
+    return x->col - y->col;
+}
+
+static int mazehpa_find_node(mazehpa_t *hpa, int row, int col)
+// Returns the index of the node at row/col or -1 if there is none.
+// Nodes are sorted by cluster then row/col so a binary search over
+// the nodes of the tile's cluster finds it.
+{
+    int cluster = mazehpa_cluster_of(hpa, row, col);
+    int lo = hpa->cluster_first[cluster], hi = hpa->cluster_first[cluster + 1] - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        graphnode_t *node = &hpa->nodes[mid];
+        if (node->row == row && node->col == col) {
+            return mid;
+        }
+        if (node->row < row || (node->row == row && node->col < col)) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return -1;
+}
+
+static void mazehpa_add_entrances(maze_t *maze, mazehpa_t *hpa, hpapos_t **pairs,
+                                  int *npairs, int *capacity)
+// Scans every border between neighboring clusters for entrances:
+// maximal runs of positions where the tiles on both sides are open.
+// Short entrances get one transition in their middle and longer ones
+// a transition at each end. Each transition appends the pair of tiles
+// on either side of the border to `pairs`.
+{
+    int size = hpa->cluster_size;
+    for (int vertical = 0; vertical <= 1; vertical++) {
+        // vertical borders lie between columns, horizontal between rows
+        int lines = vertical ? hpa->cluster_cols - 1 : hpa->cluster_rows - 1;
+        int length = vertical ? maze->rows : maze->cols;
+        for (int b = 1; b <= lines; b++) {
+            int edge = b * size;            // first row/col past the border
+            int run_start = -1;
+            for (int k = 0; k <= length; k++) {
+                int open = 0;
+                if (k < length) {
+                    int r1 = vertical ? k : edge - 1, c1 = vertical ? edge - 1 : k;
+                    int r2 = vertical ? k : edge, c2 = vertical ? edge : k;
+                    open = maze->tiles[r1][c1].type != WALL && maze->tiles[r2][c2].type != WALL;
+                }
+                if (open && run_start < 0) {
+                    run_start = k;
+                }
+                // a run ends at a wall or where the clusters along the
+                // border change so each entrance joins just two clusters
+                int run_end = !open || (k + 1) % size == 0 || k + 1 == length;
+                if (run_start >= 0 && run_end) {
+                    int last = open ? k : k - 1;
+                    int picks[2] = {(run_start + last) / 2, -1};
+                    if (last - run_start + 1 >= HPA_ENTRANCE_SPLIT) {
+                        picks[0] = run_start;
+                        picks[1] = last;
+                    }
+                    for (int p = 0; p < 2 && picks[p] >= 0; p++) {
+                        if (*npairs + 2 > *capacity) {
+                            *capacity *= 2;
+                            *pairs = realloc(*pairs, sizeof(hpapos_t) * *capacity);
+                        }
+                        int t = picks[p];
+                        hpapos_t *a = &(*pairs)[(*npairs)++];
+                        hpapos_t *c = &(*pairs)[(*npairs)++];
+                        a->row = vertical ? t : edge - 1;
+                        a->col = vertical ? edge - 1 : t;
+                        c->row = vertical ? t : edge;
+                        c->col = vertical ? edge : t;
+                        a->cluster = mazehpa_cluster_of(hpa, a->row, a->col);
+                        c->cluster = mazehpa_cluster_of(hpa, c->row, c->col);
+                    }
+                    run_start = -1;
+                }
+            }
+        }
+    }
+}
+
+mazehpa_t *mazehpa_build(maze_t *maze, int cluster_size)
+// Builds the abstraction of `maze` using square clusters of
+// cluster_size tiles on a side. Nodes are created at the transitions
+// of every entrance between clusters and sorted by cluster so that
+// cluster_first[c] .. cluster_first[c+1]-1 are the nodes of cluster
+// c. Edges are the transitions themselves plus, for each cluster, a
+// BFS within the cluster from each of its nodes to find its distance
+// to the others. Edges are stored grouped by the node they leave as
+// in mazegraph_t; their runs fields are unused as paths are refined
+// at query time. Sizes above HPA_CLUSTER_MAX are reduced to it.
+// Returns NULL for mazes with 8-way movement as the clusters and
+// their distances only follow 4-way moves.
+{
+    if (maze->movement != MOVEMENT_4WAY) {
+        return NULL;
+    }
+    mazehpa_t *hpa = malloc(sizeof(mazehpa_t));
+    hpa->key = mazecache_maze_key(maze, 0);
+    hpa->rows = maze->rows;
+    hpa->cols = maze->cols;
+    hpa->cluster_size = (cluster_size < 2) ? HPA_CLUSTER_SIZE :
+        (cluster_size > HPA_CLUSTER_MAX) ? HPA_CLUSTER_MAX : cluster_size;
+    hpa->cluster_rows = (maze->rows + hpa->cluster_size - 1) / hpa->cluster_size;
+    hpa->cluster_cols = (maze->cols + hpa->cluster_size - 1) / hpa->cluster_size;
+    int nclusters = hpa->cluster_rows * hpa->cluster_cols;
+
+    // Find the transitions of all entrances
+    int capacity = 64, npairs = 0;
+    hpapos_t *pairs = malloc(sizeof(hpapos_t) * capacity);
+    mazehpa_add_entrances(maze, hpa, &pairs, &npairs, &capacity);
+
+    // Nodes are the distinct transition tiles sorted by cluster
+    hpapos_t *positions = malloc(sizeof(hpapos_t) * (npairs > 0 ? npairs : 1));
+    memcpy(positions, pairs, sizeof(hpapos_t) * npairs);
+    qsort(positions, npairs, sizeof(hpapos_t), hpapos_compare);
+    hpa->nodes = malloc(sizeof(graphnode_t) * (npairs > 0 ? npairs : 1));
+    hpa->cluster_first = calloc(nclusters + 1, sizeof(int));
+    int nnodes = 0;
+    for (int k = 0; k < npairs; k++) {
+        if (k > 0 && hpapos_compare(&positions[k], &positions[k - 1]) == 0) {
+            continue;
+        }
+        hpa->nodes[nnodes].row = positions[k].row;
+        hpa->nodes[nnodes].col = positions[k].col;
+        hpa->nodes[nnodes].edge_count = 0;
+        hpa->cluster_first[positions[k].cluster + 1]++;
+        nnodes++;
+    }
+    hpa->node_count = nnodes;
+    for (int c = 0; c < nclusters; c++) {
+        hpa->cluster_first[c + 1] += hpa->cluster_first[c];
+    }
+    free(positions);
+
+    // Collect edges as source/target/length triples: first the
+    // transitions, then the distances between nodes within clusters
+    int ecapacity = 2 * npairs + 16, nedges = 0;
+    int *triples = malloc(sizeof(int) * 3 * ecapacity);
+    for (int k = 0; k < npairs; k += 2) {
+        int a = mazehpa_find_node(hpa, pairs[k].row, pairs[k].col);
+        int b = mazehpa_find_node(hpa, pairs[k + 1].row, pairs[k + 1].col);
+        int edge[6] = {a, b, 1, b, a, 1};
+        memcpy(&triples[3 * nedges], edge, sizeof(edge));
+        nedges += 2;
+    }
+    free(pairs);
+    hpascratch_t *scratch = hpascratch_allocate(hpa->cluster_size);
+    for (int c = 0; c < nclusters; c++) {
+        int top = (c / hpa->cluster_cols) * hpa->cluster_size;
+        int left = (c % hpa->cluster_cols) * hpa->cluster_size;
+        for (int a = hpa->cluster_first[c]; a < hpa->cluster_first[c + 1]; a++) {
+            mazehpa_cluster_bfs(maze, hpa, scratch, c, hpa->nodes[a].row, hpa->nodes[a].col);
+            for (int b = hpa->cluster_first[c]; b < hpa->cluster_first[c + 1]; b++) {
+                int off = (hpa->nodes[b].row - top) * hpa->cluster_size + (hpa->nodes[b].col - left);
+                if (b == a || scratch->dist[off] < 0) {
+                    continue;
+                }
+                if (nedges == ecapacity) {
+                    ecapacity *= 2;
+                    triples = realloc(triples, sizeof(int) * 3 * ecapacity);
+                }
+                triples[3 * nedges] = a;
+                triples[3 * nedges + 1] = b;
+                triples[3 * nedges + 2] = scratch->dist[off];
+                nedges++;
+            }
+        }
+    }
+    hpascratch_free(scratch);
+
+    // Group the edges by source node with a counting sort
+    for (int e = 0; e < nedges; e++) {
+        hpa->nodes[triples[3 * e]].edge_count++;
+    }
+    int pos = 0;
+    for (int n = 0; n < nnodes; n++) {
+        hpa->nodes[n].first_edge = pos;
+        pos += hpa->nodes[n].edge_count;
+        hpa->nodes[n].edge_count = 0;
+    }
+    hpa->edges = malloc(sizeof(graphedge_t) * (nedges > 0 ? nedges : 1));
+    hpa->edge_count = nedges;
+    for (int e = 0; e < nedges; e++) {
+        graphnode_t *node = &hpa->nodes[triples[3 * e]];
+        graphedge_t *edge = &hpa->edges[node->first_edge + node->edge_count++];
+        edge->target = triples[3 * e + 1];
+        edge->length = triples[3 * e + 2];
+        edge->first_run = 0;
+        edge->run_count = 0;
+    }
+    free(triples);
+    return hpa;
+}
+
+void mazehpa_free(mazehpa_t *hpa)
+// De-allocates `hpa` and its arrays. Does nothing if hpa is NULL.
+{
+    if (hpa == NULL) {
+        return;
+    }
+    free(hpa->cluster_first);
+    free(hpa->nodes);
+    free(hpa->edges);
+    free(hpa);
+}
+
+int mazehpa_write(mazehpa_t *hpa, char *fname)
+// Stores `hpa` in the binary file `fname` so later runs can skip
+// building it: an hpafile_header_t followed by the cluster_first,
+// nodes, and edges arrays, each written with a single fwrite().
+// Returns 1 on success and 0 if the file could not be written.
+{
+    FILE *fout = fopen(fname, "wb");
+    if (fout == NULL) {
+        printf("ERROR: could not open file %s\n", fname);
+        return 0;
+    }
+    hpafile_header_t header;
+    memset(&header, 0, sizeof(header));
+    strcpy(header.magic, HPAFILE_MAGIC);
+    header.key = hpa->key;
+    header.rows = hpa->rows;
+    header.cols = hpa->cols;
+    header.cluster_size = hpa->cluster_size;
+    header.node_count = hpa->node_count;
+    header.edge_count = hpa->edge_count;
+    int nclusters = hpa->cluster_rows * hpa->cluster_cols;
+    int ok = fwrite(&header, sizeof(header), 1, fout) == 1 &&
+        fwrite(hpa->cluster_first, sizeof(int), nclusters + 1, fout) == (size_t)nclusters + 1 &&
+        fwrite(hpa->nodes, sizeof(graphnode_t), hpa->node_count, fout) == (size_t)hpa->node_count &&
+        fwrite(hpa->edges, sizeof(graphedge_t), hpa->edge_count, fout) == (size_t)hpa->edge_count;
+    if (fclose(fout) != 0 || !ok) {
+        printf("ERROR: failed writing abstraction to %s\n", fname);
+        return 0;
+    }
+    return 1;
+}
+
+static int mazehpa_valid(mazehpa_t *hpa)
+// Returns 1 if the arrays of `hpa` read from a file are consistent so
+// that searches cannot index outside them: cluster_first runs from 0
+// to node_count without decreasing, each node lies in its cluster and
+// leaves a range of edges inside the edges array, and each edge leads
+// to a node. An edge to another cluster must be a transition of
+// length 1 to the next tile, and one within a cluster no longer than
+// the cluster's tiles. Returns 0 otherwise.
+//
+// NOTES: Lengths within a cluster are only bounded here, as checking
+// them takes a BFS of every cluster; mazehpa_refine() finds a stored
+// length that differs from the cluster BFS and fails the query.
+{
+    int nclusters = hpa->cluster_rows * hpa->cluster_cols;
+    if (hpa->cluster_first[0] != 0 || hpa->cluster_first[nclusters] != hpa->node_count) {
+        return 0;
+    }
+    for (int c = 0; c < nclusters; c++) {
+        if (hpa->cluster_first[c + 1] < hpa->cluster_first[c]) {
+            return 0;
+        }
+        for (int n = hpa->cluster_first[c]; n < hpa->cluster_first[c + 1]; n++) {
+            graphnode_t *node = &hpa->nodes[n];
+            if (node->row < 0 || node->row >= hpa->rows ||
+                node->col < 0 || node->col >= hpa->cols ||
+                mazehpa_cluster_of(hpa, node->row, node->col) != c ||
+                node->first_edge < 0 || node->edge_count < 0 ||
+                node->first_edge > hpa->edge_count - node->edge_count) {
+                return 0;
+            }
+        }
+    }
+    for (int e = 0; e < hpa->edge_count; e++) {
+        if (hpa->edges[e].target < 0 || hpa->edges[e].target >= hpa->node_count ||
+            hpa->edges[e].length < 0) {
+            return 0;
+        }
+    }
+    long cluster_tiles = (long)hpa->cluster_size * hpa->cluster_size;
+    for (int n = 0; n < hpa->node_count; n++) {
+        graphnode_t *node = &hpa->nodes[n];
+        for (int e = node->first_edge; e < node->first_edge + node->edge_count; e++) {
+            graphnode_t *next = &hpa->nodes[hpa->edges[e].target];
+            if (mazehpa_cluster_of(hpa, node->row, node->col) !=
+                mazehpa_cluster_of(hpa, next->row, next->col)) {
+                if (hpa->edges[e].length != 1 ||
+                    abs(node->row - next->row) + abs(node->col - next->col) != 1) {
+                    return 0;
+                }
+            } else if (hpa->edges[e].length >= cluster_tiles) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+mazehpa_t *mazehpa_read(char *fname, maze_t *maze)
+// Loads an abstraction stored by mazehpa_write() for `maze`. Returns
+// NULL if the file cannot be opened, was built from a different maze
+// as found by its size and mazecache_maze_key(), or is not a complete
+// and consistent abstraction file.
+{
+    FILE *fin = fopen(fname, "rb");
+    if (fin == NULL) {
+        return NULL;
+    }
+    hpafile_header_t header;
+    if (fread(&header, sizeof(header), 1, fin) != 1 ||
+        strncmp(header.magic, HPAFILE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.rows <= 0 || header.cols <= 0 ||
+        header.cluster_size < 2 || header.cluster_size > HPA_CLUSTER_MAX ||
+        header.node_count < 0 || header.edge_count < 0) {
+        printf("ERROR: %s is not an abstraction file\n", fname);
+        fclose(fin);
+        return NULL;
+    }
+    if (header.rows != maze->rows || header.cols != maze->cols ||
+        header.key != mazecache_maze_key(maze, 0)) {
+        fclose(fin);
+        return NULL;
+    }
+    mazehpa_t *hpa = malloc(sizeof(mazehpa_t));
+    hpa->key = header.key;
+    hpa->rows = header.rows;
+    hpa->cols = header.cols;
+    hpa->cluster_size = header.cluster_size;
+    hpa->cluster_rows = (hpa->rows + hpa->cluster_size - 1) / hpa->cluster_size;
+    hpa->cluster_cols = (hpa->cols + hpa->cluster_size - 1) / hpa->cluster_size;
+    hpa->node_count = header.node_count;
+    hpa->edge_count = header.edge_count;
+    int nclusters = hpa->cluster_rows * hpa->cluster_cols;
+    hpa->cluster_first = malloc(sizeof(int) * (nclusters + 1));
+    hpa->nodes = malloc(sizeof(graphnode_t) * (hpa->node_count > 0 ? hpa->node_count : 1));
+    hpa->edges = malloc(sizeof(graphedge_t) * (hpa->edge_count > 0 ? hpa->edge_count : 1));
+    int ok = fread(hpa->cluster_first, sizeof(int), nclusters + 1, fin) == (size_t)nclusters + 1 &&
+        fread(hpa->nodes, sizeof(graphnode_t), hpa->node_count, fin) == (size_t)hpa->node_count &&
+        fread(hpa->edges, sizeof(graphedge_t), hpa->edge_count, fin) == (size_t)hpa->edge_count;
+    fclose(fin);
+    if (!ok || !mazehpa_valid(hpa)) {
+        printf("ERROR: %s is not an abstraction file\n", fname);
+        mazehpa_free(hpa);
+        return NULL;
+    }
+    return hpa;
+}
+
+static int mazehpa_refine(maze_t *maze, mazehpa_t *hpa, hpascratch_t *scratch,
+                          int from_row, int from_col, int to_row, int to_col,
+                          long len, direction_t *path)
+// Writes the `len` moves from from_row/col to to_row/col into `path`
+// and returns 1. Tiles in different clusters are the two sides of a
+// transition, one move apart; tiles in the same cluster are joined by
+// a BFS within it whose moves are traced back from the destination.
+// Returns 0, writing nothing, if the moves found are not `len` long
+// as for an abstraction whose stored lengths do not fit the maze.
+{
+    int cluster = mazehpa_cluster_of(hpa, from_row, from_col);
+    if (cluster != mazehpa_cluster_of(hpa, to_row, to_col)) {
+        for (int d = DELTA_START; d < DELTA_COUNT; d++) {
+            if (len == 1 && from_row + row_delta[d] == to_row && from_col + col_delta[d] == to_col) {
+                path[0] = dir_delta[d];
+                return 1;
+            }
+        }
+        return 0;
+    }
+    mazehpa_cluster_bfs(maze, hpa, scratch, cluster, from_row, from_col);
+    int size = hpa->cluster_size;
+    int top = (cluster / hpa->cluster_cols) * size;
+    int left = (cluster % hpa->cluster_cols) * size;
+    if (len < 0 || scratch->dist[(to_row - top) * size + (to_col - left)] != len) {
+        return 0;
+    }
+    int row = to_row, col = to_col;
+    for (int k = len - 1; k >= 0; k--) {
+        direction_t dir = scratch->dir[(row - top) * size + (col - left)];
+        path[k] = dir;
+        row -= row_delta[dir];
+        col -= col_delta[dir];
+    }
+    return 1;
+}
+
+direction_t *mazehpa_find_path(maze_t *maze, mazehpa_t *hpa, int start_row, int start_col,
+                               int end_row, int end_col, long *lenp)
+// Finds a path from start_row/col to end_row/col in `maze` using its
+// abstraction `hpa`. The start and end are joined to the nodes of
+// their clusters by a BFS within each cluster, and to each other if
+// they share a cluster. A* with the Manhattan distance as heuristic
+// then searches the abstract graph with the start and end as two
+// extra nodes. Finally each step of the abstract path is refined into
+// tile moves. Returns a malloc()'d array of directions and sets *lenp
+// to its length, or returns NULL with *lenp set to -1 if no path is
+// found or a step cannot be refined to its stored length.
+{
+    *lenp = -1;
+    if (maze_tile_blocked(maze, start_row, start_col) ||
+        maze_tile_blocked(maze, end_row, end_col) ||
+        hpa->rows != maze->rows || hpa->cols != maze->cols) {
+        return NULL;
+    }
+    int size = hpa->cluster_size;
+    int source = hpa->node_count, target = hpa->node_count + 1;
+    int start_cluster = mazehpa_cluster_of(hpa, start_row, start_col);
+    int end_cluster = mazehpa_cluster_of(hpa, end_row, end_col);
+    int start_top = (start_cluster / hpa->cluster_cols) * size;
+    int start_left = (start_cluster % hpa->cluster_cols) * size;
+    int end_top = (end_cluster / hpa->cluster_cols) * size;
+    int end_left = (end_cluster % hpa->cluster_cols) * size;
+    hpascratch_t *scratch = hpascratch_allocate(size);
+
+    // Distances from the end to the nodes of its cluster give the
+    // edges into the target; searches are undirected so BFS from the
+    // end gives the distance to it
+    int end_first = hpa->cluster_first[end_cluster];
+    int end_nodes = hpa->cluster_first[end_cluster + 1] - end_first;
+    int *to_end = malloc(sizeof(int) * (end_nodes + 1));
+    mazehpa_cluster_bfs(maze, hpa, scratch, end_cluster, end_row, end_col);
+    for (int k = 0; k < end_nodes; k++) {
+        graphnode_t *node = &hpa->nodes[end_first + k];
+        to_end[k] = scratch->dist[(node->row - end_top) * size + (node->col - end_left)];
+    }
+    int direct = (start_cluster == end_cluster) ?
+        scratch->dist[(start_row - end_top) * size + (start_col - end_left)] : -1;
+
+    // A* state for every node plus the source and target
+    int total = hpa->node_count + 2;
+    long *g = malloc(sizeof(long) * total);
+    int *parent = malloc(sizeof(int) * total);
+    for (int n = 0; n < total; n++) {
+        g[n] = -1;
+        parent[n] = -1;
+    }
+    minheap_t *heap = minheap_allocate(64);
+
+    // The source's edges lead to the nodes of its cluster and, if in
+    // the same cluster, directly to the target
+    mazehpa_cluster_bfs(maze, hpa, scratch, start_cluster, start_row, start_col);
+    g[source] = 0;
+    for (int n = hpa->cluster_first[start_cluster]; n < hpa->cluster_first[start_cluster + 1]; n++) {
+        graphnode_t *node = &hpa->nodes[n];
+        int d = scratch->dist[(node->row - start_top) * size + (node->col - start_left)];
+        if (d >= 0) {
+            g[n] = d;
+            parent[n] = source;
+            minheap_push(heap, d + abs(node->row - end_row) + abs(node->col - end_col), n);
+        }
+    }
+    if (direct >= 0) {
+        g[target] = direct;
+        parent[target] = source;
+        minheap_push(heap, direct, target);
+    }
+
+    // Expand nodes in order of g + h until the target is removed
+    long key;
+    int n;
+    while (minheap_pop(heap, &key, &n)) {
+        if (n == target) {
+            break;
+        }
+        graphnode_t *node = &hpa->nodes[n];
+        if (key != g[n] + abs(node->row - end_row) + abs(node->col - end_col)) {
+            continue;           // stale entry for an improved node
+        }
+        for (int e = node->first_edge; e < node->first_edge + node->edge_count; e++) {
+            graphedge_t *edge = &hpa->edges[e];
+            graphnode_t *next = &hpa->nodes[edge->target];
+            long cost = g[n] + edge->length;
+            if (g[edge->target] < 0 || cost < g[edge->target]) {
+                g[edge->target] = cost;
+                parent[edge->target] = n;
+                minheap_push(heap, cost + abs(next->row - end_row) + abs(next->col - end_col),
+                             edge->target);
+            }
+        }
+        if (n >= end_first && n < end_first + end_nodes && to_end[n - end_first] >= 0) {
+            long cost = g[n] + to_end[n - end_first];
+            if (g[target] < 0 || cost < g[target]) {
+                g[target] = cost;
+                parent[target] = n;
+                minheap_push(heap, cost, target);
+            }
+        }
+    }
+    minheap_free(heap);
+
+    // Refine the abstract path from the target back to the source
+    direction_t *path = NULL;
+    if (g[target] >= 0) {
+        *lenp = g[target];
+        path = malloc(sizeof(direction_t) * (*lenp > 0 ? *lenp : 1));
+        long pos = *lenp;
+        int row = end_row, col = end_col;
+        for (int t = target; t != source; ) {
+            int p = parent[t];
+            int prow = (p == source) ? start_row : hpa->nodes[p].row;
+            int pcol = (p == source) ? start_col : hpa->nodes[p].col;
+            long step = g[t] - g[p];
+            pos -= step;
+            if (!mazehpa_refine(maze, hpa, scratch, prow, pcol, row, col, step, path + pos)) {
+                free(path);
+                path = NULL;
+                *lenp = -1;
+                break;
+            }
+            row = prow;
+            col = pcol;
+            t = p;
+        }
+    }
+    free(g);
+    free(parent);
+    free(to_end);
+    hpascratch_free(scratch);
+    return path;
+}
+
+int maze_solve_hpa(maze_t *maze, mazehpa_t *hpa)
+// Solves `maze` with its abstraction `hpa` in place of
+// maze_bfs_iterate(). The path found from START to END is stored in
+// the path field of the END tile which is marked FOUND so that
+// maze_set_solution() can follow it. Returns 1 if a path was found
+// and 0 otherwise.
+{
+    long len;
+    direction_t *path = mazehpa_find_path(maze, hpa, maze->start_row, maze->start_col,
+                                          maze->end_row, maze->end_col, &len);
+    if (path == NULL) {
+        return 0;
+    }
+    tile_t *end_tile = &maze->tiles[maze->end_row][maze->end_col];
+    free(end_tile->path);
+    free(end_tile->packed);
+    end_tile->packed = NULL;
+    end_tile->path = path;
+    end_tile->path_len = len;
+    end_tile->state = FOUND;
+    maze_note_path(maze, maze->end_row, maze->end_col);
+    if (LOG_LEVEL >= LOG_BFS_STEPS) {
+        printf("LOG: abstract path of length %ld\n", len);
+    }
+    return 1;
+}
@@ -0,0 +1,315 @@
+#include "mazesolve.h"
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Parallel maze file loading
+//
+// maze_from_file() reads a maze one line at a time which dominates
+// the run time for very large maze files. The loader here maps the
+// whole file into memory, splits the tile lines into chunks that
+// begin at row boundaries, and classifies the chunks on separate
+// threads directly into the tiles of a preallocated maze. Each thread
+// records what it found in its own loadchunk_t so that no locking is
+// needed; START/END tiles and malformed rows are merged once all
+// threads finish.
+////////////////////////////////////////////////////////////////////////////////
+
+// Work for one loader thread: the bytes of its lines and the first
+// row they belong to along with what it found while classifying them
+typedef struct {
+    maze_t *maze;               // maze to fill in
+    char *begin, *end;          // bytes of the chunk; begins at a row
+    long first_row;             // row of the first line in the chunk
+    long nrows;                 // number of lines in the chunk
+    long start_count, end_count; // START/END tiles found
+    int start_row, start_col;   // last START found in the chunk
+    int end_row, end_col;       // last END found in the chunk
+    int bad_row;                // first malformed row or -1
+} loadchunk_t;
+
+// Tile type for each character or -1 for characters which are not in
+// tiletype_chars[]; filled in once by loadchunk_init_types() so that
+// classifying a character is a single lookup
+static signed char char_types[256];
+static pthread_once_t char_types_once = PTHREAD_ONCE_INIT;
+
+static void loadchunk_init_types(void){
+    memset(char_types, -1, sizeof(char_types));
+    for (int k = NOTSET; k <= END; k++) {
+        char_types[(unsigned char)tiletype_chars[k]] = k;
+    }
+}
+
+static void *loadchunk_count_rows(void *arg)
+// Thread function that counts the lines in a chunk; the count of each
+// chunk gives the first row of the next.
+{
+    loadchunk_t *chunk = arg;
+    long nrows = 0;
+    for (char *p = chunk->begin; p < chunk->end; p++) {
+        p = memchr(p, '\n', chunk->end - p);
+        if (p == NULL) {
+            p = chunk->end;     // final line without a newline
+        }
+        nrows++;
+    }
+    chunk->nrows = nrows;
+    return NULL;
+}
+
+static void *loadchunk_classify(void *arg)
+// Thread function that sets the type of every tile in the rows of a
+// chunk, along with the NOTFOUND state and -1 path_len that
+// maze_allocate() would give it; the paths of the lazily allocated
+// tiles are already NULL. As in maze_from_file(), short lines are
+// padded with OPEN tiles and carriage returns are ignored. A line is
+// malformed if it is longer than the maze or has a character that is
+// not a tile; its tiles are still set and the row is reported after
+// loading.
+//
+// The open_mask of each row is set once the row after it is read as
+// long as the row before it is in the chunk or is the border. That
+// leaves the first row of each later chunk and the row before it,
+// whose neighbors belong to two threads, to be set after all threads
+// finish.
+{
+    loadchunk_t *chunk = arg;
+    maze_t *maze = chunk->maze;
+    char *line = chunk->begin;
+    long last_row = chunk->first_row + chunk->nrows;
+    if (last_row > maze->rows) {
+        last_row = maze->rows;  // extra lines after the tiles are ignored
+    }
+    for (long i = chunk->first_row; i < last_row; i++) {
+        char *eol = memchr(line, '\n', chunk->end - line);
+        if (eol == NULL) {
+            eol = chunk->end;
+        }
+        long len = eol - line;
+        while (len > 0 && line[len - 1] == '\r') {
+            len--;
+        }
+        if (len > maze->cols && chunk->bad_row < 0) {
+            chunk->bad_row = i;
+        }
+
+        // Classify the characters of the row, padding short lines
+        tile_t *row = maze->tiles[i];
+        for (int j = 0; j < maze->cols; j++) {
+            int type = (j < len) ? char_types[(unsigned char)line[j]] : OPEN;
+            if (type < 0) {
+                type = NOTSET;
+                if (chunk->bad_row < 0) {
+                    chunk->bad_row = i;
+                }
+            }
+            row[j].type = type;
+            row[j].state = NOTFOUND;
+            row[j].path_len = -1;
+            if (type == START) {
+                chunk->start_row = i;
+                chunk->start_col = j;
+                chunk->start_count++;
+            } else if (type == END) {
+                chunk->end_row = i;
+                chunk->end_col = j;
+                chunk->end_count++;
+            }
+        }
+        if (i - 1 > chunk->first_row || (i == 1 && chunk->first_row == 0)) {
+            maze_compute_row_masks(maze, i - 1);
+        }
+        line = eol + 1;
+    }
+    if (last_row == maze->rows && last_row > chunk->first_row &&
+        (last_row - 1 > chunk->first_row || chunk->first_row == 0)) {
+        maze_compute_row_masks(maze, last_row - 1);
+    }
+    return NULL;
+}
+
+static void loadchunk_run_all(loadchunk_t *chunks, int nchunks, void *(*func)(void *))
+// Runs `func` on every chunk with one thread per chunk. The first
+// chunk is handled by the calling thread; if a thread cannot be
+// created its chunk is also handled by the caller.
+{
+    pthread_t threads[LOAD_THREADS_MAX];
+    int started[LOAD_THREADS_MAX];
+    for (int t = 1; t < nchunks; t++) {
+        started[t] = pthread_create(&threads[t], NULL, func, &chunks[t]) == 0;
+    }
+    func(&chunks[0]);
+    for (int t = 1; t < nchunks; t++) {
+        if (started[t]) {
+            pthread_join(threads[t], NULL);
+        } else {
+            func(&chunks[t]);
+        }
+    }
+}
+
+maze_t *maze_from_file_parallel(char *fname, int nthreads)
+// Reads a maze in the same format as maze_from_file() using up to
+// `nthreads` threads to classify tiles. The file is memory mapped,
+// the tile lines are split into one chunk per thread at line
+// boundaries, and each thread counts the lines in its chunk. The
+// counts give the first row of each chunk after which the threads
+// classify their rows into the tiles of a maze allocated beforehand.
+// Finally the START/END tiles found by each chunk are merged in row
+// order so that start/end row/col refer to the last of each as with
+// maze_from_file() and the open_mask of the rows at chunk boundaries
+// is set, those of the other rows having been set by the threads.
+//
+// Returns NULL with an error message if the file cannot be read, has
+// fewer tile lines than its rows, or has a malformed row: one longer
+// than the maze columns or containing a character that is not a
+// tile. The error names the first malformed row in the file.
+//
+// If LOG_LEVEL >= LOG_FILE_LOAD the per-tile log messages must appear
+// in order so maze_from_file() is used instead.
+{
+    if (LOG_LEVEL >= LOG_FILE_LOAD) {
+        return maze_from_file(fname);
+    }
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+    if (nthreads > LOAD_THREADS_MAX) {
+        nthreads = LOAD_THREADS_MAX;
+    }
+
+    int fd = open(fname, O_RDONLY);
+    if (fd < 0) {
+        printf("ERROR: could not open file %s\n", fname);
+        return NULL;
+    }
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || sb.st_size == 0) {
+        printf("Error: failed to read maze dimensions.\n");
+        close(fd);
+        return NULL;
+    }
+    char *data = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);                  // mapping stays valid after close
+    if (data == MAP_FAILED) {
+        printf("ERROR: could not map file %s\n", fname);
+        return NULL;
+    }
+    char *data_end = data + sb.st_size;
+
+    // Parse the "rows: R cols: C" line from a terminated copy then
+    // skip it and the "tiles:" line
+    char header[128];
+    char *eol = memchr(data, '\n', sb.st_size);
+    long hlen = (eol != NULL) ? eol - data : sb.st_size;
+    if (hlen >= (long)sizeof(header)) {
+        hlen = sizeof(header) - 1;
+    }
+    memcpy(header, data, hlen);
+    header[hlen] = '\0';
+    int rows, cols;
+    if (sscanf(header, "rows: %d cols: %d", &rows, &cols) != 2 ||
+        rows < 0 || cols < 0 || rows > MAZE_MAX_DIM || cols > MAZE_MAX_DIM) {
+        printf("Error: failed to read maze dimensions.\n");
+        munmap(data, sb.st_size);
+        return NULL;
+    }
+    char *tiles_begin = (eol != NULL) ? memchr(eol + 1, '\n', data_end - eol - 1) : NULL;
+    if (tiles_begin == NULL) {
+        printf("Error: failed to read tiles label.\n");
+        munmap(data, sb.st_size);
+        return NULL;
+    }
+    tiles_begin++;
+
+    // Split the tile lines into chunks of about equal size, moving
+    // each boundary forward to the start of the next line
+    loadchunk_t chunks[LOAD_THREADS_MAX];
+    long tile_bytes = data_end - tiles_begin;
+    char *begin = tiles_begin;
+    int nchunks = 0;
+    for (int t = 0; t < nthreads && begin < data_end; t++) {
+        char *end = tiles_begin + tile_bytes * (t + 1) / nthreads;
+        if (end < begin) {
+            end = begin;
+        }
+        if (end < data_end) {
+            char *nl = memchr(end, '\n', data_end - end);
+            end = (nl != NULL) ? nl + 1 : data_end;
+        }
+        loadchunk_t *chunk = &chunks[nchunks++];
+        memset(chunk, 0, sizeof(loadchunk_t));
+        chunk->begin = begin;
+        chunk->end = end;
+        chunk->bad_row = -1;
+        begin = end;
+    }
+
+    // Count lines in parallel; a prefix sum gives each chunk's first row
+    long total_rows = 0;
+    if (nchunks > 0) {
+        loadchunk_run_all(chunks, nchunks, loadchunk_count_rows);
+    }
+    for (int t = 0; t < nchunks; t++) {
+        chunks[t].first_row = total_rows;
+        total_rows += chunks[t].nrows;
+    }
+    if (total_rows < rows) {
+        printf("Error: unexpected end of file reading maze tiles.\n");
+        munmap(data, sb.st_size);
+        return NULL;
+    }
+
+    // Classify the rows of all chunks in parallel into the maze; each
+    // thread is the first to touch the tiles of its rows
+    maze_t *maze = maze_allocate_lazy(rows, cols);
+    if (maze == NULL) {
+        munmap(data, sb.st_size);
+        return NULL;
+    }
+    pthread_once(&char_types_once, loadchunk_init_types);
+    for (int t = 0; t < nchunks; t++) {
+        chunks[t].maze = maze;
+    }
+    if (nchunks > 0) {
+        loadchunk_run_all(chunks, nchunks, loadchunk_classify);
+    }
+    munmap(data, sb.st_size);
+
+    // Merge chunk results in row order: the first malformed row is
+    // reported and the last START/END found is recorded
+    for (int t = 0; t < nchunks; t++) {
+        loadchunk_t *chunk = &chunks[t];
+        if (chunk->bad_row >= 0) {
+            printf("Error: malformed row %d of maze tiles.\n", chunk->bad_row);
+            maze_free(maze);
+            return NULL;
+        }
+        if (chunk->start_count > 0) {
+            maze->start_row = chunk->start_row;
+            maze->start_col = chunk->start_col;
+            maze->start_count += chunk->start_count;
+        }
+        if (chunk->end_count > 0) {
+            maze->end_row = chunk->end_row;
+            maze->end_col = chunk->end_col;
+            maze->end_count += chunk->end_count;
+        }
+    }
+
+    // Finalize: masks of the rows on either side of each boundary
+    // between chunks need the rows of both threads
+    for (int t = 1; t < nchunks; t++) {
+        long row = chunks[t].first_row;
+        if (row < maze->rows) {
+            maze_compute_row_masks(maze, row - 1);
+            maze_compute_row_masks(maze, row);
+        }
+    }
+    maze->masks_ready = 1;
+    return maze;
+}
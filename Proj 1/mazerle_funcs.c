@@ -0,0 +1,244 @@
+#include "mazesolve.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// mazerle_t: mazes stored as runs of open tiles
+//
+// Large mazes that are mostly open space are costly as a maze_t with
+// a tile_t per position. A mazerle_t stores only the maximal runs of
+// open tiles in each row, so memory is proportional to the number of
+// runs. Reachability is found by a BFS over the runs themselves: a run
+// is reached if it touches a reached run in the row above or below.
+// Time and memory both scale with the number of runs rather than the
+// number of tiles.
+////////////////////////////////////////////////////////////////////////////////
+
+static void mazerle_add_run(mazerle_t *rle, long *capacity, int lo, int hi)
+// Appends the run of open tiles lo..hi to the runs of `rle`.
+{
+    if (rle->run_count == *capacity) {
+        *capacity *= 2;
+        rle->runs = realloc(rle->runs, sizeof(interval_t) * *capacity);
+    }
+    rle->runs[rle->run_count].lo = lo;
+    rle->runs[rle->run_count].hi = hi;
+    rle->run_count++;
+}
+
+static mazerle_t *mazerle_allocate(int rows, int cols)
+// Allocates a mazerle_t with no runs.
+{
+    mazerle_t *rle = malloc(sizeof(mazerle_t));
+    rle->rows = rows;
+    rle->cols = cols;
+    rle->row_first = malloc(sizeof(long) * (rows + 1));
+    rle->row_first[0] = 0;
+    rle->runs = malloc(sizeof(interval_t) * 16);
+    rle->run_count = 0;
+    rle->start_row = rle->start_col = -1;
+    rle->end_row = rle->end_col = -1;
+    rle->movement = MOVEMENT_4WAY;
+    return rle;
+}
+
+mazerle_t *mazerle_from_maze(maze_t *maze)
+// Creates the runs of open tiles of `maze`, one row at a time. A tile
+// is open unless maze_tile_blocked() reports it as blocked. The
+// start/end coordinates and movement are copied from the maze.
+{
+    mazerle_t *rle = mazerle_allocate(maze->rows, maze->cols);
+    long capacity = 16;
+    for (int i = 0; i < maze->rows; i++) {
+        int lo = -1;
+        for (int j = 0; j <= maze->cols; j++) {
+            int open = j < maze->cols && !maze_tile_blocked(maze, i, j);
+            if (open && lo < 0) {
+                lo = j;
+            } else if (!open && lo >= 0) {
+                mazerle_add_run(rle, &capacity, lo, j - 1);
+                lo = -1;
+            }
+        }
+        rle->row_first[i + 1] = rle->run_count;
+    }
+    rle->start_row = maze->start_row;
+    rle->start_col = maze->start_col;
+    rle->end_row = maze->end_row;
+    rle->end_col = maze->end_col;
+    rle->movement = maze->movement;
+    return rle;
+}
+
+mazerle_t *mazerle_from_file(char *fname)
+// Reads a maze file in the format of maze_from_file() directly into
+// runs without creating any tiles. Each line is read whole and split
+// into runs of characters other than the WALL character; short lines
+// are open past their end as in maze_from_file(). The last S and E
+// characters give the start/end coordinates. Returns NULL if the file
+// cannot be read. Files maze_from_file() rejects are rejected with the
+// same errors: dimensions that are negative or above MAZE_MAX_DIM, and
+// malformed rows longer than the maze or with a character not in
+// tiletype_chars[].
+{
+    FILE *fin = fopen(fname, "r");
+    if (fin == NULL) {
+        printf("ERROR: could not open file %s\n", fname);
+        return NULL;
+    }
+    int rows, cols;
+    if (fscanf(fin, "rows: %d cols: %d tiles:", &rows, &cols) != 2 ||
+        rows < 0 || cols < 0 || rows > MAZE_MAX_DIM || cols > MAZE_MAX_DIM) {
+        printf("Error: failed to read maze dimensions.\n");
+        fclose(fin);
+        return NULL;
+    }
+    int c;
+    while ((c = fgetc(fin)) != '\n' && c != EOF)
+        ;
+
+    mazerle_t *rle = mazerle_allocate(rows, cols);
+    long capacity = 16;
+    char *line = NULL;
+    size_t line_size = 0;
+    for (int i = 0; i < rows; i++) {
+        ssize_t len = getline(&line, &line_size, fin);
+        if (len < 0) {
+            printf("Error: unexpected end of file reading maze tiles.\n");
+            free(line);
+            fclose(fin);
+            mazerle_free(rle);
+            return NULL;
+        }
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+            len--;
+        }
+        // A row longer than the maze or with a character that is not
+        // a tile is malformed
+        int malformed = len > cols;
+        for (ssize_t j = 0; j < len && !malformed; j++) {
+            malformed = memchr(tiletype_chars, line[j], END + 1) == NULL;
+        }
+        if (malformed) {
+            printf("Error: malformed row %d of maze tiles.\n", i);
+            free(line);
+            fclose(fin);
+            mazerle_free(rle);
+            return NULL;
+        }
+        // Split the row into runs, noting START/END characters
+        int lo = -1;
+        for (int j = 0; j <= cols; j++) {
+            char ch = (j < len) ? line[j] : tiletype_chars[OPEN];
+            int open = j < cols && ch != tiletype_chars[WALL];
+            if (open && lo < 0) {
+                lo = j;
+            } else if (!open && lo >= 0) {
+                mazerle_add_run(rle, &capacity, lo, j - 1);
+                lo = -1;
+            }
+            if (j < cols && ch == tiletype_chars[START]) {
+                rle->start_row = i;
+                rle->start_col = j;
+            } else if (j < cols && ch == tiletype_chars[END]) {
+                rle->end_row = i;
+                rle->end_col = j;
+            }
+        }
+        rle->row_first[i + 1] = rle->run_count;
+    }
+    free(line);
+    fclose(fin);
+    return rle;
+}
+
+void mazerle_free(mazerle_t *rle)
+// De-allocates `rle` and its arrays. Does nothing if rle is NULL.
+{
+    if (rle == NULL) {
+        return;
+    }
+    free(rle->row_first);
+    free(rle->runs);
+    free(rle);
+}
+
+static long mazerle_first_run(mazerle_t *rle, int row, int col)
+// Returns the index of the first run of `row` that ends at or after
+// `col`, or the index past the row's runs if there is none. Runs of a
+// row are in increasing order so a binary search finds it.
+{
+    long lo = rle->row_first[row], hi = rle->row_first[row + 1];
+    while (lo < hi) {
+        long mid = (lo + hi) / 2;
+        if (rle->runs[mid].hi < col) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+long mazerle_find_run(mazerle_t *rle, int row, int col)
+// Returns the index of the run containing tile row/col or -1 if the
+// tile is out of bounds or not open.
+{
+    if (row < 0 || row >= rle->rows || col < 0 || col >= rle->cols) {
+        return -1;
+    }
+    long r = mazerle_first_run(rle, row, col);
+    if (r < rle->row_first[row + 1] && rle->runs[r].lo <= col) {
+        return r;
+    }
+    return -1;
+}
+
+long mazerle_reach(mazerle_t *rle, int start_row, int start_col, unsigned char *reached)
+// Finds every run reachable from the tile at start_row/col, setting
+// reached[r] to 1 for reachable runs and 0 for others; `reached` must
+// have rle->run_count elements. Returns the number of reachable tiles
+// or 0 if the start is not open.
+//
+// NOTES: Runs are queued as they are reached. Expanding a run looks at
+// the rows above and below for runs overlapping its columns; with
+// 8-way movement runs that touch diagonally at either end also
+// overlap. A binary search finds the first such run in each row after
+// which overlapping runs are consecutive, so every run is queued once
+// and each pair of touching runs is examined at most twice.
+{
+    memset(reached, 0, rle->run_count);
+    long start = mazerle_find_run(rle, start_row, start_col);
+    if (start < 0) {
+        return 0;
+    }
+    int reach = (rle->movement == MOVEMENT_8WAY) ? 1 : 0;
+    long *queue = malloc(sizeof(long) * rle->run_count);
+    int *queue_rows = malloc(sizeof(int) * rle->run_count);
+    long front = 0, rear = 0, tiles = 0;
+    reached[start] = 1;
+    queue[rear] = start;
+    queue_rows[rear++] = start_row;
+    while (front < rear) {
+        long r = queue[front];
+        int row = queue_rows[front++];
+        int lo = rle->runs[r].lo - reach, hi = rle->runs[r].hi + reach;
+        tiles += rle->runs[r].hi - rle->runs[r].lo + 1;
+
+        // Queue unreached runs of the adjacent rows that overlap lo..hi
+        for (int nrow = row - 1; nrow <= row + 1; nrow += 2) {
+            if (nrow < 0 || nrow >= rle->rows) {
+                continue;
+            }
+            long end = rle->row_first[nrow + 1];
+            for (long n = mazerle_first_run(rle, nrow, lo); n < end && rle->runs[n].lo <= hi; n++) {
+                if (!reached[n]) {
+                    reached[n] = 1;
+                    queue[rear] = n;
+                    queue_rows[rear++] = nrow;
+                }
+            }
+        }
+    }
+    free(queue);
+    free(queue_rows);
+    return tiles;
+}
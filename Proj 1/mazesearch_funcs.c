@@ -0,0 +1,240 @@
+#include "mazesolve.h"
+#include <pthread.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Concurrent searches of a shared maze
+//
+// A maze_t keeps each tile's type together with the state of the
+// search in progress, so only one search at a time can use it. Here
+// the maze is instead a mazegrid_t which no search modifies and the
+// state of each query lives in a mazesearch_t. Any number of threads
+// may search one grid at the same time, each with its own context,
+// with no locking. A context is reused across queries: rather than
+// clearing its arrays, each query stamps the tiles it reaches with a
+// new epoch number so a tile counts as reached only if its stamp
+// matches the current epoch. A mazepool_t hands out contexts to
+// threads so that they are allocated once rather than per query.
+////////////////////////////////////////////////////////////////////////////////
+
+mazesearch_t *mazesearch_allocate(mazegrid_t *grid)
+// Allocates a search context for queries on `grid` or any grid of the
+// same size and layout. No tile is marked as reached.
+{
+    mazesearch_t *search = malloc(sizeof(mazesearch_t));
+    search->ncells = grid->ncells;
+    search->stamp = calloc(grid->ncells, sizeof(unsigned int));
+    search->epoch = 0;
+    search->dir = malloc(grid->ncells);
+    search->queue = malloc(sizeof(int) * 2 * ((long)grid->rows * grid->cols + 1));
+    search->path = NULL;
+    search->path_capacity = 0;
+    search->expanded = 0;
+    return search;
+}
+
+void mazesearch_free(mazesearch_t *search)
+// De-allocates `search` and its arrays. Does nothing if search is
+// NULL.
+{
+    if (search == NULL) {
+        return;
+    }
+    free(search->stamp);
+    free(search->dir);
+    free(search->queue);
+    free(search->path);
+    free(search);
+}
+
+void mazesearch_reset(mazesearch_t *search)
+// Forgets all tiles reached by the previous query in constant time by
+// moving to a new epoch. Only when the epoch counter wraps around are
+// the stamps actually cleared.
+{
+    search->epoch++;
+    if (search->epoch == 0) {
+        memset(search->stamp, 0, sizeof(unsigned int) * search->ncells);
+        search->epoch = 1;
+    }
+}
+
+long mazesearch_solve(mazesearch_t *search, mazegrid_t *grid, int start_row, int start_col,
+                      int end_row, int end_col)
+// Finds a shortest path from start_row/col to end_row/col in `grid`
+// using the context `search`, which must not be in use by another
+// thread; `grid` is only read. The search is a BFS that stops as soon
+// as the end is reached, after which the path is traced back through
+// the move that reached each tile. Returns the length of the path,
+// whose directions are left in search->path until the next query, or
+// -1 if either tile is blocked or no path exists.
+{
+    mazesearch_reset(search);
+    search->expanded = 0;
+    if (search->ncells < grid->ncells ||
+        !mazegrid_open(grid, start_row, start_col) || !mazegrid_open(grid, end_row, end_col)) {
+        return -1;
+    }
+    int delta_end = (grid->movement == MOVEMENT_8WAY) ? DELTA_COUNT_8WAY : DELTA_COUNT;
+    unsigned int epoch = search->epoch;
+    long end_idx = mazegrid_index(grid, end_row, end_col);
+    long start_idx = mazegrid_index(grid, start_row, start_col);
+    search->stamp[start_idx] = epoch;
+    search->dir[start_idx] = NONE;
+    long front = 0, rear = 0;
+    search->queue[rear++] = start_row;
+    search->queue[rear++] = start_col;
+
+    // Expand tiles until the end is reached or the queue empties
+    int found = (start_idx == end_idx);
+    while (!found && front < rear) {
+        int row = search->queue[front++];
+        int col = search->queue[front++];
+        search->expanded++;
+        for (int d = DELTA_START; d < delta_end; d++) {
+            int nrow = row + row_delta[d];
+            int ncol = col + col_delta[d];
+            long nidx = mazegrid_index(grid, nrow, ncol);
+            if (grid->cells[nidx] == GRID_OPEN && search->stamp[nidx] != epoch) {
+                search->stamp[nidx] = epoch;
+                search->dir[nidx] = dir_delta[d];
+                search->queue[rear++] = nrow;
+                search->queue[rear++] = ncol;
+                if (nidx == end_idx) {
+                    found = 1;
+                    break;
+                }
+            }
+        }
+    }
+    if (!found) {
+        return -1;
+    }
+
+    // Count the moves back to the start, then fill the path from its end
+    long len = 0;
+    int row = end_row, col = end_col;
+    for (direction_t dir; (dir = search->dir[mazegrid_index(grid, row, col)]) != NONE; len++) {
+        row -= row_delta[dir];
+        col -= col_delta[dir];
+    }
+    if (len > search->path_capacity) {
+        search->path_capacity = len;
+        search->path = realloc(search->path, sizeof(direction_t) * len);
+    }
+    row = end_row;
+    col = end_col;
+    for (long k = len - 1; k >= 0; k--) {
+        direction_t dir = search->dir[mazegrid_index(grid, row, col)];
+        search->path[k] = dir;
+        row -= row_delta[dir];
+        col -= col_delta[dir];
+    }
+    return len;
+}
+
+mazepool_t *mazepool_allocate(mazegrid_t *grid, int count)
+// Allocates a pool of `count` search contexts for queries on `grid`.
+{
+    mazepool_t *pool = malloc(sizeof(mazepool_t));
+    pool->count = (count > 0) ? count : 1;
+    pool->searches = malloc(sizeof(mazesearch_t *) * pool->count);
+    pool->in_use = calloc(pool->count, sizeof(int));
+    for (int k = 0; k < pool->count; k++) {
+        pool->searches[k] = mazesearch_allocate(grid);
+    }
+    return pool;
+}
+
+mazesearch_t *mazepool_acquire(mazepool_t *pool)
+// Returns a context from `pool` that no other thread holds or NULL if
+// all are in use. Safe to call from several threads at once: a
+// context is claimed by atomically changing its in_use flag from 0 to
+// 1 so no lock is needed.
+{
+    for (int k = 0; k < pool->count; k++) {
+        if (__atomic_exchange_n(&pool->in_use[k], 1, __ATOMIC_ACQUIRE) == 0) {
+            return pool->searches[k];
+        }
+    }
+    return NULL;
+}
+
+void mazepool_release(mazepool_t *pool, mazesearch_t *search)
+// Returns `search`, obtained from mazepool_acquire(), to `pool` for
+// use by other queries.
+{
+    for (int k = 0; k < pool->count; k++) {
+        if (pool->searches[k] == search) {
+            __atomic_store_n(&pool->in_use[k], 0, __ATOMIC_RELEASE);
+            return;
+        }
+    }
+}
+
+void mazepool_free(mazepool_t *pool)
+// De-allocates `pool` and all its contexts. Does nothing if pool is
+// NULL.
+{
+    if (pool == NULL) {
+        return;
+    }
+    for (int k = 0; k < pool->count; k++) {
+        mazesearch_free(pool->searches[k]);
+    }
+    free(pool->searches);
+    free(pool->in_use);
+    free(pool);
+}
+
+// Shared work for the threads of mazepool_solve_all()
+typedef struct {
+    mazegrid_t *grid;
+    mazepool_t *pool;
+    mazequery_t *queries;
+    int count;
+    int next;                   // index of the next unclaimed query
+} querywork_t;
+
+static void *mazepool_solve_worker(void *arg)
+// Thread function that claims queries one at a time by atomically
+// advancing work->next and solves each with a context from the pool.
+{
+    querywork_t *work = arg;
+    mazesearch_t *search = mazepool_acquire(work->pool);
+    int k;
+    while ((k = __atomic_fetch_add(&work->next, 1, __ATOMIC_RELAXED)) < work->count) {
+        mazequery_t *query = &work->queries[k];
+        query->length = mazesearch_solve(search, work->grid, query->start_row, query->start_col,
+                                         query->end_row, query->end_col);
+    }
+    mazepool_release(work->pool, search);
+    return NULL;
+}
+
+void mazepool_solve_all(mazegrid_t *grid, mazequery_t *queries, int count, int nthreads)
+// Solves all `count` queries on `grid` using `nthreads` threads which
+// share the grid and each take a context from a pool, setting the
+// length field of each query to its path length or -1. Threads take
+// the next unsolved query as they finish one so long and short
+// queries balance out.
+{
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+    if (nthreads > LOAD_THREADS_MAX) {
+        nthreads = LOAD_THREADS_MAX;
+    }
+    querywork_t work = {grid, mazepool_allocate(grid, nthreads), queries, count, 0};
+    pthread_t threads[LOAD_THREADS_MAX];
+    int started[LOAD_THREADS_MAX];
+    for (int t = 1; t < nthreads; t++) {
+        started[t] = pthread_create(&threads[t], NULL, mazepool_solve_worker, &work) == 0;
+    }
+    mazepool_solve_worker(&work);
+    for (int t = 1; t < nthreads; t++) {
+        if (started[t]) {
+            pthread_join(threads[t], NULL);
+        }
+    }
+    mazepool_free(work.pool);
+}
@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>             // for variadic functions in testing
+#include <limits.h>
 
 ////////////////////////////////////////////////////////////////////////////////
 // rcqueue_t data
@@ -17,7 +18,9 @@ typedef struct rcnode {         // node type for row/col queues
 
 typedef struct {                // queue type for row/col coordinates
   rcnode_t *front, *rear;       // pointers to ends of queue
-  int count;                    // number of nodes in queue
+  long count;                   // number of nodes in queue
+  rcnode_t *ahead;              // node `lead` places behind front or NULL
+  int lead;                     // how far ahead is behind front, 0 if untracked
 } rcqueue_t;
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -29,6 +32,10 @@ typedef enum {                  // allowable directions for neighbors
   SOUTH,                        // Same as integer 2
   WEST,                         // Same as integer 3
   EAST,                         // Same as integer 4
+  NORTHWEST,                    // Same as integer 5, only used in 8-way movement
+  NORTHEAST,                    // Same as integer 6, only used in 8-way movement
+  SOUTHWEST,                    // Same as integer 7, only used in 8-way movement
+  SOUTHEAST,                    // Same as integer 8, only used in 8-way movement
 } direction_t;
 // EXAMPLE USE:
 // direction_t dirs[5] = {NORTH, WEST, WEST, SOUTH, SOUTH};
@@ -63,16 +70,57 @@ typedef struct {                // tile data for positions in a 2D maze
   tiletype_t type;              // One of NOTSET, OPEN, WALL, ONPATH, START, END
   searchstate_t state;          // One of NOT_FOUND, QUEUED, DONE
   direction_t *path;            // array of directions from start to this position
-  int path_len;                 // length of path array
+  unsigned char *packed;        // alternative to path: 2 bits per move, 4 moves per byte
+  long path_len;                // length of path array
+  unsigned char open_mask;      // bit d-1 set if the neighbor in direction d is not blocked
 } tile_t;
+// Only one of path/packed is non-NULL for a tile that has a path. The
+// packed form stores NORTH/SOUTH/WEST/EAST as 0-3 so can only hold
+// 4-way paths; use tile_path_dir() to read either form.
+#define PACKED_BYTES(len) (((len) + 3) / 4)
+#define PACKED_GET(bytes, i) \
+  ((direction_t) ((((bytes)[(i) >> 2] >> (((i) & 3) * 2)) & 3) + NORTH))
+
+typedef struct {                // one run of identical moves in a path
+  direction_t dir;              // direction of every move in the run
+  int count;                    // number of consecutive moves in dir
+} dirrun_t;
+
+typedef struct {                // run-length encoded path, e.g. N12E3S40
+  dirrun_t *runs;               // array of runs in path order
+  long run_count;               // number of elements in runs
+  long path_len;                // number of moves, the sum of run counts
+} rlepath_t;
 
 typedef struct {                // maze data tracking shape of maze and state of BFS search
   tile_t **tiles;               // 2D array of tiles
   int rows, cols;               // number of rows/cols in the 2D tile array
   int start_row, start_col;     // starting position in the maze
   int end_row, end_col;         // ending position in the maze
+  long start_count, end_count;  // number of START/END tiles read from a file
   rcqueue_t *queue;             // queue of coordinates to search
+  int movement;                 // MOVEMENT_4WAY (default 0) or MOVEMENT_8WAY
+  int pack_paths;               // 1 to store 4-way BFS paths in tile packed fields
+  int bordered;                 // 1 if tiles has a hidden border of WALL tiles
+  int masks_ready;              // 1 if tile open_mask fields are up to date
+  int alloc;                    // how the tiles were allocated, one of MAZE_ALLOC_*
+  int path_top, path_bottom;    // box of the tiles that may have paths, empty
+  int path_left, path_right;    // if top > bottom; see maze_note_path()
 } maze_t;
+// Mazes from maze_allocate() are bordered: tiles[-1..rows][-1..cols]
+// are all valid with the rows/cols outside 0..rows-1/0..cols-1 being
+// WALL tiles that are never printed. BFS can then look at any
+// neighbor of an in-bounds tile without checking bounds.
+// Each of rows/cols fits an int but rows*cols may not, so tile
+// indices, tile and queue counts, and path lengths are all long.
+
+// symbols for how the tiles of a maze_t are allocated
+#define MAZE_ALLOC_ROWS   0     // a malloc() per row and every tile initialized
+#define MAZE_ALLOC_CALLOC 1     // one zero-filled calloc() block of all rows
+#define MAZE_ALLOC_MMAP   2     // one anonymous mmap() of all rows, pages zeroed on first touch
+
+#define MAZE_MMAP_BYTES (1L << 20)  // lazy tile blocks this large are mmap()'d
+#define MAZE_MAX_DIM (INT_MAX - 2)  // largest rows/cols so the border indices fit an int
 
 ////////////////////////////////////////////////////////////////////////////////
 // other defined symbols 
@@ -81,6 +129,17 @@ typedef struct {                // maze data tracking shape of maze and state of
 // symbols defining the format for paths
 #define PATH_FORMAT_COMPACT 1  
 #define PATH_FORMAT_VERBOSE 2
+#define PATH_FORMAT_RLE     3
+
+// symbols for the neighbors a BFS step may move to; 4-way is the
+// default so that a zero-initialized maze searches NORTH/SOUTH/WEST/EAST
+#define MOVEMENT_4WAY 0
+#define MOVEMENT_8WAY 1
+
+// open_mask bits used by each movement: NORTH..EAST are bits 0-3 and
+// the diagonals bits 4-7
+#define OPEN_MASK_4WAY 0x0F
+#define OPEN_MASK_8WAY 0xFF
 
 // symbols associated with log levels
 #define LOG_BFS_STEPS      1
@@ -91,27 +150,518 @@ typedef struct {                // maze data tracking shape of maze and state of
 #define LOG_FILE_LOAD      6
 #define LOG_ALL           10
 
+// BFS steps between clock checks in maze_bfs_advance()
+#define BFS_CLOCK_STEPS 32
+
+// queue entries ahead of the one being expanded whose tiles a BFS
+// prefetches; the initial value of BFS_PREFETCH
+#define BFS_PREFETCH_DISTANCE 8
+
+// most threads used by maze_from_file_parallel()
+#define LOAD_THREADS_MAX 64
+
+////////////////////////////////////////////////////////////////////////////////
+// mazegrid_t data
+////////////////////////////////////////////////////////////////////////////////
+
+// symbols for the byte stored per tile in a mazegrid_t
+#define GRID_WALL 0
+#define GRID_OPEN 1
+
+// sources searched together by mazegrid_msbfs(), one per bit of a word
+#define MSBFS_BATCH 64
+
+// widest spread of a batch of sources, in rows plus cols of their
+// bounding box, searched bit-parallel rather than one BFS per source;
+// the initial value of MSBFS_SPREAD
+#define MSBFS_SPREAD_DEFAULT 64
+
+// symbols for the order tiles are stored in memory in a mazegrid_t
+#define GRID_LAYOUT_ROWMAJOR 0  // row after row as in maze_t
+#define GRID_LAYOUT_BLOCKED  1  // 8x8 blocks of tiles, each block contiguous
+
+#define GRID_BLOCK_SHIFT 3      // blocks are 2^3 = 8 tiles on a side
+#define GRID_BLOCK_MASK  7      // row/col within a block
+
+// The blocked layout applies to searches on a mazegrid_t only;
+// maze_t tiles are always row-major.
+typedef struct {                // compact copy of maze tiles used for fast searches
+  unsigned char *cells;         // GRID_OPEN/GRID_WALL per tile, indexed via mazegrid_index()
+  int rows, cols;               // number of rows/cols of tiles
+  int layout;                   // one of GRID_LAYOUT_ROWMAJOR / GRID_LAYOUT_BLOCKED
+  int block_cols;               // number of blocks across a row of blocks
+  long ncells;                  // number of cells, includes the border and partial blocks
+  int movement;                 // MOVEMENT_4WAY or MOVEMENT_8WAY as in maze_t
+} mazegrid_t;
+
+// Returns the position of tile row/col in the cells of `grid` or any
+// per-tile array laid out like it. In the blocked layout each 8x8
+// block of tiles occupies 64 consecutive cells so the NORTH/SOUTH
+// neighbors of a tile are usually 8 cells away rather than a whole
+// row away as in the row-major layout. Like maze_t, grids have a
+// hidden border of GRID_WALL cells so rows -1 and `rows` and cols -1
+// and `cols` are valid positions; visible tile (0,0) is stored at
+// position (1,1) of the padded grid.
+static inline long mazegrid_index(mazegrid_t *grid, int row, int col){
+  row++;
+  col++;
+  if (grid->layout == GRID_LAYOUT_BLOCKED) {
+    long block = (long)(row >> GRID_BLOCK_SHIFT) * grid->block_cols + (col >> GRID_BLOCK_SHIFT);
+    return (block << (2 * GRID_BLOCK_SHIFT))
+      | ((row & GRID_BLOCK_MASK) << GRID_BLOCK_SHIFT)
+      | (col & GRID_BLOCK_MASK);
+  }
+  return (long)row * (grid->cols + 2) + col;
+}
+
+// State of one query on a shared mazegrid_t; see mazesearch_funcs.c
+typedef struct {
+  long ncells;                  // size of the per-tile arrays, grid->ncells
+  unsigned int *stamp;          // tile was reached by this query if stamp == epoch
+  unsigned int epoch;           // advanced by each query instead of clearing stamps
+  unsigned char *dir;           // move that reached each tile, NONE for the start
+  int *queue;                   // row/col pairs of tiles to expand
+  direction_t *path;            // path found by the last query
+  long path_capacity;           // number of directions path has room for
+  long expanded;                // tiles expanded by the last query
+} mazesearch_t;
+
+typedef struct {                // one START/END query on a shared grid
+  int start_row, start_col;
+  int end_row, end_col;
+  long length;                  // path length found or -1 if none
+} mazequery_t;
+
+typedef struct {                // reusable search contexts shared by threads
+  mazesearch_t **searches;      // the contexts
+  int *in_use;                  // 1 while a thread holds searches[k]
+  int count;                    // number of contexts
+} mazepool_t;
+
+////////////////////////////////////////////////////////////////////////////////
+// run-length encoded maze data
+////////////////////////////////////////////////////////////////////////////////
+
+typedef struct {                // run of consecutive open tiles in a row
+  int lo, hi;                   // first and last column of the run
+} interval_t;
+
+typedef struct {                // maze stored as runs of open tiles per row
+  int rows, cols;               // size of the maze
+  long *row_first;              // runs of row i are row_first[i] to row_first[i+1]-1
+  interval_t *runs;             // runs of all rows in row-major order
+  long run_count;               // number of runs
+  int start_row, start_col;     // START tile or -1
+  int end_row, end_col;         // END tile or -1
+  int movement;                 // MOVEMENT_4WAY or MOVEMENT_8WAY
+} mazerle_t;
+
+////////////////////////////////////////////////////////////////////////////////
+// distance field file data
+////////////////////////////////////////////////////////////////////////////////
+
+#define DISTFILE_MAGIC "MZDIST1"  // first bytes of a distance field file
+
+typedef struct {                // header at the start of a distance field file
+  char magic[8];                // DISTFILE_MAGIC with its terminating \0
+  int rows, cols;               // number of rows/cols of distances that follow
+  int elem_size;                // 2 for uint16_t distances, 4 for int32_t
+  int start_row, start_col;     // tile the distances are measured from
+} distfile_header_t;
+// The header is followed by rows*cols distances in row-major order.
+// Unreachable tiles are stored as -1 for int32_t or 0xFFFF for
+// uint16_t; uint16_t is used when every distance is below 0xFFFF.
+
+typedef struct {                // read-only memory mapped distance field file
+  distfile_header_t *header;    // start of the mapping
+  void *dists;                  // distances following the header
+  size_t map_len;               // length of the mapping in bytes
+} distmap_t;
+
+////////////////////////////////////////////////////////////////////////////////
+// junction graph data
+////////////////////////////////////////////////////////////////////////////////
+
+// A mazegraph_t contracts the corridors of a maze: its nodes are the
+// tiles that do not have exactly two open neighbors (junctions and
+// dead ends) along with every START and END tile. Each edge is a
+// corridor between two nodes, stored as its length and the runs of
+// directions that walk it. Every corridor has an edge in each
+// direction.
+
+typedef struct {                // junction, dead end, START, or END tile
+  int row, col;                 // position of the tile in the maze
+  int first_edge;               // index in edges of the first edge leaving the node
+  int edge_count;               // number of edges leaving the node
+} graphnode_t;
+
+typedef struct {                // corridor leaving a node
+  int target;                   // index of the node at the other end
+  long length;                  // number of moves along the corridor
+  int first_run;                // index in runs of the first run of moves
+  int run_count;                // number of runs of moves along the corridor
+} graphedge_t;
+
+typedef struct {                // weighted graph of the corridors of a maze
+  graphnode_t *nodes;           // nodes in row-major order of their tiles
+  int node_count;
+  graphedge_t *edges;           // edges grouped by the node they leave
+  int edge_count;
+  dirrun_t *runs;               // direction runs of all edges, edge after edge
+  int run_count;
+  int *node_of;                 // rows*cols node index of each tile or -1
+  int rows, cols;               // size of the maze the graph was built from
+} mazegraph_t;
+
+typedef struct {                // entry in a minheap_t
+  long key;                     // priority; smallest keys are removed first
+  int item;                     // caller's index for the entry
+} heapentry_t;
+
+typedef struct {                // binary min-heap for Dijkstra/A* searches
+  heapentry_t *entries;         // entries[0] has the smallest key
+  int count, capacity;
+} minheap_t;
+
+////////////////////////////////////////////////////////////////////////////////
+// hierarchical abstraction data
+////////////////////////////////////////////////////////////////////////////////
+
+#define HPA_CLUSTER_SIZE   16     // default tiles on a side of a cluster
+#define HPA_ENTRANCE_SPLIT  6     // entrances this wide get two transitions
+#define HPA_CLUSTER_MAX  4096     // largest cluster side so size*size fits an int
+#define HPAFILE_MAGIC "MZHPA3"    // first bytes of an abstraction file
+
+typedef struct {                // clusters and entrances of a maze for repeated queries
+  int rows, cols;               // size of the maze the abstraction was built from
+  int cluster_size;             // tiles on a side of each square cluster
+  int cluster_rows, cluster_cols; // number of clusters down/across the maze
+  int *cluster_first;           // nodes of cluster c are cluster_first[c] to cluster_first[c+1]-1
+  graphnode_t *nodes;           // entrance tiles sorted by cluster then row/col
+  int node_count;
+  graphedge_t *edges;           // transitions and distances within clusters; runs unused
+  int edge_count;
+  unsigned long key;            // mazecache_maze_key() of the maze it was built from
+} mazehpa_t;
+
+typedef struct {                // header at the start of an abstraction file
+  char magic[8];                // HPAFILE_MAGIC with its terminating \0
+  unsigned long key;            // mazecache_maze_key() of the maze
+  int rows, cols;               // size of the maze
+  int cluster_size;             // tiles on a side of each cluster
+  int node_count, edge_count;   // number of nodes/edges that follow
+} hpafile_header_t;
+// The header is followed by the cluster_first, nodes, and edges arrays
+// of the mazehpa_t in that order.
+
+////////////////////////////////////////////////////////////////////////////////
+// landmark (ALT) data
+////////////////////////////////////////////////////////////////////////////////
+
+#define ALT_LANDMARKS 8           // default number of landmarks in main
+#define ALT_LANDMARKS_MAX 64      // most landmarks in one file
+#define ALTFILE_MAGIC "MZALT2"    // first bytes of a landmark file
+
+typedef struct {                // header at the start of a landmark file
+  char magic[8];                // ALTFILE_MAGIC with its terminating \0
+  unsigned long key;            // mazecache_maze_key() of the maze
+  int rows, cols;               // size of the maze
+  int movement;                 // movement the distances were found with
+  int count;                    // number of landmarks
+  int elem_size;                // 2 for uint16_t distances, 4 for uint32_t
+  int landmarks[2 * ALT_LANDMARKS_MAX]; // row/col pairs of the landmarks
+} altfile_header_t;
+// The header is followed by `count` arrays of rows*cols distances in
+// row-major order, one per landmark. Tiles a landmark cannot reach
+// have distance 0xFFFF or 0xFFFFFFFF; uint16_t is used when every
+// other distance is smaller than that.
+
+typedef struct {                // landmark distances for A* heuristics
+  altfile_header_t *header;     // start of the data, as laid out in a file
+  void *dists;                  // distance arrays following the header
+  size_t data_len;              // bytes of header and distances
+  int mapped;                   // 1 if the data is a mapping of a file, 0 if malloc()'d
+} mazealt_t;
+
+////////////////////////////////////////////////////////////////////////////////
+// BFS checkpoint data
+////////////////////////////////////////////////////////////////////////////////
+
+#define CKPTFILE_MAGIC "MZCKPT2"  // first bytes of a checkpoint file
+#define CHECKPOINT_STEPS (1 << 20)  // BFS steps between checkpoints in main
+
+typedef struct {                // header at the start of a checkpoint file
+  char magic[8];                // CKPTFILE_MAGIC with its terminating \0
+  unsigned long key;            // mazecache_maze_key() of the maze with its START/END
+  int rows, cols;               // size of the maze
+  int movement;                 // movement of the search
+  int pack_paths;               // pack_paths setting of the search
+  long queue_count;             // number of row/col pairs in the queue
+} ckptfile_header_t;
+// The header is followed by one byte per tile in row-major order and
+// the queue as queue_count row/col pairs of ints. Each tile byte packs
+// its search state and the last move of its path, NONE for tiles that
+// are not FOUND and for the origins of the search.
+#define CKPT_TILE(state, dir) ((unsigned char) (((state) << 4) | (dir)))
+#define CKPT_STATE(byte) ((searchstate_t) ((byte) >> 4))
+#define CKPT_DIR(byte) ((direction_t) ((byte) & 0x0F))
+
+////////////////////////////////////////////////////////////////////////////////
+// solution cache data
+////////////////////////////////////////////////////////////////////////////////
+
+#define CACHEFILE_MAGIC "MZSOLN2" // first bytes of a cached solution file
+#define CACHE_MAX_BYTES (16L << 20)  // default size limit of a cache directory
+#define CACHE_MISS -1             // mazecache_lookup() found no entry
+
+typedef struct {                // header at the start of a cached solution file
+  char magic[8];                // CACHEFILE_MAGIC with its terminating \0
+  unsigned long key;            // key from mazecache_key() of the solved maze
+  int rows, cols;               // size of the maze
+  int start_row, start_col;     // START tile of the maze
+  int end_row, end_col;         // END tile of the maze
+  int movement;                 // movement of the search
+  long path_len;                // moves in the solution or -1 if there is none
+  long run_count;               // number of dirrun_t runs that follow
+} cachefile_header_t;
+// A cache is a directory holding one file per solved maze, named by
+// its key in hex with a .sol suffix, along with a stats file counting
+// hits and misses over all runs. Each solution is stored run-length
+// encoded as the header followed by run_count dirrun_t runs.
+
+typedef struct {                // solution cache directory opened by mazecache_open()
+  char *dir;                    // directory holding the cache files
+  long max_bytes;               // total size of .sol files kept after eviction
+  long hits, misses;            // lookups made through this mazecache_t
+} mazecache_t;
+
+////////////////////////////////////////////////////////////////////////////////
+// compressed sparse row graph data
+////////////////////////////////////////////////////////////////////////////////
+
+// symbols for the order open tiles are numbered in a mazecsr_t
+#define CSR_ORDER_BFS     0     // order reached by BFS from START, region by region
+#define CSR_ORDER_HILBERT 1     // order along a Hilbert curve over the maze
+
+typedef struct {                // adjacency of the open tiles of a maze only
+  int node_count;               // number of open tiles, each a node
+  int *first;                   // neighbors of node n are targets[first[n]] to targets[first[n+1]-1]
+  int *targets;                 // neighbor nodes of all nodes, node after node
+  int *node_row, *node_col;     // tile of each node
+  int *node_of;                 // rows*cols node of each tile or -1 for blocked tiles
+  int rows, cols;               // size of the maze the graph was built from
+  int movement;                 // MOVEMENT_4WAY or MOVEMENT_8WAY as in maze_t
+  int order;                    // CSR_ORDER_BFS or CSR_ORDER_HILBERT
+} mazecsr_t;
+// Neighbors of each node are listed in the order of dir_delta[] so a
+// BFS on the graph reaches tiles in the same order as maze_bfs_step().
+
+////////////////////////////////////////////////////////////////////////////////
+// shortest path counting data
+////////////////////////////////////////////////////////////////////////////////
+
+#define PATHS_SATURATED (~0UL)  // count of more paths than an unsigned long holds
+
+typedef struct {                // lazy enumeration of the shortest paths to a tile
+  mazegrid_t *grid;             // grid searched by mazegrid_count_paths()
+  int *dist;                    // distances it found, laid out like the grid cells
+  long len;                     // moves in every shortest path
+  int *rows, *cols;             // tile at each distance along the current path
+  int *choice;                  // index in dir_delta[] of the move into each tile
+  direction_t *path;            // directions of the current path
+  int started;                  // 1 once the first path has been produced
+} pathenum_t;
+
 ////////////////////////////////////////////////////////////////////////////////
 // functions and data in mazesolve_funcs.c
 ////////////////////////////////////////////////////////////////////////////////
 
+// neighbor order and row/col changes for each direction; 4-way
+// movement uses indices DELTA_START to below DELTA_COUNT, 8-way
+// movement continues to below DELTA_COUNT_8WAY
+#define DELTA_START 1
+#define DELTA_COUNT 5
+#define DELTA_COUNT_8WAY 9
+extern direction_t dir_delta[];
+extern int row_delta[];
+extern int col_delta[];
+extern char tiletype_chars[];
+extern char *direction_compact_strs[];
+
 extern int LOG_LEVEL;
+extern int BFS_PREFETCH;
+extern int MSBFS_SPREAD;
 rcqueue_t *rcqueue_allocate();
 void rcqueue_add_rear(rcqueue_t *queue, int row, int col);
 void rcqueue_free(rcqueue_t *queue);
 int rcqueue_get_front(rcqueue_t *queue, int *rowp, int *colp);
 int rcqueue_remove_front(rcqueue_t *queue);
+void rcqueue_set_lead(rcqueue_t *queue, int lead);
 void rcqueue_print(rcqueue_t *queue);
+int tile_has_path(tile_t *tile);
+direction_t tile_path_dir(tile_t *tile, long i);
 void tile_print_path(tile_t *tile, int format);
 void tile_extend_path(tile_t *src, tile_t *dst, direction_t dir);
+rlepath_t *rlepath_from_tile(tile_t *tile);
+rlepath_t *rlepath_parse(char *str);
+direction_t *rlepath_expand(rlepath_t *rle);
+void rlepath_print(rlepath_t *rle);
+void rlepath_free(rlepath_t *rle);
 maze_t *maze_allocate(int rows, int cols);
+maze_t *maze_allocate_lazy(int rows, int cols);
+void maze_note_path(maze_t *maze, int row, int col);
 void maze_free(maze_t *maze);
 int maze_tile_blocked(maze_t *maze, int row, int col);
+void maze_compute_row_masks(maze_t *maze, int row);
+void maze_compute_masks(maze_t *maze);
+long maze_fill_dead_ends(maze_t *maze, int **filledp);
+void maze_restore_dead_ends(maze_t *maze, int *filled, long count);
 void maze_print_tiles(maze_t *maze);
 void maze_print_state(maze_t *maze);
 void maze_bfs_init(maze_t *maze);
 int maze_bfs_process_neighbor(maze_t *maze, int cur_row, int cur_col, direction_t dir);
 int maze_bfs_step(maze_t *maze);
 void maze_bfs_iterate(maze_t *maze);
+int maze_bfs_advance(maze_t *maze, long max_steps, long max_usec);
+void maze_bfs_cancel(maze_t *maze);
+int maze_bfs_nearest(maze_t *maze);
 int maze_set_solution(maze_t *maze);
 maze_t *maze_from_file(char *fname);
+
+////////////////////////////////////////////////////////////////////////////////
+// functions in mazegrid_funcs.c
+////////////////////////////////////////////////////////////////////////////////
+
+mazegrid_t *mazegrid_allocate(int rows, int cols, int layout);
+mazegrid_t *mazegrid_from_maze(maze_t *maze, int layout);
+void mazegrid_free(mazegrid_t *grid);
+int mazegrid_open(mazegrid_t *grid, int row, int col);
+long mazegrid_bfs(mazegrid_t *grid, int start_row, int start_col, int *dist);
+int mazegrid_source_spread(mazegrid_t *grid, int count, int *rows, int *cols);
+long mazegrid_msbfs(mazegrid_t *grid, int count, int *rows, int *cols, int *dist);
+void mazegrid_msbfs_to(mazegrid_t *grid, int count, int *rows, int *cols,
+                       int target_row, int target_col, int *target_dist);
+long maze_write_distances(maze_t *maze, char *fname);
+distmap_t *distmap_open(char *fname);
+int distmap_get(distmap_t *map, int row, int col);
+void distmap_close(distmap_t *map);
+
+////////////////////////////////////////////////////////////////////////////////
+// functions in mazerle_funcs.c
+////////////////////////////////////////////////////////////////////////////////
+
+mazerle_t *mazerle_from_maze(maze_t *maze);
+mazerle_t *mazerle_from_file(char *fname);
+void mazerle_free(mazerle_t *rle);
+long mazerle_find_run(mazerle_t *rle, int row, int col);
+long mazerle_reach(mazerle_t *rle, int start_row, int start_col, unsigned char *reached);
+
+////////////////////////////////////////////////////////////////////////////////
+// functions in mazesearch_funcs.c
+////////////////////////////////////////////////////////////////////////////////
+
+mazesearch_t *mazesearch_allocate(mazegrid_t *grid);
+void mazesearch_free(mazesearch_t *search);
+void mazesearch_reset(mazesearch_t *search);
+long mazesearch_solve(mazesearch_t *search, mazegrid_t *grid, int start_row, int start_col,
+                      int end_row, int end_col);
+mazepool_t *mazepool_allocate(mazegrid_t *grid, int count);
+mazesearch_t *mazepool_acquire(mazepool_t *pool);
+void mazepool_release(mazepool_t *pool, mazesearch_t *search);
+void mazepool_free(mazepool_t *pool);
+void mazepool_solve_all(mazegrid_t *grid, mazequery_t *queries, int count, int nthreads);
+
+////////////////////////////////////////////////////////////////////////////////
+// functions in mazeload_funcs.c
+////////////////////////////////////////////////////////////////////////////////
+
+maze_t *maze_from_file_parallel(char *fname, int nthreads);
+
+////////////////////////////////////////////////////////////////////////////////
+// functions in mazegraph_funcs.c
+////////////////////////////////////////////////////////////////////////////////
+
+minheap_t *minheap_allocate(int capacity);
+void minheap_push(minheap_t *heap, long key, int item);
+int minheap_pop(minheap_t *heap, long *keyp, int *itemp);
+void minheap_free(minheap_t *heap);
+mazegraph_t *mazegraph_from_maze(maze_t *maze);
+void mazegraph_free(mazegraph_t *graph);
+direction_t *mazegraph_shortest_path(mazegraph_t *graph, int start_row, int start_col,
+                                     int end_row, int end_col, long *lenp);
+int maze_solve_graph(maze_t *maze, mazegraph_t *graph);
+
+////////////////////////////////////////////////////////////////////////////////
+// functions in mazehpa_funcs.c
+////////////////////////////////////////////////////////////////////////////////
+
+mazehpa_t *mazehpa_build(maze_t *maze, int cluster_size);
+void mazehpa_free(mazehpa_t *hpa);
+int mazehpa_write(mazehpa_t *hpa, char *fname);
+mazehpa_t *mazehpa_read(char *fname, maze_t *maze);
+direction_t *mazehpa_find_path(maze_t *maze, mazehpa_t *hpa, int start_row, int start_col,
+                               int end_row, int end_col, long *lenp);
+int maze_solve_hpa(maze_t *maze, mazehpa_t *hpa);
+
+////////////////////////////////////////////////////////////////////////////////
+// functions in mazeckpt_funcs.c
+////////////////////////////////////////////////////////////////////////////////
+
+int maze_bfs_checkpoint(maze_t *maze, char *fname);
+int maze_bfs_resume(maze_t *maze, char *fname);
+
+////////////////////////////////////////////////////////////////////////////////
+// functions in mazecache_funcs.c
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned long mazecache_key(char *fname, maze_t *maze);
+unsigned long mazecache_maze_key(maze_t *maze, int with_ends);
+mazecache_t *mazecache_open(char *dir, long max_bytes);
+int mazecache_lookup(mazecache_t *cache, unsigned long key, maze_t *maze);
+int mazecache_store(mazecache_t *cache, unsigned long key, maze_t *maze, int found);
+long mazecache_evict(mazecache_t *cache);
+void mazecache_close(mazecache_t *cache, long *total_hitsp, long *total_missesp);
+
+////////////////////////////////////////////////////////////////////////////////
+// functions in mazealt_funcs.c
+////////////////////////////////////////////////////////////////////////////////
+
+mazealt_t *mazealt_build(maze_t *maze, int count);
+int mazealt_write(mazealt_t *alt, char *fname);
+mazealt_t *mazealt_open(char *fname, int use_mmap);
+void mazealt_free(mazealt_t *alt);
+long mazealt_dist(mazealt_t *alt, int k, int row, int col);
+long mazealt_bound(mazealt_t *alt, int row, int col, int end_row, int end_col);
+int maze_astar_fits(maze_t *maze);
+direction_t *maze_astar_path(maze_t *maze, mazealt_t *alt, int start_row, int start_col,
+                             int end_row, int end_col, long *lenp, long *expandedp);
+int maze_solve_astar(maze_t *maze, mazealt_t *alt, long *expandedp);
+
+////////////////////////////////////////////////////////////////////////////////
+// functions in mazediam_funcs.c
+////////////////////////////////////////////////////////////////////////////////
+
+long mazegrid_diameter(mazegrid_t *grid, int row, int col, int *sweepsp,
+                       int *ecc_lo, int *ecc_hi);
+
+////////////////////////////////////////////////////////////////////////////////
+// functions in mazecsr_funcs.c
+////////////////////////////////////////////////////////////////////////////////
+
+mazecsr_t *mazecsr_from_maze(maze_t *maze, int order);
+void mazecsr_free(mazecsr_t *csr);
+int mazecsr_node(mazecsr_t *csr, int row, int col);
+int mazecsr_bfs(mazecsr_t *csr, int source, int *dist, int *parent);
+direction_t *mazecsr_shortest_path(mazecsr_t *csr, int start_row, int start_col,
+                                   int end_row, int end_col, long *lenp);
+int maze_solve_csr(maze_t *maze, mazecsr_t *csr);
+
+////////////////////////////////////////////////////////////////////////////////
+// functions in mazecount_funcs.c
+////////////////////////////////////////////////////////////////////////////////
+
+long mazegrid_count_paths(mazegrid_t *grid, int start_row, int start_col,
+                          int *dist, unsigned long *counts);
+pathenum_t *pathenum_start(mazegrid_t *grid, int *dist, int end_row, int end_col);
+int pathenum_next(pathenum_t *pe);
+void pathenum_free(pathenum_t *pe);
@@ -0,0 +1,800 @@
+// mazesolve_bench.c: timing experiments for maze search layouts and
+// kernels. Mazes are generated in memory so that sizes well beyond
+// what is practical to store as text files can be tried. Build with
+// 'make bench' which compiles with optimization.
+//
+// > ./mazesolve_bench layout 4096 16384
+//   Compares mazegrid_bfs() on row-major and 8x8 blocked grid layouts;
+//   maze_t searches stay row-major and are not affected
+//
+// > ./mazesolve_bench slices 512 512
+//   Interleaves several maze_t searches on one thread with
+//   maze_bfs_advance() and reports the latency of each time slice
+//
+// > ./mazesolve_bench msbfs 512 512
+//   Compares separate BFS runs from 64 sources with one multi-source
+//   BFS that searches all of them together, bit-parallel and as
+//   chosen by source spread, for sources spread ever further apart
+//
+// > ./mazesolve_bench alt 511 511
+//   Compares tiles expanded by A* with the Manhattan distance alone
+//   and with landmark bounds on a winding maze
+//
+// > ./mazesolve_bench diameter 1023 1023
+//   Finds the exact diameter of winding, random, and open mazes and
+//   reports the BFS passes needed
+//
+// > ./mazesolve_bench csr 2047 2047
+//   Compares BFS on grid layouts with BFS on a graph of only the open
+//   tiles numbered in BFS and Hilbert order
+//
+// > ./mazesolve_bench alloc 4096 4096
+//   Compares allocating a maze with maze_allocate() and with
+//   maze_allocate_lazy(), alone and followed by a pass setting tiles
+//
+// > ./mazesolve_bench prefetch 4096 8192
+//   Compares BFS with and without prefetching the tiles of queue
+//   entries ahead of the one expanded, on a tile maze larger than
+//   the last level cache
+//
+// > ./mazesolve_bench giant 100000 100000
+//   Lazily allocates a maze of more than 2^31 tiles and solves a walled
+//   room in its far corner, checking tile indices and path lengths
+//   past 32 bits while only the touched pages get memory
+//
+// Where the kernel allows it, hardware cache misses are counted via
+// perf_event_open(); on systems without access to counters they are
+// reported as n/a and only times are shown, except that the layout
+// mode then replays each search through a model of an L2 cache and
+// reports its misses instead.
+
+#include "mazesolve.h"
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#define USAGE "usage: %s layout|slices|msbfs|alt|diameter|csr|alloc|prefetch|giant [rows cols]\n"
+
+// Returns the current time in milliseconds from a monotonic clock
+double now_ms(){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1.0e6;
+}
+
+// Opens a counter for last-level cache misses of this process;
+// returns -1 if counters are unavailable
+int cache_counter_open(){
+  struct perf_event_attr pe;
+  memset(&pe, 0, sizeof(pe));
+  pe.type = PERF_TYPE_HARDWARE;
+  pe.size = sizeof(pe);
+  pe.config = PERF_COUNT_HW_CACHE_MISSES;
+  pe.disabled = 1;
+  pe.exclude_kernel = 1;
+  pe.exclude_hv = 1;
+  return syscall(__NR_perf_event_open, &pe, 0, -1, -1, 0);
+}
+
+void cache_counter_start(int fd){
+  if(fd >= 0){
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+}
+
+// Stops the counter and prints its value or n/a
+void cache_counter_report(int fd){
+  long long misses;
+  if(fd >= 0){
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    if(read(fd, &misses, sizeof(misses)) == sizeof(misses)){
+      printf(" cache-misses %12lld", misses);
+      return;
+    }
+  }
+  printf(" cache-misses %12s", "n/a");
+}
+
+// Model of an L2 cache: SIMCACHE_BYTES in 64-byte lines,
+// SIMCACHE_WAYS-way set associative with LRU replacement. Used to
+// count misses when hardware counters are unavailable.
+#define SIMCACHE_BYTES (1L << 20)
+#define SIMCACHE_WAYS 16
+#define SIMCACHE_LINE_SHIFT 6
+
+typedef struct {
+  uintptr_t *tags;              // lines held by each set, most recent first, 0 if empty
+  long sets;                    // number of sets
+  long accesses, misses;        // counts since simcache_allocate()
+} simcache_t;
+
+simcache_t *simcache_allocate(){
+  simcache_t *sim = malloc(sizeof(simcache_t));
+  sim->sets = (SIMCACHE_BYTES >> SIMCACHE_LINE_SHIFT) / SIMCACHE_WAYS;
+  sim->tags = calloc(sim->sets * SIMCACHE_WAYS, sizeof(uintptr_t));
+  sim->accesses = sim->misses = 0;
+  return sim;
+}
+
+void simcache_free(simcache_t *sim){
+  free(sim->tags);
+  free(sim);
+}
+
+// Touches the line holding `addr`, counting a miss if it is not held
+// and moving it to the front of its set either way
+void simcache_access(simcache_t *sim, void *addr){
+  uintptr_t line = ((uintptr_t)addr >> SIMCACHE_LINE_SHIFT) + 1;
+  uintptr_t *set = &sim->tags[(line % sim->sets) * SIMCACHE_WAYS];
+  int w = 0;
+  while(w < SIMCACHE_WAYS - 1 && set[w] != line){
+    w++;
+  }
+  sim->accesses++;
+  if(set[w] != line){
+    sim->misses++;
+  }
+  memmove(&set[1], &set[0], sizeof(uintptr_t) * w);
+  set[0] = line;
+}
+
+// Repeats the memory accesses of mazegrid_bfs() from row/col through
+// `sim`: the queue, the expanded tile's distance, and each neighbor's
+// cell and distance. `dist` is overwritten.
+void simcache_replay_bfs(simcache_t *sim, mazegrid_t *grid, int row, int col, int *dist){
+  for(long i=0; i<grid->ncells; i++){
+    dist[i] = -1;
+  }
+  int delta_end = (grid->movement == MOVEMENT_8WAY) ? DELTA_COUNT_8WAY : DELTA_COUNT;
+  int *queue = malloc(sizeof(int) * 2 * ((long)grid->rows * grid->cols));
+  long front = 0, rear = 0;
+  dist[mazegrid_index(grid, row, col)] = 0;
+  queue[rear++] = row;
+  queue[rear++] = col;
+  while(front < rear){
+    simcache_access(sim, &queue[front]);
+    row = queue[front++];
+    col = queue[front++];
+    long idx = mazegrid_index(grid, row, col);
+    simcache_access(sim, &dist[idx]);
+    int next_dist = dist[idx] + 1;
+    for(int d=DELTA_START; d<delta_end; d++){
+      long nidx = mazegrid_index(grid, row + row_delta[d], col + col_delta[d]);
+      simcache_access(sim, &grid->cells[nidx]);
+      if(grid->cells[nidx] != GRID_OPEN){
+        continue;
+      }
+      simcache_access(sim, &dist[nidx]);
+      if(dist[nidx] == -1){
+        dist[nidx] = next_dist;
+        simcache_access(sim, &queue[rear]);
+        queue[rear++] = row + row_delta[d];
+        queue[rear++] = col + col_delta[d];
+      }
+    }
+  }
+  free(queue);
+}
+
+// Fills `grid` with a pseudo-random maze: about 1 in 4 tiles is a
+// wall which leaves one large connected open region. The generator
+// is a fixed-seed LCG so every layout gets the same maze.
+void generate_maze(mazegrid_t *grid){
+  unsigned long long state = 216;
+  for(int i=0; i<grid->rows; i++){
+    for(int j=0; j<grid->cols; j++){
+      state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+      int wall = ((state >> 33) & 3) == 0;
+      grid->cells[mazegrid_index(grid,i,j)] = wall ? GRID_WALL : GRID_OPEN;
+    }
+  }
+  grid->cells[mazegrid_index(grid,0,0)] = GRID_OPEN;
+}
+
+// Runs BFS from the corner of a generated maze in each grid layout
+// and reports times, tiles reached, and cache misses. Without
+// hardware counters the search is replayed through the L2 model and
+// its misses per tile reached are reported.
+int bench_layout(int rows, int cols){
+  char *names[2] = {"rowmajor", "blocked"};
+  int layouts[2] = {GRID_LAYOUT_ROWMAJOR, GRID_LAYOUT_BLOCKED};
+  int fd = cache_counter_open();
+  printf("BFS on %d x %d maze, %.1f MB of int distances\n",
+         rows, cols, (double)rows*cols*sizeof(int)/(1<<20));
+  for(int l=0; l<2; l++){
+    mazegrid_t *grid = mazegrid_allocate(rows, cols, layouts[l]);
+    generate_maze(grid);
+    int *dist = malloc(sizeof(int) * grid->ncells);
+    cache_counter_start(fd);
+    double start = now_ms();
+    long reached = mazegrid_bfs(grid, 0, 0, dist);
+    double elapsed = now_ms() - start;
+    printf("%-9s %9.1f ms reached %10ld", names[l], elapsed, reached);
+    cache_counter_report(fd);
+    if(fd < 0 && reached > 0){
+      simcache_t *sim = simcache_allocate();
+      simcache_replay_bfs(sim, grid, 0, 0, dist);
+      printf(" model L2 misses %11ld (%.2f per tile)", sim->misses,
+             (double)sim->misses / reached);
+      simcache_free(sim);
+    }
+    printf("\n");
+    free(dist);
+    mazegrid_free(grid);
+  }
+  if(fd >= 0){
+    close(fd);
+  }
+  return 0;
+}
+
+// Fills the tiles of `maze` like generate_maze() with START and END
+// in opposite corners; `seed` varies the maze.
+void generate_tile_maze(maze_t *maze, unsigned long long seed){
+  unsigned long long state = seed;
+  for(int i=0; i<maze->rows; i++){
+    for(int j=0; j<maze->cols; j++){
+      state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+      maze->tiles[i][j].type = (((state >> 33) & 3) == 0) ? WALL : OPEN;
+    }
+  }
+  maze->start_row = maze->start_col = 0;
+  maze->end_row = maze->rows-1;
+  maze->end_col = maze->cols-1;
+  maze->tiles[0][0].type = START;
+  maze->tiles[maze->end_row][maze->end_col].type = END;
+  maze_compute_masks(maze);
+}
+
+#define SLICE_MAZES 8
+#define SLICE_USEC  200
+
+int compare_doubles(const void *a, const void *b){
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// Solves SLICE_MAZES mazes one after another with maze_bfs_iterate()
+// and then again interleaved in SLICE_USEC time slices, reporting how
+// long the thread is tied up by each call: the longest call and the
+// 99th percentile, as occasional calls are delayed by the system.
+int bench_slices(int rows, int cols){
+  maze_t *mazes[SLICE_MAZES];
+  printf("%d searches of %d x %d mazes, %d usec slices\n",
+         SLICE_MAZES, rows, cols, SLICE_USEC);
+  for(int m=0; m<SLICE_MAZES; m++){
+    mazes[m] = maze_allocate(rows, cols);
+    generate_tile_maze(mazes[m], 216 + m);
+  }
+
+  // Whole searches: each call lasts as long as a full solve
+  double longest = 0, start = now_ms();
+  for(int m=0; m<SLICE_MAZES; m++){
+    double call = now_ms();
+    maze_bfs_iterate(mazes[m]);
+    double elapsed = now_ms() - call;
+    longest = (elapsed > longest) ? elapsed : longest;
+    maze_bfs_cancel(mazes[m]);
+  }
+  printf("%-9s %9.1f ms total, %5d calls, longest call %8.3f ms\n",
+         "iterate", now_ms() - start, SLICE_MAZES, longest);
+
+  // Round-robin slices across all searches until each finishes
+  int done[SLICE_MAZES] = {0}, remaining = SLICE_MAZES, calls = 0;
+  int capacity = 1024;
+  double *latency = malloc(sizeof(double) * capacity);
+  start = now_ms();
+  for(int m=0; m<SLICE_MAZES; m++){
+    maze_bfs_init(mazes[m]);
+  }
+  while(remaining > 0){
+    for(int m=0; m<SLICE_MAZES; m++){
+      if(done[m]){
+        continue;
+      }
+      double call = now_ms();
+      done[m] = maze_bfs_advance(mazes[m], 0, SLICE_USEC);
+      if(calls == capacity){
+        capacity *= 2;
+        latency = realloc(latency, sizeof(double) * capacity);
+      }
+      latency[calls++] = now_ms() - call;
+      remaining -= done[m];
+    }
+  }
+  double total = now_ms() - start;
+  qsort(latency, calls, sizeof(double), compare_doubles);
+  printf("%-9s %9.1f ms total, %5d calls, longest call %8.3f ms, 99%% %.3f ms\n",
+         "advance", total, calls, latency[calls-1], latency[calls*99/100]);
+  free(latency);
+  for(int m=0; m<SLICE_MAZES; m++){
+    maze_free(mazes[m]);
+  }
+  return 0;
+}
+
+// Finds distances from MSBFS_BATCH sources on a generated maze with a
+// separate mazegrid_bfs() per source, then with mazegrid_msbfs_to()
+// for distances to the far corner only, which needs one BFS from the
+// corner, and mazegrid_msbfs() for the full distance matrix. The
+// matrix is timed forced bit-parallel (MSBFS_SPREAD of INT_MAX) and
+// with the default MSBFS_SPREAD, which searches separately once the
+// sources spread wider than it; the bit-parallel search shares work
+// only where the searches from different sources reach tiles at the
+// same distance, so it gains most when sources are close together.
+void bench_msbfs_sources(mazegrid_t *grid, int *src_rows, int *src_cols){
+  int count = MSBFS_BATCH;
+  int rows = grid->rows, cols = grid->cols;
+  int *dist = malloc(sizeof(int) * grid->ncells);
+  int separate[MSBFS_BATCH], to_end[MSBFS_BATCH];
+  long end_idx = mazegrid_index(grid, rows-1, cols-1);
+  int spread = mazegrid_source_spread(grid, count, src_rows, src_cols);
+  printf("spread %d, default %s:\n", spread,
+         spread > MSBFS_SPREAD_DEFAULT ? "separate" : "bit-parallel");
+  double start = now_ms();
+  long reached = 0;
+  for(int k=0; k<count; k++){
+    reached += mazegrid_bfs(grid, src_rows[k], src_cols[k], dist);
+    separate[k] = dist[end_idx];
+  }
+  printf("  %-16s %9.1f ms reached %12ld\n", "separate", now_ms() - start, reached);
+  free(dist);
+
+  start = now_ms();
+  mazegrid_msbfs_to(grid, count, src_rows, src_cols, rows-1, cols-1, to_end);
+  double elapsed = now_ms() - start;
+  int match = memcmp(separate, to_end, sizeof(to_end)) == 0;
+  printf("  %-16s %9.1f ms to corner only, %s\n", "msbfs_to", elapsed,
+         match ? "distances match" : "DISTANCES DIFFER");
+
+  int *matrix = malloc(sizeof(int) * count * grid->ncells);
+  int spreads[2] = {INT_MAX, MSBFS_SPREAD_DEFAULT};
+  char *labels[2] = {"bit-parallel", "default"};
+  for(int s=0; s<2; s++){
+    MSBFS_SPREAD = spreads[s];
+    start = now_ms();
+    reached = mazegrid_msbfs(grid, count, src_rows, src_cols, matrix);
+    printf("  %-16s %9.1f ms reached %12ld\n", labels[s], now_ms() - start, reached);
+  }
+  MSBFS_SPREAD = MSBFS_SPREAD_DEFAULT;
+  free(matrix);
+}
+
+// Places MSBFS_BATCH sources on an 8x8 lattice in the top left corner
+// with the lattice step doubling until it no longer fits the maze so
+// that the crossover spread for MSBFS_SPREAD_DEFAULT can be read off.
+int bench_msbfs(int rows, int cols){
+  int count = MSBFS_BATCH;
+  int src_rows[MSBFS_BATCH], src_cols[MSBFS_BATCH];
+  mazegrid_t *grid = mazegrid_allocate(rows, cols, GRID_LAYOUT_ROWMAJOR);
+  generate_maze(grid);
+  printf("%d sources on %d x %d maze, %.1f MB distance matrix\n",
+         count, rows, cols, (double)count*grid->ncells*sizeof(int)/(1<<20));
+  for(int step=1; 7*step < rows && 7*step < cols; step *= 2){
+    for(int k=0; k<count; k++){
+      src_rows[k] = (k / 8) * step;
+      src_cols[k] = (k % 8) * step;
+      grid->cells[mazegrid_index(grid, src_rows[k], src_cols[k])] = GRID_OPEN;
+    }
+    bench_msbfs_sources(grid, src_rows, src_cols);
+  }
+  mazegrid_free(grid);
+  return 0;
+}
+
+// Carves a winding maze with a single path between any two tiles into
+// `maze`: tiles with odd row and column are rooms joined by a
+// depth-first walk that opens the wall between a room and a random
+// unvisited neighbor, backing up when there is none.
+void generate_winding_maze(maze_t *maze, unsigned long long seed){
+  unsigned long long state = seed;
+  for(int i=0; i<maze->rows; i++){
+    for(int j=0; j<maze->cols; j++){
+      maze->tiles[i][j].type = WALL;
+    }
+  }
+  int room_rows = (maze->rows - 1) / 2, room_cols = (maze->cols - 1) / 2;
+  int *stack = malloc(sizeof(int) * (long)room_rows * room_cols);
+  int top = 0;
+  stack[top++] = 0;
+  maze->tiles[1][1].type = OPEN;
+  while(top > 0){
+    int room = stack[top-1];
+    int r = room / room_cols, c = room % room_cols;
+    int options[4], count = 0;
+    for(int d=DELTA_START; d<DELTA_COUNT; d++){
+      int nr = r + row_delta[d], nc = c + col_delta[d];
+      if(nr >= 0 && nr < room_rows && nc >= 0 && nc < room_cols &&
+         maze->tiles[2*nr+1][2*nc+1].type == WALL){
+        options[count++] = d;
+      }
+    }
+    if(count == 0){
+      top--;
+      continue;
+    }
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    int d = options[(state >> 33) % count];
+    maze->tiles[2*r+1 + row_delta[d]][2*c+1 + col_delta[d]].type = OPEN;
+    maze->tiles[2*(r + row_delta[d])+1][2*(c + col_delta[d])+1].type = OPEN;
+    stack[top++] = (r + row_delta[d]) * room_cols + c + col_delta[d];
+  }
+  free(stack);
+  maze->start_row = maze->start_col = 1;
+  maze->end_row = 2*room_rows - 1;
+  maze->end_col = 2*room_cols - 1;
+  maze->tiles[maze->start_row][maze->start_col].type = START;
+  maze->tiles[maze->end_row][maze->end_col].type = END;
+  maze_compute_masks(maze);
+}
+
+#define ALT_QUERIES 200
+
+// Solves ALT_QUERIES random queries between rooms of a winding maze
+// with A* using only the Manhattan distance and then with the bounds
+// of ALT_LANDMARKS landmarks, reporting tiles expanded and times.
+int bench_alt(int rows, int cols){
+  maze_t *maze = maze_allocate(rows, cols);
+  generate_winding_maze(maze, 216);
+  double start = now_ms();
+  mazealt_t *alt = mazealt_build(maze, ALT_LANDMARKS);
+  printf("%d queries on %d x %d winding maze, %d landmarks built in %.1f ms\n",
+         ALT_QUERIES, rows, cols, alt->header->count, now_ms() - start);
+  int room_rows = (rows - 1) / 2, room_cols = (cols - 1) / 2;
+  int queries[ALT_QUERIES][4];
+  unsigned long long state = 216;
+  for(int q=0; q<ALT_QUERIES; q++){
+    for(int k=0; k<4; k++){
+      state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+      queries[q][k] = 2 * (int)((state >> 33) % (k % 2 == 0 ? room_rows : room_cols)) + 1;
+    }
+  }
+  char *names[2] = {"manhattan", "landmarks"};
+  mazealt_t *alts[2] = {NULL, alt};
+  long lengths[2] = {0, 0};
+  for(int a=0; a<2; a++){
+    long expanded = 0;
+    start = now_ms();
+    for(int q=0; q<ALT_QUERIES; q++){
+      long len;
+      long count;
+      direction_t *path = maze_astar_path(maze, alts[a], queries[q][0], queries[q][1],
+                                          queries[q][2], queries[q][3], &len, &count);
+      free(path);
+      expanded += count;
+      lengths[a] += len;
+    }
+    printf("%-9s %9.1f ms expanded %12ld tiles, total length %ld\n",
+           names[a], now_ms() - start, expanded, lengths[a]);
+  }
+  if(lengths[0] != lengths[1]){
+    printf("PATH LENGTHS DIFFER\n");
+  }
+  mazealt_free(alt);
+  maze_free(maze);
+  return 0;
+}
+
+// Finds the diameter of three kinds of maze with mazegrid_diameter(),
+// reporting the BFS passes used and the time. Running a BFS from
+// every open tile instead would take one pass per tile.
+int bench_diameter(int rows, int cols){
+  char *names[3] = {"winding", "random", "open"};
+  printf("diameter of %d x %d mazes\n", rows, cols);
+  for(int m=0; m<3; m++){
+    maze_t *maze = maze_allocate(rows, cols);
+    if(m == 0){
+      generate_winding_maze(maze, 216);
+    }
+    else{
+      generate_tile_maze(maze, 216);
+      for(int i=0; m == 2 && i<rows; i++){
+        for(int j=0; j<cols; j++){
+          maze->tiles[i][j].type = OPEN;
+        }
+      }
+    }
+    mazegrid_t *grid = mazegrid_from_maze(maze, GRID_LAYOUT_BLOCKED);
+    long tiles = 0;
+    for(long i=0; i<grid->ncells; i++){
+      tiles += grid->cells[i] == GRID_OPEN;
+    }
+    int sweeps;
+    double start = now_ms();
+    long diameter = mazegrid_diameter(grid, maze->start_row, maze->start_col, &sweeps, NULL, NULL);
+    printf("%-9s %9.1f ms diameter %8ld with %4d BFS passes for %9ld open tiles\n",
+           names[m], now_ms() - start, diameter, sweeps, tiles);
+    mazegrid_free(grid);
+    maze_free(maze);
+  }
+  return 0;
+}
+
+// Runs BFS from START of a random and a winding maze on each grid
+// layout and on open tile graphs in each order, reporting the time to
+// build each representation and the time and cache misses of the
+// BFS.
+int bench_csr(int rows, int cols){
+  char *maze_names[2] = {"random", "winding"};
+  int fd = cache_counter_open();
+  for(int m=0; m<2; m++){
+    maze_t *maze = maze_allocate(rows, cols);
+    if(m == 0){
+      generate_tile_maze(maze, 216);
+    }
+    else{
+      generate_winding_maze(maze, 216);
+    }
+    printf("BFS on %d x %d %s maze\n", rows, cols, maze_names[m]);
+    char *grid_names[2] = {"rowmajor", "blocked"};
+    int layouts[2] = {GRID_LAYOUT_ROWMAJOR, GRID_LAYOUT_BLOCKED};
+    for(int l=0; l<2; l++){
+      double start = now_ms();
+      mazegrid_t *grid = mazegrid_from_maze(maze, layouts[l]);
+      double build = now_ms() - start;
+      int *dist = malloc(sizeof(int) * grid->ncells);
+      cache_counter_start(fd);
+      start = now_ms();
+      long reached = mazegrid_bfs(grid, maze->start_row, maze->start_col, dist);
+      double elapsed = now_ms() - start;
+      printf("  %-8s build %8.1f ms bfs %8.1f ms reached %9ld",
+             grid_names[l], build, elapsed, reached);
+      cache_counter_report(fd);
+      printf("\n");
+      free(dist);
+      mazegrid_free(grid);
+    }
+    char *csr_names[2] = {"csr-bfs", "csr-hilb"};
+    int orders[2] = {CSR_ORDER_BFS, CSR_ORDER_HILBERT};
+    for(int o=0; o<2; o++){
+      double start = now_ms();
+      mazecsr_t *csr = mazecsr_from_maze(maze, orders[o]);
+      double build = now_ms() - start;
+      int *dist = malloc(sizeof(int) * csr->node_count);
+      int source = mazecsr_node(csr, maze->start_row, maze->start_col);
+      cache_counter_start(fd);
+      start = now_ms();
+      long reached = mazecsr_bfs(csr, source, dist, NULL);
+      double elapsed = now_ms() - start;
+      printf("  %-8s build %8.1f ms bfs %8.1f ms reached %9ld",
+             csr_names[o], build, elapsed, reached);
+      cache_counter_report(fd);
+      printf("\n");
+      free(dist);
+      mazecsr_free(csr);
+    }
+    maze_free(maze);
+  }
+  if(fd >= 0){
+    close(fd);
+  }
+  return 0;
+}
+
+// Returns the number of minor page faults of this process so far, each
+// a page given memory when first touched
+long page_faults(){
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_minflt;
+}
+
+// Allocates a maze eagerly and lazily, then again followed by a pass
+// setting the type, state, and path_len of every tile as
+// maze_from_file() does, and reports times and page faults. A lazy
+// maze that is never touched costs almost nothing; once every tile
+// is set both cost the same memory but the lazy one skips a pass.
+int bench_alloc(int rows, int cols){
+  char *names[2] = {"eager", "lazy"};
+  printf("allocate %d x %d maze, %.1f MB of tiles\n",
+         rows, cols, (double)(rows + 2) * (cols + 2) * sizeof(tile_t) / (1 << 20));
+  for(int fill=0; fill<2; fill++){
+    for(int l=0; l<2; l++){
+      long faults = page_faults();
+      double start = now_ms();
+      maze_t *maze = (l == 0) ? maze_allocate(rows, cols) : maze_allocate_lazy(rows, cols);
+      for(int i=0; fill && i<rows; i++){
+        for(int j=0; j<cols; j++){
+          maze->tiles[i][j].type = (i + j) % 3 == 0 ? WALL : OPEN;
+          maze->tiles[i][j].state = NOTFOUND;
+          maze->tiles[i][j].path_len = -1;
+        }
+      }
+      double elapsed = now_ms() - start;
+      printf("%-5s %-9s %9.1f ms page faults %9ld\n",
+             names[l], fill ? "and fill" : "only", elapsed, page_faults() - faults);
+      maze_free(maze);
+    }
+  }
+  return 0;
+}
+
+#define PREFETCH_START_GAP 32
+#define PREFETCH_RUNS 6
+
+// Runs maze_bfs_nearest() with BFS_PREFETCH set to `distance` and
+// reports its time and cache misses along with the tiles reached and
+// a checksum of their path lengths, which must not depend on the
+// distance. The tile maze has a START every PREFETCH_START_GAP tiles
+// each way so paths stay short and the search is dominated by
+// reaching tiles rather than copying paths.
+void bench_prefetch_run(int rows, int cols, int distance, int fd){
+  long reached = 0, sum = 0;
+  BFS_PREFETCH = distance;
+  maze_t *maze = maze_allocate(rows, cols);
+  generate_tile_maze(maze, 216);
+  for(int i=0; i<rows; i+=PREFETCH_START_GAP){
+    for(int j=0; j<cols; j+=PREFETCH_START_GAP){
+      maze->tiles[i][j].type = START;
+    }
+  }
+  maze->tiles[rows-1][cols-1].type = OPEN;   // no END so every tile is reached
+  maze->pack_paths = 1;
+  cache_counter_start(fd);
+  double start = now_ms();
+  maze_bfs_nearest(maze);
+  double elapsed = now_ms() - start;
+  for(int i=0; i<rows; i++){
+    for(int j=0; j<cols; j++){
+      if(maze->tiles[i][j].state == FOUND){
+        reached++;
+        sum += maze->tiles[i][j].path_len;
+      }
+    }
+  }
+  maze_free(maze);
+  printf("prefetch %2d %9.1f ms %6.1f ns/tile reached %10ld sum %ld",
+         distance, elapsed, elapsed * 1e6 / reached, reached, sum);
+  cache_counter_report(fd);
+  printf("\n");
+}
+
+// Compares maze_bfs_nearest() with BFS_PREFETCH at 0 and at
+// BFS_PREFETCH_DISTANCE on a rows x cols tile maze. Each run is in a
+// fresh child process that builds its own maze, as a search run after
+// another finds the heap laid out differently by the frees of the
+// first, which skews the comparison more than prefetching changes it.
+// The two settings alternate for PREFETCH_RUNS runs.
+int bench_prefetch(int rows, int cols){
+  int fd = cache_counter_open();
+  printf("maze_bfs_nearest on %d x %d tile maze, %.1f MB of tiles\n",
+         rows, cols, (double)(rows + 2) * (cols + 2) * sizeof(tile_t) / (1 << 20));
+  for(int r=0; r<PREFETCH_RUNS; r++){
+    fflush(stdout);
+    pid_t child = fork();
+    if(child == 0){
+      bench_prefetch_run(rows, cols, (r % 2) ? BFS_PREFETCH_DISTANCE : 0, fd);
+      exit(0);
+    }
+    waitpid(child, NULL, 0);
+  }
+  if(fd >= 0){
+    close(fd);
+  }
+  return 0;
+}
+
+// Lazily allocates a rows x cols maze, walls off a side x side room in
+// its bottom right corner with START and END in opposite corners of
+// the room, then solves it with maze_bfs_iterate() and
+// maze_set_solution() before freeing the maze. Tiles outside the room
+// are never touched, so although the tile block spans hundreds of GB
+// of address space for a 100000 x 100000 maze, only the room and the
+// border tiles of each row get memory. Reports the time and page
+// faults of each phase and checks the path found.
+int bench_giant(int rows, int cols){
+  int side = 256;
+  long ntiles = (long)rows * cols;
+  printf("giant %d x %d maze, %ld tiles, %.1f GB of address space\n",
+         rows, cols, ntiles, (double)(rows + 2L) * (cols + 2L) * sizeof(tile_t) / (1L << 30));
+  if(rows < side + 2 || cols < side + 2){
+    printf("maze must be at least %d x %d\n", side + 2, side + 2);
+    return 1;
+  }
+
+  long faults = page_faults();
+  double start = now_ms();
+  maze_t *maze = maze_allocate_lazy(rows, cols);
+  if(maze == NULL){
+    printf("could not allocate maze\n");
+    return 1;
+  }
+  printf("%-9s %9.1f ms page faults %9ld\n", "allocate", now_ms() - start, page_faults() - faults);
+
+  // Wall off the room; the untouched tiles around it read as NOTSET
+  faults = page_faults();
+  start = now_ms();
+  int r0 = rows - side - 1, c0 = cols - side - 1;
+  for(int i=r0-1; i<=r0+side; i++){
+    for(int j=c0-1; j<=c0+side; j++){
+      int wall = (i < r0 || i == r0 + side || j < c0 || j == c0 + side);
+      maze->tiles[i][j].type = wall ? WALL : OPEN;
+      maze->tiles[i][j].state = NOTFOUND;
+      maze->tiles[i][j].path_len = -1;
+    }
+  }
+  maze->tiles[r0][c0].type = START;
+  maze->tiles[r0 + side - 1][c0 + side - 1].type = END;
+  maze->start_row = r0;
+  maze->start_col = c0;
+  maze->end_row = r0 + side - 1;
+  maze->end_col = c0 + side - 1;
+  maze->pack_paths = 1;
+  printf("%-9s %9.1f ms page faults %9ld\n", "room", now_ms() - start, page_faults() - faults);
+
+  faults = page_faults();
+  start = now_ms();
+  maze_bfs_iterate(maze);
+  int found = maze_set_solution(maze);
+  printf("%-9s %9.1f ms page faults %9ld\n", "solve", now_ms() - start, page_faults() - faults);
+  tile_t *end = &maze->tiles[maze->end_row][maze->end_col];
+  long end_index = (maze->end_row + 1L) * (cols + 2L) + maze->end_col + 1;
+  printf("END tile index %ld path length %ld: %s\n", end_index, end->path_len,
+         (found && end->path_len == 2L * (side - 1)) ? "ok" : "WRONG");
+
+  faults = page_faults();
+  start = now_ms();
+  maze_free(maze);
+  printf("%-9s %9.1f ms page faults %9ld\n", "free", now_ms() - start, page_faults() - faults);
+  return 0;
+}
+
+int main(int argc, char *argv[]){
+  if(argc < 2){
+    printf(USAGE, argv[0]);
+    return 1;
+  }
+  if(strcmp(argv[1], "layout") == 0){
+    int rows = (argc > 3) ? atoi(argv[2]) : 4096;
+    int cols = (argc > 3) ? atoi(argv[3]) : 16384;
+    return bench_layout(rows, cols);
+  }
+  if(strcmp(argv[1], "slices") == 0){
+    int rows = (argc > 3) ? atoi(argv[2]) : 512;
+    int cols = (argc > 3) ? atoi(argv[3]) : 512;
+    return bench_slices(rows, cols);
+  }
+  if(strcmp(argv[1], "msbfs") == 0){
+    int rows = (argc > 3) ? atoi(argv[2]) : 512;
+    int cols = (argc > 3) ? atoi(argv[3]) : 512;
+    return bench_msbfs(rows, cols);
+  }
+  if(strcmp(argv[1], "alt") == 0){
+    int rows = (argc > 3) ? atoi(argv[2]) : 511;
+    int cols = (argc > 3) ? atoi(argv[3]) : 511;
+    return bench_alt(rows, cols);
+  }
+  if(strcmp(argv[1], "diameter") == 0){
+    int rows = (argc > 3) ? atoi(argv[2]) : 1023;
+    int cols = (argc > 3) ? atoi(argv[3]) : 1023;
+    return bench_diameter(rows, cols);
+  }
+  if(strcmp(argv[1], "csr") == 0){
+    int rows = (argc > 3) ? atoi(argv[2]) : 2047;
+    int cols = (argc > 3) ? atoi(argv[3]) : 2047;
+    return bench_csr(rows, cols);
+  }
+  if(strcmp(argv[1], "alloc") == 0){
+    int rows = (argc > 3) ? atoi(argv[2]) : 4096;
+    int cols = (argc > 3) ? atoi(argv[3]) : 4096;
+    return bench_alloc(rows, cols);
+  }
+  if(strcmp(argv[1], "prefetch") == 0){
+    int rows = (argc > 3) ? atoi(argv[2]) : 4096;
+    int cols = (argc > 3) ? atoi(argv[3]) : 8192;
+    return bench_prefetch(rows, cols);
+  }
+  if(strcmp(argv[1], "giant") == 0){
+    int rows = (argc > 3) ? atoi(argv[2]) : 100000;
+    int cols = (argc > 3) ? atoi(argv[3]) : 100000;
+    return bench_giant(rows, cols);
+  }
+  printf(USAGE, argv[0]);
+  return 1;
+}
@@ -1,5 +1,7 @@
 #include "mazesolve.h"
 #include <stdlib.h>
+#include <time.h>
+#include <sys/mman.h>
 
 ////////////////////////////////////////////////////////////////////////////////
 // PROVIDED DATA
@@ -14,31 +16,44 @@
 // execution proceeds.
 int LOG_LEVEL = 0;
 
+// Number of queue entries that maze_bfs_step() looks ahead to
+// prefetch the tiles of; 0 turns prefetching off.
+int BFS_PREFETCH = BFS_PREFETCH_DISTANCE;
+
 // Pre-specified order in which neighbor tiles shoudl be checked for
-// compatibility with tests.
-direction_t dir_delta[5] = {NONE, NORTH, SOUTH, WEST, EAST};
-int row_delta[5] =         {+0,      -1,    +1,   +0,   +0};
-int col_delta[5] =         {+0,      +0,    +0,   -1,   +1};
-#define DELTA_START 1
-#define DELTA_COUNT 5
+// compatibility with tests. The diagonal directions follow the four
+// orthogonal ones so that 4-way movement only scans up to DELTA_COUNT
+// while 8-way movement continues to DELTA_COUNT_8WAY; see mazesolve.h.
+direction_t dir_delta[9] = {NONE, NORTH, SOUTH, WEST, EAST, NORTHWEST, NORTHEAST, SOUTHWEST, SOUTHEAST};
+int row_delta[9] =         {+0,      -1,    +1,   +0,   +0,        -1,        -1,        +1,        +1};
+int col_delta[9] =         {+0,      +0,    +0,   -1,   +1,        -1,        +1,        -1,        +1};
 
 
-// strings to print for compact directions
-char *direction_compact_strs[5] = {
+// strings to print for compact directions; diagonals are lower case
+// so that a compact path like "Nne" remains unambiguous
+char *direction_compact_strs[9] = {
   "?",                          // NONE
   "N",                          // NORTH
   "S",                          // SOUTH
   "W",                          // WEST
   "E",                          // EAST
+  "nw",                         // NORTHWEST
+  "ne",                         // NORTHEAST
+  "sw",                         // SOUTHWEST
+  "se",                         // SOUTHEAST
 };
   
 // strings to print for verbose directions
-char *direction_verbose_strs[5] = {
+char *direction_verbose_strs[9] = {
   "NONE",                       // NONE
   "NORTH",                      // NORTH
   "SOUTH",                      // SOUTH
   "WEST",                       // WEST
   "EAST",                       // EAST
+  "NORTHWEST",                  // NORTHWEST
+  "NORTHEAST",                  // NORTHEAST
+  "SOUTHWEST",                  // SOUTHWEST
+  "SOUTHEAST",                  // SOUTHEAST
 };
 
 #define TILETYPE_COUNT 6
@@ -77,6 +92,8 @@ rcqueue_t *rcqueue_allocate(){
     queue->front = NULL;  // No elements in the queue
     queue->rear = NULL;   // No elements in the queue
     queue->count = 0;     // Queue size is 0
+    queue->ahead = NULL;  // No node is tracked ahead of the front
+    queue->lead = 0;
 
     return queue;
 }
@@ -113,6 +130,10 @@ else{
 }
 
 queue->count++;
+// The new node is the one tracked ahead once there are lead nodes before it
+if (queue->lead > 0 && queue->count == queue->lead + 1) {
+    queue->ahead = new_node;
+}
 
 }
 
@@ -173,9 +194,31 @@ int rcqueue_remove_front(rcqueue_t *queue)
 
   free(temp);
   queue->count--;
+  // Every node moves one place forward so the one behind ahead takes its place
+  if (queue->ahead != NULL) {
+    queue->ahead = queue->ahead->next;
+  }
 
   return 1;
 }
+
+void rcqueue_set_lead(rcqueue_t *queue, int lead)
+// Starts tracking in queue->ahead the node `lead` places behind the
+// front, or NULL if there are no more than lead nodes. Walks to that
+// node once; after that rcqueue_add_rear() and rcqueue_remove_front()
+// keep it up to date in O(1). A lead of 0 stops tracking.
+{
+    queue->lead = (lead > 0) ? lead : 0;
+    queue->ahead = NULL;
+    if (queue->lead > 0) {
+        rcnode_t *node = queue->front;
+        for (int k = 0; k < queue->lead && node != NULL; k++) {
+            node = node->next;
+        }
+        queue->ahead = node;
+    }
+}
+
 void rcqueue_print(rcqueue_t *queue) 
 // PROBLEM 1: Prints a table of the current queue contents to standard
 // out using printf(). The output should look like the following.
@@ -204,7 +247,7 @@ void rcqueue_print(rcqueue_t *queue)
     printf("null queue\n");
     return;
   }
-  printf("queue count: %d\n", queue->count);
+  printf("queue count: %ld\n", queue->count);
   printf("NN ROW COL\n");
 
   rcnode_t *current = queue->front;
@@ -222,6 +265,31 @@ void rcqueue_print(rcqueue_t *queue)
 // FUNCTIONS FOR PROBLEM 2: Tile and Maze Utility Functions
 ////////////////////////////////////////////////////////////////////////////////
 
+int tile_has_path(tile_t *tile)
+// Returns 1 if `tile` has a path in either its expanded path field or
+// its 2-bit packed field and 0 otherwise.
+{
+  return tile->path != NULL || tile->packed != NULL;
+}
+
+direction_t tile_path_dir(tile_t *tile, long i)
+// Returns element `i` of the path of `tile` whether it is stored
+// expanded in the path field or 2-bit packed in the packed field.
+// The tile must have a path and i must be below its path_len.
+{
+  if (tile->packed != NULL) {
+    return PACKED_GET(tile->packed, i);
+  }
+  return tile->path[i];
+}
+
+// Stores `dir` as element `i` of a packed path array, clearing the
+// 2 bits previously held there.
+static void packed_set(unsigned char *packed, long i, direction_t dir){
+  int shift = (i & 3) * 2;
+  packed[i >> 2] = (packed[i >> 2] & ~(3 << shift)) | ((dir - NORTH) << shift);
+}
+
 void tile_print_path(tile_t *tile, int format) 
 // PROBLEM 2: Print the path field of `tile` in one of two formats. If
 // the path field is NULL, print "No path found\n". Otherwise, if the
@@ -231,8 +299,11 @@ void tile_print_path(tile_t *tile, int format)
 // the `format` parameter is PATH_FORMAT_VERBOSE, print the length of
 // the path on its own line then each element of the path with its
 // index on its on line using strings from the global
-// direction_verbose_strs[] global array. If the format is neither of
-// COMPACT or VERBOSE, print an error message (not tested).
+// direction_verbose_strs[] global array. If the `format` is
+// PATH_FORMAT_RLE, print each run of identical directions as its
+// compact string followed by the run length, again without newlines,
+// so that NNNEEES prints as N3E3S1. If the format is none of COMPACT,
+// VERBOSE, or RLE, print an error message (not tested).
 //
 // CONSTRAINT: This function must use the correspondence of
 // enumeration values like NORTH to integers to access elements from
@@ -269,22 +340,34 @@ void tile_print_path(tile_t *tile, int format)
 // is an elegant technique that proficient codes seek to use as often
 // as possible.
  {
-  if (tile->path == NULL) {
+  if (!tile_has_path(tile)) {
     printf("No path found\n");
     return;
   }// if the tile has no path(NULL), print "No path found"
   if (format == PATH_FORMAT_COMPACT) {
-    for (int i = 0; i < tile->path_len; i++) {
-      printf("%s", direction_compact_strs[tile->path[i]]);
+    for (long i = 0; i < tile->path_len; i++) {
+      printf("%s", direction_compact_strs[tile_path_dir(tile, i)]);
     }
   }// For compact format (NEES example), print without spaces.
   else if (format == PATH_FORMAT_VERBOSE) {
-    printf("path length: %d\n", tile->path_len);
-    for (int i = 0; i < tile->path_len; i++) {
-      // %2d prints the index in a field of width 2 so that single-digit numbers get a leading space.
-      printf("%2d: %s\n", i, direction_verbose_strs[tile->path[i]]);
+    printf("path length: %ld\n", tile->path_len);
+    for (long i = 0; i < tile->path_len; i++) {
+      // %2ld prints the index in a field of width 2 so that single-digit numbers get a leading space.
+      printf("%2ld: %s\n", i, direction_verbose_strs[tile_path_dir(tile, i)]);
     }
   }// For verbose format, print the path length and each direction clearly.
+  else if (format == PATH_FORMAT_RLE) {
+    long i = 0;
+    while (i < tile->path_len) {
+      direction_t dir = tile_path_dir(tile, i);
+      long run_end = i + 1;
+      while (run_end < tile->path_len && tile_path_dir(tile, run_end) == dir) {
+        run_end++;
+      }
+      printf("%s%ld", direction_compact_strs[dir], run_end - i);
+      i = run_end;
+    }
+  }// For RLE format, print each run of the same direction with its length.
   else {
     printf("Error: Invalid format\n");
   }
@@ -307,7 +390,28 @@ void tile_extend_path(tile_t *src, tile_t *dst, direction_t dir)
 //
 // NOTES: This function will need to access fields of the
 // tiles. Review syntax to do so.
+//
+// If `src` has a 2-bit packed path, `dst` gets a packed path instead
+// of an expanded one: the bytes of the src path are copied and `dir`
+// is set in the next 2-bit slot. Only NORTH/SOUTH/WEST/EAST can be
+// appended to a packed path.
  {
+    // Packed source: copy its bytes then append dir with bit operations
+    if (src->packed != NULL) {
+        long len = src->path_len + 1;
+        dst->packed = (unsigned char *)malloc(PACKED_BYTES(len));
+        if (dst->packed == NULL) {
+            printf("Error: Memory allocation failed in tile_extend_path.\n");
+            dst->path_len = -1;
+            return;
+        }
+        dst->packed[PACKED_BYTES(len) - 1] = 0;
+        memcpy(dst->packed, src->packed, PACKED_BYTES(src->path_len));
+        packed_set(dst->packed, src->path_len, dir);
+        dst->path_len = len;
+        return;
+    }
+
     // Check if source path is NULL (i.e., first path assignment)
     if (src->path == NULL || src->path_len <= 0) {
         dst->path_len = 1;
@@ -335,7 +439,7 @@ void tile_extend_path(tile_t *src, tile_t *dst, direction_t dir)
         }
 
         // Copy source path to destination
-        for (int i = 0; i < src->path_len; i++) {
+        for (long i = 0; i < src->path_len; i++) {
             dst->path[i] = src->path[i];
         }
 
@@ -345,6 +449,130 @@ void tile_extend_path(tile_t *src, tile_t *dst, direction_t dir)
 }
 
 
+rlepath_t *rlepath_from_tile(tile_t *tile)
+// Run-length encodes the path of `tile` into a heap-allocated
+// rlepath_t with one dirrun_t per maximal run of identical
+// directions. Long straight corridors then cost one 8-byte run rather
+// than 4 bytes per move. Returns NULL if the tile has no path; a
+// length 0 path gives 0 runs.
+//
+// EXAMPLE:
+// tile_t tile = {.path_len = 6,  .path = {NORTH, NORTH, EAST, EAST, EAST, SOUTH} };
+// rlepath_t *rle = rlepath_from_tile(&tile);
+// rle is now {.path_len = 6, .run_count = 3, .runs = {{NORTH,2}, {EAST,3}, {SOUTH,1}} }
+{
+    if (tile == NULL || !tile_has_path(tile)) {
+        return NULL;
+    }
+    // Count the runs first so the runs array is allocated exactly
+    long run_count = 0;
+    for (long i = 0; i < tile->path_len; i++) {
+        if (i == 0 || tile_path_dir(tile, i) != tile_path_dir(tile, i - 1)) {
+            run_count++;
+        }
+    }
+    rlepath_t *rle = malloc(sizeof(rlepath_t));
+    rle->runs = malloc(sizeof(dirrun_t) * (run_count > 0 ? run_count : 1));
+    rle->run_count = run_count;
+    rle->path_len = tile->path_len;
+
+    // Fill in runs, starting a new one whenever the direction changes
+    long r = -1;
+    for (long i = 0; i < tile->path_len; i++) {
+        direction_t dir = tile_path_dir(tile, i);
+        if (i == 0 || dir != rle->runs[r].dir) {
+            r++;
+            rle->runs[r].dir = dir;
+            rle->runs[r].count = 0;
+        }
+        rle->runs[r].count++;
+    }
+    return rle;
+}
+
+rlepath_t *rlepath_parse(char *str)
+// Parses text in the format printed by rlepath_print() or
+// PATH_FORMAT_RLE such as "N12E3se2" back into a heap-allocated
+// rlepath_t. Each run is a compact direction string from
+// direction_compact_strs[] followed by a positive decimal count.
+// Returns NULL if the string is malformed.
+{
+    if (str == NULL) {
+        return NULL;
+    }
+    // Every run needs at least 2 characters so this bounds the runs
+    long len = strlen(str);
+    rlepath_t *rle = malloc(sizeof(rlepath_t));
+    rle->runs = malloc(sizeof(dirrun_t) * (len / 2 + 1));
+    rle->run_count = 0;
+    rle->path_len = 0;
+
+    char *pos = str;
+    while (*pos != '\0' && *pos != '\n') {
+        // Match the longest compact direction string at this position
+        direction_t dir = NONE;
+        int dir_len = 0;
+        for (int d = DELTA_START; d < DELTA_COUNT_8WAY; d++) {
+            int n = strlen(direction_compact_strs[d]);
+            if (n > dir_len && strncmp(pos, direction_compact_strs[d], n) == 0) {
+                dir = d;
+                dir_len = n;
+            }
+        }
+        char *count_end;
+        long count = (dir == NONE) ? 0 : strtol(pos + dir_len, &count_end, 10);
+        if (count <= 0 || count > INT_MAX) {
+            rlepath_free(rle);
+            return NULL;
+        }
+        rle->runs[rle->run_count].dir = dir;
+        rle->runs[rle->run_count].count = count;
+        rle->run_count++;
+        rle->path_len += count;
+        pos = count_end;
+    }
+    return rle;
+}
+
+direction_t *rlepath_expand(rlepath_t *rle)
+// Converts `rle` back to the expanded form used in tile_t: returns a
+// heap-allocated direction_t array of length rle->path_len with each
+// run's direction repeated count times. The array has at least 1
+// element so a length 0 path is still non-NULL like the Start tile's.
+{
+    direction_t *path = malloc(sizeof(direction_t) * (rle->path_len > 0 ? rle->path_len : 1));
+    long pos = 0;
+    for (long r = 0; r < rle->run_count; r++) {
+        for (int k = 0; k < rle->runs[r].count; k++) {
+            path[pos++] = rle->runs[r].dir;
+        }
+    }
+    return path;
+}
+
+void rlepath_print(rlepath_t *rle)
+// Prints `rle` in the same format as PATH_FORMAT_RLE, e.g. N12E3S40,
+// without a trailing newline. Prints "No path found\n" if rle is NULL.
+{
+    if (rle == NULL) {
+        printf("No path found\n");
+        return;
+    }
+    for (long r = 0; r < rle->run_count; r++) {
+        printf("%s%d", direction_compact_strs[rle->runs[r].dir], rle->runs[r].count);
+    }
+}
+
+void rlepath_free(rlepath_t *rle)
+// De-allocates `rle` and its runs array. Does nothing if rle is NULL.
+{
+    if (rle == NULL) {
+        return;
+    }
+    free(rle->runs);
+    free(rle);
+}
+
 maze_t *maze_allocate(int rows, int cols) 
 // PROBLEM 2: Allocate on the heap a maze with the given rows/cols.
 // Allocates space for the maze struct itself and an array of row
@@ -365,6 +593,13 @@ maze_t *maze_allocate(int rows, int cols)
 // the maze and all fields of every tile.  Valgrind errors that data
 // is uninitialized are usually resolved by adding code to explicitly
 // initialize everything.
+//
+// The tiles are surrounded by a hidden one-tile border of WALL tiles:
+// rows+2 row pointers and cols+2 tiles per row are allocated and the
+// tiles pointer and each row pointer are advanced by one so that
+// tiles[0][0] is the first visible tile while tiles[-1][-1] and
+// tiles[rows][cols] are border walls. The bordered field is set to
+// mark this for maze_free() and the BFS.
  {
     // Allocate memory for the maze structure
     maze_t *maze = (maze_t *)malloc(sizeof(maze_t));
@@ -379,62 +614,195 @@ maze_t *maze_allocate(int rows, int cols)
     maze->start_col = -1;
     maze->end_row = -1;
     maze->end_col = -1;
+    maze->start_count = 0;
+    maze->end_count = 0;
     maze->queue = NULL;
-
-    // Allocate memory for row pointers
-    maze->tiles = (tile_t **)malloc(rows * sizeof(tile_t *));
-    if (maze->tiles == NULL) {
+    maze->movement = MOVEMENT_4WAY;
+    maze->pack_paths = 0;
+    maze->bordered = 1;
+    maze->masks_ready = 0;
+    maze->path_top = rows;
+    maze->path_bottom = -1;
+    maze->path_left = cols;
+    maze->path_right = -1;
+    maze->alloc = MAZE_ALLOC_ROWS;
+
+    // Allocate memory for row pointers including the border rows
+    tile_t **row_ptrs = (tile_t **)malloc(((size_t)rows + 2) * sizeof(tile_t *));
+    if (row_ptrs == NULL) {
         free(maze);
         return NULL;
     }
+    maze->tiles = row_ptrs + 1;
 
-    // Allocate memory for each row
-    for (int i = 0; i < rows; i++) {
-        maze->tiles[i] = (tile_t *)malloc(cols * sizeof(tile_t));
-        if (maze->tiles[i] == NULL) {
+    // Allocate memory for each row including the border columns
+    for (int i = -1; i <= rows; i++) {
+        tile_t *row = (tile_t *)malloc(((size_t)cols + 2) * sizeof(tile_t));
+        if (row == NULL) {
             // Free previously allocated rows
-            for (int k = 0; k < i; k++) {
-                free(maze->tiles[k]);
+            for (int k = -1; k < i; k++) {
+                free(maze->tiles[k] - 1);
             }
-            free(maze->tiles);
+            free(row_ptrs);
             free(maze);
             return NULL;
         }
+        maze->tiles[i] = row + 1;
 
-        // Initialize tile fields
-        for (int j = 0; j < cols; j++) {
-            maze->tiles[i][j].type = NOTSET;
+        // Initialize tile fields; border tiles are walls
+        for (int j = -1; j <= cols; j++) {
+            int border = (i < 0 || i == rows || j < 0 || j == cols);
+            maze->tiles[i][j].type = border ? WALL : NOTSET;
             maze->tiles[i][j].state = NOTFOUND;
             maze->tiles[i][j].path = NULL;
+            maze->tiles[i][j].packed = NULL;
             maze->tiles[i][j].path_len = -1;
+            maze->tiles[i][j].open_mask = 0;
         }
     }
 
     return maze;
 }
 
+maze_t *maze_allocate_lazy(int rows, int cols)
+// Allocates a bordered maze like maze_allocate() but without a pass
+// over the tiles: all rows share one zero-filled block so the zero
+// bit pattern is the default tile, of type NOTSET and state UNKNOWN
+// with NULL paths and path_len 0. Searches only test for FOUND so they
+// treat UNKNOWN as NOTFOUND. Only the border tiles are set, to WALL.
+// Blocks of at least MAZE_MMAP_BYTES come from an anonymous mmap() so
+// the pages of tiles that are never touched are never given memory;
+// smaller blocks come from calloc(). The mmap() uses MAP_NORESERVE so
+// that a giant maze of which only a small part is used is not refused
+// for exceeding the memory that could be committed. Returns NULL if
+// the memory cannot be allocated.
+//
+// NOTES: maze_from_file() uses this as it sets the fields of every
+// tile that are not zero while parsing, along with the open_mask of
+// each row once the row below it is read, leaving that as the only
+// pass over the tiles.
+{
+    maze_t *maze = malloc(sizeof(maze_t));
+    if (maze == NULL) {
+        return NULL;
+    }
+    maze->rows = rows;
+    maze->cols = cols;
+    maze->start_row = maze->start_col = -1;
+    maze->end_row = maze->end_col = -1;
+    maze->start_count = maze->end_count = 0;
+    maze->queue = NULL;
+    maze->movement = MOVEMENT_4WAY;
+    maze->pack_paths = 0;
+    maze->bordered = 1;
+    maze->masks_ready = 0;
+    maze->path_top = rows;
+    maze->path_bottom = -1;
+    maze->path_left = cols;
+    maze->path_right = -1;
+
+    // One block holds all rows including the border
+    long width = (long)cols + 2;
+    size_t bytes = sizeof(tile_t) * ((size_t)rows + 2) * width;
+    tile_t *block;
+    if (bytes >= MAZE_MMAP_BYTES) {
+        maze->alloc = MAZE_ALLOC_MMAP;
+        block = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        block = (block == MAP_FAILED) ? NULL : block;
+    } else {
+        maze->alloc = MAZE_ALLOC_CALLOC;
+        block = calloc(((size_t)rows + 2) * width, sizeof(tile_t));
+    }
+    tile_t **row_ptrs = malloc(((size_t)rows + 2) * sizeof(tile_t *));
+    if (block == NULL || row_ptrs == NULL) {
+        if (block != NULL && maze->alloc == MAZE_ALLOC_MMAP) {
+            munmap(block, bytes);
+        } else {
+            free(block);
+        }
+        free(row_ptrs);
+        free(maze);
+        return NULL;
+    }
+    maze->tiles = row_ptrs + 1;
+    for (int i = -1; i <= rows; i++) {
+        maze->tiles[i] = block + (i + 1) * width + 1;
+        maze->tiles[i][-1].type = WALL;
+        maze->tiles[i][cols].type = WALL;
+    }
+    for (int j = 0; j < cols; j++) {
+        maze->tiles[-1][j].type = WALL;
+        maze->tiles[rows][j].type = WALL;
+    }
+    return maze;
+}
+
+void maze_note_path(maze_t *maze, int row, int col)
+// Widens the box of tiles that may have paths to include the tile at
+// row/col. Every function that gives a tile of a maze a path calls
+// this so that maze_free() can limit its search for paths of an
+// mmap()'d maze to the box rather than every tile.
+{
+    if (row < maze->path_top) {
+        maze->path_top = row;
+    }
+    if (row > maze->path_bottom) {
+        maze->path_bottom = row;
+    }
+    if (col < maze->path_left) {
+        maze->path_left = col;
+    }
+    if (col > maze->path_right) {
+        maze->path_right = col;
+    }
+}
+
 void maze_free(maze_t *maze) 
 // PROBLEM 2: De-allocates the memory associated with a maze and its
 // tiles.  Uses a doubly nested loop to iterate over all tiles and
 // de-allocate any non-NULL paths that are part of the tiles.
 // Iterates to free each row of the tiles row and frees then frees the
 // array of row tile row pointers. If the queue is non-null, frees it
-// and finally frees the maze struct itself.
+// and finally frees the maze struct itself. For a bordered maze the
+// border rows are freed too and each pointer is moved back by one to
+// the start of its allocation. An mmap()'d maze only has the tiles in
+// the box noted by maze_note_path() visited so freeing a giant maze
+// that was mostly unused does not read pages it never touched.
 {
   if (maze == NULL) {
         return;
     }
-    // Free tile paths and rows
-    for (int i = 0; i < maze->rows; i++) {
-        for (int j = 0; j < maze->cols; j++) {
+    // Free tile paths; border tiles are walls so never have paths
+    int top = 0, bottom = maze->rows - 1, left = 0, right = maze->cols - 1;
+    if (maze->alloc == MAZE_ALLOC_MMAP) {
+        top = maze->path_top;
+        bottom = maze->path_bottom;
+        left = maze->path_left;
+        right = maze->path_right;
+    }
+    for (int i = top; i <= bottom; i++) {
+        for (int j = left; j <= right; j++) {
             if (maze->tiles[i][j].path != NULL) {
                 free(maze->tiles[i][j].path);
             }
+            if (maze->tiles[i][j].packed != NULL) {
+                free(maze->tiles[i][j].packed);
+            }
+        }
+    }
+    // Free each row then the array of row pointers; lazily allocated
+    // mazes have one block of rows starting at the top left border tile
+    int b = maze->bordered ? 1 : 0;
+    if (maze->alloc == MAZE_ALLOC_MMAP) {
+        munmap(maze->tiles[-1] - 1, sizeof(tile_t) * (maze->rows + 2) * ((long)maze->cols + 2));
+    } else if (maze->alloc == MAZE_ALLOC_CALLOC) {
+        free(maze->tiles[-1] - 1);
+    } else {
+        for (int i = -b; i < maze->rows + b; i++) {
+            free(maze->tiles[i] - b);
         }
-        free(maze->tiles[i]); // Free each row
     }
-    // Free the array of row pointers
-    free(maze->tiles);
+    free(maze->tiles - b);
     // Free the queue if it exists
     if (maze->queue != NULL) {
         rcqueue_free(maze->queue);
@@ -458,6 +826,10 @@ int maze_tile_blocked(maze_t *maze, int row, int col)
 // tiles table. The tiletype_t enumeration in mazesolve.h establishes
 // global symbols for tile types like OPEN, ONPATH, START, and so
 // forth. Use one of these in this function.
+//
+// NOTE: Bounds are checked even for bordered mazes as callers may
+// pass any coordinates; the BFS skips this function for bordered
+// mazes as the neighbors it probes are always in the border or maze.
 {
   if (maze == NULL) {
         return 1;
@@ -474,6 +846,146 @@ int maze_tile_blocked(maze_t *maze, int row, int col)
     return 0;
 }
 
+void maze_compute_row_masks(maze_t *maze, int row)
+// Sets the open_mask field of every tile in `row` as described for
+// maze_compute_masks(); the types of rows row-1 to row+1 must already
+// be set. Loaders call this for each row as soon as the row below it
+// is read so masks are found in the same pass over the tiles as their
+// types. The neighbors of tiles in a bordered maze are always tiles so
+// their types are tested directly rather than via maze_tile_blocked().
+// Does not set masks_ready.
+{
+    for (int j = 0; j < maze->cols; j++) {
+        unsigned char mask = 0;
+        for (int d = DELTA_START; d < DELTA_COUNT_8WAY; d++) {
+            int r = row + row_delta[d], c = j + col_delta[d];
+            int blocked = maze->bordered ? maze->tiles[r][c].type == WALL : maze_tile_blocked(maze, r, c);
+            if (!blocked) {
+                mask |= 1 << (d - DELTA_START);
+            }
+        }
+        maze->tiles[row][j].open_mask = mask;
+    }
+}
+
+void maze_compute_masks(maze_t *maze)
+// Precomputes the open_mask field of every tile: bit d-1 is set when
+// the neighbor in direction d (NORTH through SOUTHEAST) is not
+// blocked per maze_tile_blocked(). BFS steps can then visit only the
+// set bits instead of probing every neighbor so that a corridor tile
+// costs 2 probes and a dead end 1. Sets masks_ready so the BFS uses
+// the masks; any later change of tile types between WALL and
+// non-WALL must be followed by another call to this function.
+{
+    for (int i = 0; i < maze->rows; i++) {
+        maze_compute_row_masks(maze, i);
+    }
+    maze->masks_ready = 1;
+}
+
+long maze_fill_dead_ends(maze_t *maze, int **filledp)
+// Shrinks the search space of `maze` by filling dead ends: an open
+// tile other than START or END with at most one open neighbor cannot
+// be on a shortest path between other tiles so it is changed to a
+// WALL. Filling a tile may turn its neighbor into a dead end, so whole
+// dead-end corridors are filled back to the junction they branch
+// from. Neighbors follow the maze movement. Returns the number of
+// tiles filled. If filledp is not NULL, *filledp is set to a
+// malloc()'d array of the row/col pairs of the filled tiles so that
+// maze_restore_dead_ends() can reopen them before the maze is printed.
+//
+// NOTES: Rather than rescanning the maze until nothing changes, the
+// count of open neighbors of each tile is computed once and dead ends
+// are kept on a worklist. Filling a tile decrements the count of its
+// open neighbors and any that drop to one are added to the worklist,
+// so each tile is added at most once. The masks are recomputed
+// afterwards if they were in use.
+{
+    int delta_end = (maze->movement == MOVEMENT_8WAY) ? DELTA_COUNT_8WAY : DELTA_COUNT;
+    long ntiles = (long)maze->rows * maze->cols;
+    unsigned char *open_count = malloc(ntiles > 0 ? ntiles : 1);
+    int *work = malloc(sizeof(int) * 2 * (ntiles > 0 ? ntiles : 1));
+    long nwork = 0;
+
+    // Count the open neighbors of every tile and start the worklist
+    // with the tiles that are already dead ends
+    for (int i = 0; i < maze->rows; i++) {
+        for (int j = 0; j < maze->cols; j++) {
+            int count = 0;
+            for (int d = DELTA_START; d < delta_end; d++) {
+                count += !maze_tile_blocked(maze, i + row_delta[d], j + col_delta[d]);
+            }
+            open_count[(long)i * maze->cols + j] = count;
+            tiletype_t type = maze->tiles[i][j].type;
+            if (count <= 1 && type != WALL && type != START && type != END) {
+                work[2 * nwork] = i;
+                work[2 * nwork + 1] = j;
+                nwork++;
+            }
+        }
+    }
+
+    // Fill dead ends, adding neighbors that become dead ends
+    long filled = 0, filled_capacity = 0;
+    int *filled_tiles = NULL;
+    while (nwork > 0) {
+        nwork--;
+        int row = work[2 * nwork];
+        int col = work[2 * nwork + 1];
+        maze->tiles[row][col].type = WALL;
+        if (filledp != NULL) {
+            if (filled == filled_capacity) {
+                filled_capacity = (filled_capacity == 0) ? 64 : 2 * filled_capacity;
+                filled_tiles = realloc(filled_tiles, sizeof(int) * 2 * filled_capacity);
+            }
+            filled_tiles[2 * filled] = row;
+            filled_tiles[2 * filled + 1] = col;
+        }
+        filled++;
+        for (int d = DELTA_START; d < delta_end; d++) {
+            int nrow = row + row_delta[d];
+            int ncol = col + col_delta[d];
+            if (maze_tile_blocked(maze, nrow, ncol)) {
+                continue;
+            }
+            tiletype_t type = maze->tiles[nrow][ncol].type;
+            long idx = (long)nrow * maze->cols + ncol;
+            open_count[idx]--;
+            if (open_count[idx] == 1 && type != START && type != END) {
+                work[2 * nwork] = nrow;
+                work[2 * nwork + 1] = ncol;
+                nwork++;
+            }
+        }
+    }
+    free(work);
+    free(open_count);
+    if (filledp != NULL) {
+        *filledp = filled_tiles;
+    }
+
+    if (LOG_LEVEL >= LOG_BFS_STEPS) {
+        printf("LOG: filled %ld dead-end tiles\n", filled);
+    }
+    if (maze->masks_ready) {
+        maze_compute_masks(maze);
+    }
+    return filled;
+}
+
+void maze_restore_dead_ends(maze_t *maze, int *filled, long count)
+// Reopens the `count` tiles at the row/col pairs in `filled` that
+// maze_fill_dead_ends() changed to WALL so that printing `maze` shows
+// it as it was read. Filled tiles are never on a shortest path so a
+// solution found on the filled maze stays valid.
+{
+    for (long k = 0; k < count; k++) {
+        maze->tiles[filled[2 * k]][filled[2 * k + 1]].type = OPEN;
+    }
+    if (maze->masks_ready) {
+        maze_compute_masks(maze);
+    }
+}
 
 void maze_print_tiles(maze_t *maze)
 // PROBLEM 2: Prints `maze` showing the solution path from Start to
@@ -624,7 +1136,7 @@ void maze_print_state(maze_t *maze)
                 if (tile->path_len % 10 == 0 && (tile->path_len / 10) < (int)strlen(digit10_chars))
                     printf("%c", digit10_chars[tile->path_len / 10]);
                 else
-                    printf("%d", tile->path_len % 10);
+                    printf("%ld", tile->path_len % 10);
             } else {
                 printf("%c", tiletype_chars[tile->type]);
             }
@@ -656,6 +1168,33 @@ void maze_print_state(maze_t *maze)
 // FUNCTIONS FOR PROBLEM 3: Breadth First Search of the Maze
 ////////////////////////////////////////////////////////////////////////////////
 
+// Makes the tile at row/col a search origin: gives it a length 0
+// path, marks it FOUND, and adds it to the maze queue. The path is
+// packed if the maze packs paths and uses 4-way movement so that all
+// paths extended from it are packed too. Returns 0 if memory for the
+// path could not be allocated.
+static int maze_bfs_seed(maze_t *maze, int row, int col){
+    tile_t *start_tile = &maze->tiles[row][col];
+    free(start_tile->path);     // Free old memory if allocated
+    free(start_tile->packed);
+    start_tile->path = NULL;
+    start_tile->packed = NULL;
+    if (maze->pack_paths && maze->movement == MOVEMENT_4WAY) {
+        start_tile->packed = (unsigned char *)malloc(1);
+    } else {
+        start_tile->path = (direction_t *)malloc(sizeof(direction_t) * 1);
+    }
+    if (!tile_has_path(start_tile)) {
+        printf("Memory allocation failed in maze_bfs_init\n");
+        return 0;
+    }
+    start_tile->path_len = 0;
+    start_tile->state = FOUND;
+    maze_note_path(maze, row, col);
+    rcqueue_add_rear(maze->queue, row, col);
+    return 1;
+}
+
 void maze_bfs_init(maze_t *maze) 
 // PROBLEM 3: Initializes the maze for a BFS search. Adjusts the start
 // tile: allocates it a length 0 path, sets its path_len to 0, and
@@ -714,20 +1253,10 @@ void maze_bfs_init(maze_t *maze)
         rcqueue_free(maze->queue);
     }
     maze->queue = rcqueue_allocate();
-    //  Ensure the start tile's path is handled correctly
-    tile_t *start_tile = &maze->tiles[maze->start_row][maze->start_col];
-    if (start_tile->path != NULL) {
-        free(start_tile->path); // Free old memory if allocated
-    }
-    start_tile->path = (direction_t *)malloc(sizeof(direction_t) * 1);
-    if (start_tile->path == NULL) {
-        printf("Memory allocation failed in maze_bfs_init\n");
+    // Give the start tile a length 0 path and add it to the queue
+    if (!maze_bfs_seed(maze, maze->start_row, maze->start_col)) {
         return;
     }
-    start_tile->path_len = 0;
-    start_tile->state = FOUND;
-    // Add start tile to the queue
-    rcqueue_add_rear(maze->queue, maze->start_row, maze->start_col);
     // if (LOG_LEVEL >= LOG_BFS_STATES) {
     //     printf("LOG: BFS initialization complete\n");
     //     maze_print_state(maze);
@@ -738,6 +1267,8 @@ void maze_bfs_init(maze_t *maze)
     }
 }
 
+static int maze_bfs_visit(maze_t *maze, int cur_row, int cur_col, direction_t dir);
+
 int maze_bfs_process_neighbor(maze_t *maze, int cur_row, int cur_col, direction_t dir) 
 // PROBLEM 3: Process the neighbor in direction `dir` from coordinates
 // `cur_row/cur_col`. Calculates the adjacent tiles row/col
@@ -753,6 +1284,10 @@ int maze_bfs_process_neighbor(maze_t *maze, int cur_row, int cur_col, direction_
 // is used in BFS to propogate paths to all non-blocked neighbor
 // tiles and extend the search forntier.
 //
+// For a bordered maze the neighbor of an in-bounds tile is always a
+// real tile, maybe a border wall, so the blocked check is just a type
+// check on the tile without the bounds tests of maze_tile_blocked().
+//
 // LOGGING:
 // 1. If LOG_LEVEL >= LOG_BFS_PATHS and the neighor tile's state
 //    changes from NOTFOUND to FOUND, print a message like: 
@@ -811,13 +1346,28 @@ int maze_bfs_process_neighbor(maze_t *maze, int cur_row, int cur_col, direction_
     // Compute the neighbor tile coordinates
   int new_row = cur_row + row_delta[dir];
   int new_col = cur_col + col_delta[dir];
-    // Check if the tile is blocked
-  if (maze_tile_blocked(maze, new_row, new_col)) {
+    // Check if the tile is blocked; border walls make bounds checks
+    // unnecessary in bordered mazes
+  int blocked = maze->bordered
+    ? maze->tiles[new_row][new_col].type == WALL
+    : maze_tile_blocked(maze, new_row, new_col);
+  if (blocked) {
     if (LOG_LEVEL >= LOG_SKIPPED_TILES) {
       printf("LOG: Skipping BLOCKED tile at (%d,%d)\n", new_row, new_col);
     }
     return 0;
   }
+  return maze_bfs_visit(maze, cur_row, cur_col, dir);
+}
+
+static int maze_bfs_visit(maze_t *maze, int cur_row, int cur_col, direction_t dir)
+// Second half of maze_bfs_process_neighbor() for a neighbor known not
+// to be blocked: skips it if already FOUND, otherwise extends the
+// path to it, marks it FOUND, and queues it. Called directly when
+// open_mask bits show the neighbor is open.
+{
+  int new_row = cur_row + row_delta[dir];
+  int new_col = cur_col + col_delta[dir];
     // If the tile is already FOUND, skip it
   if (maze->tiles[new_row][new_col].state == FOUND) {
     if (LOG_LEVEL >= LOG_SKIPPED_TILES) {
@@ -826,39 +1376,82 @@ int maze_bfs_process_neighbor(maze_t *maze, int cur_row, int cur_col, direction_
     return 0;
   }
 
-  // Allocate path for the new tile
-  int new_path_len = maze->tiles[cur_row][cur_col].path_len + 1;
-  maze->tiles[new_row][new_col].path = (direction_t *)malloc(sizeof(direction_t) * new_path_len);
-  
-  if (maze->tiles[new_row][new_col].path == NULL) {
-    printf("Memory allocation failed\n");
+  // Extend the current tile's path to the new tile, packed or not
+  tile_t *new_tile = &maze->tiles[new_row][new_col];
+  tile_extend_path(&maze->tiles[cur_row][cur_col], new_tile, dir);
+  if (!tile_has_path(new_tile)) {
     return 0;
   }
-  // Copy path from current tile to new tile
-  for (int i = 0; i < maze->tiles[cur_row][cur_col].path_len; i++) {
-    maze->tiles[new_row][new_col].path[i] = maze->tiles[cur_row][cur_col].path[i];
-  }
-  
-  // Append the new direction to path
-  maze->tiles[new_row][new_col].path[new_path_len - 1] = dir;
-  maze->tiles[new_row][new_col].path_len = new_path_len;
-  maze->tiles[new_row][new_col].state = FOUND;
+  new_tile->state = FOUND;
+  maze_note_path(maze, new_row, new_col);
 
   // Add new tile to the queue
   rcqueue_add_rear(maze->queue, new_row, new_col);
 
   // Logging
   if (LOG_LEVEL >= LOG_BFS_PATHS) {
-    printf("LOG: Found tile at (%d,%d) with len %d path: ", new_row, new_col, new_path_len);
-    for (int i = 0; i < new_path_len; i++) {
-      printf("%s", direction_compact_strs[maze->tiles[new_row][new_col].path[i]]);
-    }
+    printf("LOG: Found tile at (%d,%d) with len %ld path: ", new_row, new_col, new_tile->path_len);
+    tile_print_path(new_tile, PATH_FORMAT_COMPACT);
     printf("\n");
   }
 
   return 1; // Ensure the function returns correct success value
 }
 
+// Generates a neighbor-processing kernel for a fixed number of
+// directions. Each kernel has a compile-time constant loop bound so
+// the compiler can fully unroll it; the 4-way kernel is identical to
+// the original loop and pays nothing for the existence of 8-way
+// movement beyond the single dispatch in maze_bfs_step().
+#define MAZE_BFS_NEIGHBOR_KERNEL(NAME, DELTA_END)                       \
+  static inline void NAME(maze_t *maze, int row, int col){             \
+    for (int i = DELTA_START; i < (DELTA_END); i++) {                   \
+      maze_bfs_process_neighbor(maze, row, col, dir_delta[i]);          \
+    }                                                                   \
+  }
+
+MAZE_BFS_NEIGHBOR_KERNEL(maze_bfs_neighbors_4way, DELTA_COUNT)
+MAZE_BFS_NEIGHBOR_KERNEL(maze_bfs_neighbors_8way, DELTA_COUNT_8WAY)
+
+// Generates a kernel that visits only the open neighbors recorded in
+// a tile's open_mask, lowest bit first so that neighbors are visited
+// in the same order as the probing kernels above.
+#define MAZE_BFS_MASKED_KERNEL(NAME, DIR_MASK)                          \
+  static inline void NAME(maze_t *maze, int row, int col){             \
+    unsigned int open = maze->tiles[row][col].open_mask & (DIR_MASK);   \
+    while (open != 0) {                                                 \
+      maze_bfs_visit(maze, row, col, __builtin_ctz(open) + DELTA_START); \
+      open &= open - 1;                                                 \
+    }                                                                   \
+  }
+
+MAZE_BFS_MASKED_KERNEL(maze_bfs_masked_4way, OPEN_MASK_4WAY)
+MAZE_BFS_MASKED_KERNEL(maze_bfs_masked_8way, OPEN_MASK_8WAY)
+
+// Prefetches, for writing, the tiles a BFS step will touch when it
+// expands the queue entry BFS_PREFETCH entries behind the front: the
+// entry's own tile, which shares cache lines with its WEST/EAST
+// neighbors, and the tiles above and below it which are a whole row
+// away. Expanding a tile rarely touches memory near the tile expanded
+// before it once the frontier is wide, so without this every step
+// waits on several cache misses. The entry is the queue's ahead node,
+// which moves with each add and remove, so finding it costs nothing
+// beyond setting the lead when BFS_PREFETCH changes. Only bordered
+// mazes are prefetched as rows -1 and `rows` must exist.
+static inline void maze_bfs_prefetch(maze_t *maze){
+    rcqueue_t *queue = maze->queue;
+    if (queue->lead != BFS_PREFETCH) {
+        rcqueue_set_lead(queue, BFS_PREFETCH);
+    }
+    rcnode_t *node = queue->ahead;
+    if (node == NULL || !maze->bordered) {
+        return;
+    }
+    __builtin_prefetch(&maze->tiles[node->row][node->col], 1);
+    __builtin_prefetch(&maze->tiles[node->row - 1][node->col], 1);
+    __builtin_prefetch(&maze->tiles[node->row + 1][node->col], 1);
+}
+
 int maze_bfs_step(maze_t *maze) 
 // PROBLEM 3: Processes the tile in BFS which is at the front of the
 // maze search queue. For the front tile, iterates over the directions
@@ -871,6 +1464,20 @@ int maze_bfs_step(maze_t *maze)
 // not be tested and should not arise if other parts of the program
 // are correct.
 //
+// If the maze movement is MOVEMENT_8WAY, the four diagonal directions
+// up to DELTA_COUNT_8WAY are processed after the orthogonal ones. A
+// diagonal move only requires that the destination is not blocked so
+// paths may slip between two walls that touch at a corner.
+//
+// If the maze masks_ready field is set, only the neighbors with bits
+// set in the tile's open_mask are processed. Blocked neighbors are
+// then never probed so this is not done when LOG_LEVEL is high enough
+// to log skipped BLOCKED tiles.
+//
+// Before processing, the tiles of the queue entry BFS_PREFETCH
+// entries behind the front are prefetched by maze_bfs_prefetch() so
+// they are in cache by the time that entry is expanded.
+//
 // LOGGING: 
 // If LOG_LEVEL >= LOG_BFS_STEPS, print a message like
 //   LOG: processing neighbors of (5,1)
@@ -943,9 +1550,26 @@ int maze_bfs_step(maze_t *maze)
         printf("LOG: processing neighbors of (%d,%d)\n", row, col);
     }
 
-    // Process all four possible moves (NORTH, SOUTH, WEST, EAST)
-    for (int i = DELTA_START; i < DELTA_COUNT; i++) {
-        maze_bfs_process_neighbor(maze, row, col, dir_delta[i]);
+    // Start loading the tiles of an entry further back in the queue
+    if (BFS_PREFETCH > 0) {
+        maze_bfs_prefetch(maze);
+    }
+
+    // Process all four possible moves (NORTH, SOUTH, WEST, EAST) plus
+    // the diagonals when 8-way movement is enabled
+    int masked = maze->masks_ready && LOG_LEVEL < LOG_SKIPPED_TILES;
+    if (maze->movement == MOVEMENT_8WAY) {
+        if (masked) {
+            maze_bfs_masked_8way(maze, row, col);
+        } else {
+            maze_bfs_neighbors_8way(maze, row, col);
+        }
+    } else {
+        if (masked) {
+            maze_bfs_masked_4way(maze, row, col);
+        } else {
+            maze_bfs_neighbors_4way(maze, row, col);
+        }
     }
 
     // Remove the front tile from the queue
@@ -991,12 +1615,12 @@ void maze_bfs_iterate(maze_t *maze)
         return;
     }
     
-    int step = 1;
+    long step = 1;
     // Continue processing BFS steps until the queue is empty.
     while (maze->queue->count > 0) {
         // Print the BFS step number if logging is enabled.
         if (LOG_LEVEL >= LOG_BFS_STEPS) {
-            printf("LOG: BFS STEP %d\n", step);
+            printf("LOG: BFS STEP %ld\n", step);
         }
         maze_bfs_step(maze);
         step++;
@@ -1007,6 +1631,149 @@ void maze_bfs_iterate(maze_t *maze)
 
 
 
+int maze_bfs_advance(maze_t *maze, long max_steps, long max_usec)
+// Continues the BFS started by maze_bfs_init() for at most max_steps
+// calls to maze_bfs_step() or about max_usec microseconds, whichever
+// comes first; a limit of 0 or less is no limit. Returns 1 once the
+// search is finished, because the queue is empty or the search was
+// cancelled, and 0 if there is more to do. Calling this repeatedly
+// until it returns 1 gives the same result as maze_bfs_iterate() so
+// several searches can be interleaved on one thread, each getting a
+// bounded slice of time per call.
+//
+// NOTES: Reading the clock costs about as much as a BFS step so the
+// time is checked only every BFS_CLOCK_STEPS steps; a slice may run
+// over max_usec by that many steps.
+{
+    if (maze == NULL || maze->queue == NULL) {
+        return 1;
+    }
+    struct timespec ts;
+    long deadline_ns = 0;
+    if (max_usec > 0) {
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        deadline_ns = ts.tv_sec * 1000000000L + ts.tv_nsec + max_usec * 1000L;
+    }
+    for (long step = 1; maze->queue->count > 0; step++) {
+        maze_bfs_step(maze);
+        if (max_steps > 0 && step >= max_steps) {
+            break;
+        }
+        if (max_usec > 0 && step % BFS_CLOCK_STEPS == 0) {
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            if (ts.tv_sec * 1000000000L + ts.tv_nsec >= deadline_ns) {
+                break;
+            }
+        }
+    }
+    return maze->queue->count == 0;
+}
+
+void maze_bfs_cancel(maze_t *maze)
+// Abandons the search in progress on `maze`: frees the queue and the
+// paths of all tiles and marks them NOTFOUND so the maze is as it was
+// before maze_bfs_init() and may be searched again. Afterwards
+// maze_bfs_advance() reports the search as finished. As in
+// maze_free(), an mmap()'d maze only has the tiles in the box noted by
+// maze_note_path() visited; the tiles outside it were never found.
+{
+    if (maze == NULL) {
+        return;
+    }
+    if (maze->queue != NULL) {
+        rcqueue_free(maze->queue);
+        maze->queue = NULL;
+    }
+    int top = 0, bottom = maze->rows - 1, left = 0, right = maze->cols - 1;
+    if (maze->alloc == MAZE_ALLOC_MMAP) {
+        top = maze->path_top;
+        bottom = maze->path_bottom;
+        left = maze->path_left;
+        right = maze->path_right;
+    }
+    for (int i = top; i <= bottom; i++) {
+        for (int j = left; j <= right; j++) {
+            tile_t *tile = &maze->tiles[i][j];
+            free(tile->path);
+            free(tile->packed);
+            tile->path = NULL;
+            tile->packed = NULL;
+            tile->path_len = -1;
+            tile->state = NOTFOUND;
+        }
+    }
+    // No tile has a path any more
+    maze->path_top = maze->rows;
+    maze->path_bottom = -1;
+    maze->path_left = maze->cols;
+    maze->path_right = -1;
+}
+
+int maze_bfs_nearest(maze_t *maze)
+// Multi-source / multi-target BFS used when a maze has several START
+// and/or END tiles. Every START tile is seeded into the queue with a
+// length 0 path so that a single flood computes, for each tile, the
+// path from its nearest START. BFS steps proceed until the first END
+// tile reaches the front of the queue: since tiles leave the queue in
+// order of distance, this is the END nearest to any START. The maze
+// end_row/end_col are set to that END and start_row/start_col to the
+// START its path originates from, found by walking the path
+// backwards, so that maze_set_solution() and printing work as for a
+// single START/END maze. Returns 1 if an END was reached and 0
+// otherwise, in which case the maze start/end are unchanged.
+//
+// LOGGING: If LOG_LEVEL >= LOG_BFS_STEPS prints the step number for
+// each iteration as in maze_bfs_iterate() and, on success, a message
+// like
+//   LOG: nearest END at (3,8) with len 17 path from START at (1,1)
+{
+    if (maze == NULL) {
+        return 0;
+    }
+
+    // Seed every START tile into a fresh queue
+    if (maze->queue != NULL) {
+        rcqueue_free(maze->queue);
+    }
+    maze->queue = rcqueue_allocate();
+    for (int i = 0; i < maze->rows; i++) {
+        for (int j = 0; j < maze->cols; j++) {
+            if (maze->tiles[i][j].type == START && !maze_bfs_seed(maze, i, j)) {
+                return 0;
+            }
+        }
+    }
+
+    // Step until the queue empties or an END tile is at the front
+    int row, col;
+    long step = 1;
+    while (rcqueue_get_front(maze->queue, &row, &col)) {
+        tile_t *tile = &maze->tiles[row][col];
+        if (tile->type == END) {
+            // Walk the path backwards from the END to its START
+            maze->end_row = row;
+            maze->end_col = col;
+            for (long i = tile->path_len - 1; i >= 0; i--) {
+                row -= row_delta[tile_path_dir(tile, i)];
+                col -= col_delta[tile_path_dir(tile, i)];
+            }
+            maze->start_row = row;
+            maze->start_col = col;
+            if (LOG_LEVEL >= LOG_BFS_STEPS) {
+                printf("LOG: nearest END at (%d,%d) with len %ld path from START at (%d,%d)\n",
+                       maze->end_row, maze->end_col, tile->path_len, row, col);
+            }
+            return 1;
+        }
+        if (LOG_LEVEL >= LOG_BFS_STEPS) {
+            printf("LOG: BFS STEP %ld\n", step);
+        }
+        maze_bfs_step(maze);
+        step++;
+    }
+    return 0;
+}
+
 int maze_set_solution(maze_t *maze) 
 // PROBLEM 3: Uses the path stored in the End tile to visit each tile
 // on the solution path from Star to End and make them as ONPATH to
@@ -1103,7 +1870,7 @@ int maze_set_solution(maze_t *maze)
     tile_t *end_tile = &maze->tiles[maze->end_row][maze->end_col];
 
     // Ensure the path exists before proceeding
-    if (end_tile->path == NULL || end_tile->path_len == 0) {
+    if (!tile_has_path(end_tile) || end_tile->path_len == 0) {
         return 0;
     }
 
@@ -1116,8 +1883,8 @@ int maze_set_solution(maze_t *maze)
     }
 
     // Follow the path from start to end
-    for (int i = 0; i < end_tile->path_len; i++) {
-        direction_t dir = end_tile->path[i];
+    for (long i = 0; i < end_tile->path_len; i++) {
+        direction_t dir = tile_path_dir(end_tile, i);
 
         // Move in the given direction
         row += row_delta[dir];
@@ -1130,7 +1897,7 @@ int maze_set_solution(maze_t *maze)
 
         // Log each step of the solution path
         if (LOG_LEVEL >= LOG_SET_SOLUTION) {
-            printf("LOG: solution path[%d] is %s, set (%d,%d) to ONPATH\n",
+            printf("LOG: solution path[%ld] is %s, set (%d,%d) to ONPATH\n",
                    i, direction_verbose_strs[dir], row, col);
         }
     }
@@ -1176,6 +1943,22 @@ maze_t *maze_from_file(char *fname)
 // tiletype_chars[] so the tile.type = 4 which is START in the
 // tiletype enumeration.
 //
+// A maze may contain several S and E tiles. The start_count and
+// end_count fields of the maze record how many were read while
+// start/end row/col hold the coordinates of the last of each; such
+// mazes are solved with maze_bfs_nearest().
+//
+// The open neighbors of every tile are recorded for use by the BFS
+// with maze_compute_row_masks(), for each row once the row after it
+// is read and for the last row at the end, then masks_ready is set.
+//
+// Tile rows are read with getline() so rows of any width fit.
+// Dimensions that are negative or above MAZE_MAX_DIM are rejected as
+// unreadable. Short rows are padded with OPEN tiles but a row longer
+// than the maze or with a character not in tiletype_chars[] is
+// malformed: an error names the row and NULL is returned, as
+// maze_from_file_parallel() does for the same files.
+//
 // CONSTRAINT: You must use fscanf() for this function. 
 //
 // CONSTRAINT: You MUST comment your code to describe the intent of
@@ -1268,7 +2051,8 @@ maze_t *maze_from_file(char *fname)
 
     int rows, cols;
     // Read the dimensions from a line like "rows: 7 cols: 19"
-    if (fscanf(fin, "rows: %d cols: %d", &rows, &cols) != 2) {
+    if (fscanf(fin, "rows: %d cols: %d", &rows, &cols) != 2 ||
+        rows < 0 || cols < 0 || rows > MAZE_MAX_DIM || cols > MAZE_MAX_DIM) {
         printf("Error: failed to read maze dimensions.\n");
         fclose(fin);
         return NULL;
@@ -1278,8 +2062,9 @@ maze_t *maze_from_file(char *fname)
         printf("LOG: expecting %d rows and %d columns\n", rows, cols);
     }
 
-    // Allocate the maze structure.
-    maze_t *maze = maze_allocate(rows, cols);
+    // Allocate the maze structure; tiles start zeroed with NULL paths
+    // so only their type, state, and path_len are set below
+    maze_t *maze = maze_allocate_lazy(rows, cols);
     if (maze == NULL) {
         fclose(fin);
         return NULL;
@@ -1302,24 +2087,31 @@ maze_t *maze_from_file(char *fname)
         printf("LOG: beginning to read tiles\n");
     }
 
-    // Buffer to hold each line of tile characters.
-    char line[1024];
+    // Buffer to hold each line of tile characters; getline() grows it
+    // to fit rows of any width.
+    char *line = NULL;
+    size_t line_size = 0;
     for (int i = 0; i < rows; i++) {
-        if (fgets(line, sizeof(line), fin) == NULL) {
+        long len = getline(&line, &line_size, fin);
+        if (len < 0) {
             printf("Error: unexpected end of file reading maze tiles.\n");
+            free(line);
             maze_free(maze);
             fclose(fin);
             return NULL;
         }
         // Remove trailing newline and carriage return.
-        int len = (int)strlen(line);
         while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
             line[len - 1] = '\0';
             len--;
         }
+        // A row longer than the maze or with a character that is not
+        // a tile is malformed; its tiles are still read and logged
+        int malformed = len > cols;
+
         // For each expected column, read the character (or use a space if missing)
         for (int j = 0; j < cols; j++) {
-            char ch = (j < (int)strlen(line)) ? line[j] : ' ';
+            char ch = (j < len) ? line[j] : ' ';
             int found = 0;
             int type = NOTSET;
             for (int k = 0; k < TILETYPE_COUNT; k++) {
@@ -1331,10 +2123,10 @@ maze_t *maze_from_file(char *fname)
             }
             if (!found) {
                 type = NOTSET;
+                malformed = 1;
             }
             maze->tiles[i][j].type = type;
             maze->tiles[i][j].state = NOTFOUND;
-            maze->tiles[i][j].path = NULL;
             maze->tiles[i][j].path_len = -1;
 
             if (LOG_LEVEL >= LOG_FILE_LOAD) {
@@ -1344,6 +2136,7 @@ maze_t *maze_from_file(char *fname)
             if (type == START) {
                 maze->start_row = i;
                 maze->start_col = j;
+                maze->start_count++;
                 if (LOG_LEVEL >= LOG_FILE_LOAD) {
                     printf("LOG: setting START at (%d,%d)\n", i, j);
                 }
@@ -1351,6 +2144,7 @@ maze_t *maze_from_file(char *fname)
             if (type == END) {
                 maze->end_row = i;
                 maze->end_col = j;
+                maze->end_count++;
                 if (LOG_LEVEL >= LOG_FILE_LOAD) {
                     printf("LOG: setting END at (%d,%d)\n", i, j);
                 }
@@ -1359,8 +2153,26 @@ maze_t *maze_from_file(char *fname)
         if (LOG_LEVEL >= LOG_FILE_LOAD) {
             printf("LOG: finished reading row %d of tiles\n", i);
         }
+        if (malformed) {
+            printf("Error: malformed row %d of maze tiles.\n", i);
+            free(line);
+            maze_free(maze);
+            fclose(fin);
+            return NULL;
+        }
+        // The row above now has all its neighbors set
+        if (i > 0) {
+            maze_compute_row_masks(maze, i - 1);
+        }
     }
 
+    free(line);
     fclose(fin);
+
+    // Finalize: the last row's neighbors below are the border
+    if (rows > 0) {
+        maze_compute_row_masks(maze, rows - 1);
+    }
+    maze->masks_ready = 1;
     return maze;
 }
\ No newline at end of file
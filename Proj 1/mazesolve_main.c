@@ -3,52 +3,406 @@
 #include <stdlib.h>
 #include <string.h>
 
+#define USAGE "Usage: %s [-log <level>] [-diag] [-rle] [-dist <dist-file>] [-threads <N>]\n" \
+    "       [-prune] [-graph] [-hpa <hpa-file>] [-checkpoint <ckpt-file>]\n" \
+    "       [-queries <query-file>] [-reach] [-cache <cache-dir>]\n" \
+    "       [-alt <landmark-file>] [-diameter] [-csr bfs|hilbert] [-paths <N>]\n" \
+    "       <maze-file>\n"
+
 int main(int argc, char *argv[]) {
     char *filename = NULL;
+    int movement = MOVEMENT_4WAY;
+    int path_format = PATH_FORMAT_VERBOSE;
+    char *dist_fname = NULL;
+    int load_threads = 0;
+    int prune = 0;
+    int use_graph = 0;
+    char *hpa_fname = NULL;
+    char *ckpt_fname = NULL;
+    char *query_fname = NULL;
+    int reach_only = 0;
+    char *cache_dir = NULL;
+    char *alt_fname = NULL;
+    int diameter_only = 0;
+    int csr_order = -1;
+    long list_paths = -1;
     
-    // Check command line usage
-    if (argc == 2) {
-        // Form 1: ./mazesolve_main <mazefile>
-        filename = argv[1];
-    } else if (argc == 4) {
-        // Form 2: ./mazesolve_main -log <N> <mazefile>
-        if (strcmp(argv[1], "-log") == 0) {
-            LOG_LEVEL = atoi(argv[2]);
-            filename = argv[3];
+    // Check command line usage: options come first and the maze data
+    // file is always the last argument
+    // Form 1: ./mazesolve_main <mazefile>
+    // Form 2: ./mazesolve_main -log <N> <mazefile>
+    // Form 3: ./mazesolve_main -diag <mazefile> (8-way movement)
+    // Form 4: ./mazesolve_main -rle <mazefile> (run-length encoded path)
+    // Form 5: ./mazesolve_main -dist <distfile> <mazefile> (write distances only)
+    // Form 6: ./mazesolve_main -threads <N> <mazefile> (parallel file loading)
+    // Form 7: ./mazesolve_main -prune <mazefile> (fill dead ends before solving)
+    // Form 8: ./mazesolve_main -graph <mazefile> (solve on the junction graph)
+    // Form 9: ./mazesolve_main -hpa <hpafile> <mazefile> (solve with clusters
+    //         loaded from hpafile, building and saving them if needed;
+    //         4-way movement only so -diag is not allowed)
+    // Form 10: ./mazesolve_main -checkpoint <ckptfile> <mazefile> (save
+    //         the BFS periodically, resuming from ckptfile if present)
+    // Form 11: ./mazesolve_main -queries <queryfile> <mazefile> (solve
+    //         each "start_row start_col end_row end_col" line of
+    //         queryfile, on -threads N threads if given)
+    // Form 12: ./mazesolve_main -reach <mazefile> (report whether END is
+    //         reachable using only runs of open tiles)
+    // Form 13: ./mazesolve_main -cache <cachedir> <mazefile> (reuse a
+    //         solution stored in cachedir by an earlier run)
+    // Form 14: ./mazesolve_main -alt <altfile> <mazefile> (solve with A*
+    //         using landmarks mapped from altfile, choosing and saving
+    //         them if needed)
+    // Form 15: ./mazesolve_main -diameter <mazefile> (report the longest
+    //         shortest path among tiles reachable from START)
+    // Form 16: ./mazesolve_main -csr bfs|hilbert <mazefile> (solve on a
+    //         graph of only the open tiles numbered in that order)
+    // Form 17: ./mazesolve_main -paths <N> <mazefile> (count the
+    //         shortest paths from START to END and list the first N)
+    // Every form exits 0 once the maze is read, including when it has
+    // no solution; only usage and file errors exit 1.
+    if (argc < 2) {
+        fprintf(stderr, USAGE, argv[0]);
+        return 1;
+    }
+    for (int i = 1; i < argc - 1; i++) {
+        if (strcmp(argv[i], "-log") == 0 && i + 1 < argc - 1) {
+            LOG_LEVEL = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-diag") == 0) {
+            movement = MOVEMENT_8WAY;
+        } else if (strcmp(argv[i], "-rle") == 0) {
+            path_format = PATH_FORMAT_RLE;
+        } else if (strcmp(argv[i], "-dist") == 0 && i + 1 < argc - 1) {
+            dist_fname = argv[++i];
+        } else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc - 1) {
+            load_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-prune") == 0) {
+            prune = 1;
+        } else if (strcmp(argv[i], "-graph") == 0) {
+            use_graph = 1;
+        } else if (strcmp(argv[i], "-hpa") == 0 && i + 1 < argc - 1) {
+            hpa_fname = argv[++i];
+        } else if (strcmp(argv[i], "-checkpoint") == 0 && i + 1 < argc - 1) {
+            ckpt_fname = argv[++i];
+        } else if (strcmp(argv[i], "-queries") == 0 && i + 1 < argc - 1) {
+            query_fname = argv[++i];
+        } else if (strcmp(argv[i], "-reach") == 0) {
+            reach_only = 1;
+        } else if (strcmp(argv[i], "-cache") == 0 && i + 1 < argc - 1) {
+            cache_dir = argv[++i];
+        } else if (strcmp(argv[i], "-alt") == 0 && i + 1 < argc - 1) {
+            alt_fname = argv[++i];
+        } else if (strcmp(argv[i], "-diameter") == 0) {
+            diameter_only = 1;
+        } else if (strcmp(argv[i], "-csr") == 0 && i + 1 < argc - 1 &&
+                   (strcmp(argv[i + 1], "bfs") == 0 || strcmp(argv[i + 1], "hilbert") == 0)) {
+            csr_order = (strcmp(argv[++i], "hilbert") == 0) ? CSR_ORDER_HILBERT : CSR_ORDER_BFS;
+        } else if (strcmp(argv[i], "-paths") == 0 && i + 1 < argc - 1) {
+            list_paths = atol(argv[++i]);
         } else {
             // Print usage information and return error if arguments are invalid
-            fprintf(stderr, "Usage: %s [-log <level>] <maze-file>\n", argv[0]);
+            fprintf(stderr, USAGE, argv[0]);
             return 1;
         }
-    } else {
-         // Print usage information if argument count is incorrect
-        fprintf(stderr, "Usage: %s [-log <level>] <maze-file>\n", argv[0]);
+    }
+    if (hpa_fname != NULL && movement == MOVEMENT_8WAY) {
+        // Clusters are only built for 4-way movement
+        fprintf(stderr, "-hpa cannot be combined with -diag\n");
+        fprintf(stderr, USAGE, argv[0]);
         return 1;
     }
+    filename = argv[argc - 1];
     
-    // Attempt to load the maze from the file
-    maze_t *maze = maze_from_file(filename);
+    // Only check reachability if requested; the maze is read as runs
+    // of open tiles so no tiles are created
+    if (reach_only) {
+        mazerle_t *rle = mazerle_from_file(filename);
+        if (rle == NULL) {
+            printf("Could not load maze file. Exiting with error code 1\n");
+            return 1;
+        }
+        rle->movement = movement;
+        unsigned char *reached = malloc(rle->run_count > 0 ? rle->run_count : 1);
+        long tiles = mazerle_reach(rle, rle->start_row, rle->start_col, reached);
+        long end_run = mazerle_find_run(rle, rle->end_row, rle->end_col);
+        printf("runs: %ld\n", rle->run_count);
+        printf("reachable tiles: %ld\n", tiles);
+        printf("END %s reachable\n", (end_run >= 0 && reached[end_run]) ? "is" : "is not");
+        free(reached);
+        mazerle_free(rle);
+        return 0;
+    }
+
+    // Attempt to load the maze from the file, splitting the rows among
+    // several threads if requested
+    maze_t *maze = (load_threads > 0) ?
+        maze_from_file_parallel(filename, load_threads) : maze_from_file(filename);
     if (maze == NULL) {
         printf("Could not load maze file. Exiting with error code 1\n");
         return 1;
     }
     
+    // Only write the distance field from the START if requested
+    if (dist_fname != NULL) {
+        maze->movement = movement;
+        long reached = maze_write_distances(maze, dist_fname);
+        maze_free(maze);
+        if (reached < 0) {
+            return 1;
+        }
+        printf("wrote distances for %ld reachable tiles to %s\n", reached, dist_fname);
+        return 0;
+    }
+
+    // Only analyze the diameter if requested, with bounds on how far
+    // each tile is from the tile farthest from it
+    if (diameter_only) {
+        maze->movement = movement;
+        mazegrid_t *grid = mazegrid_from_maze(maze, GRID_LAYOUT_BLOCKED);
+        int *ecc_lo = malloc(sizeof(int) * grid->ncells);
+        int *ecc_hi = malloc(sizeof(int) * grid->ncells);
+        int sweeps;
+        long diameter = mazegrid_diameter(grid, maze->start_row, maze->start_col,
+                                          &sweeps, ecc_lo, ecc_hi);
+        long tiles = 0, exact = 0;
+        for (int i = 0; i < maze->rows; i++) {
+            for (int j = 0; j < maze->cols; j++) {
+                long idx = mazegrid_index(grid, i, j);
+                tiles += ecc_lo[idx] >= 0;
+                exact += ecc_lo[idx] >= 0 && ecc_lo[idx] == ecc_hi[idx];
+            }
+        }
+        printf("diameter: %ld\n", diameter);
+        printf("BFS sweeps: %d for %ld reachable tiles\n", sweeps, tiles);
+        printf("eccentricity known exactly for %ld tiles\n", exact);
+        if (LOG_LEVEL >= LOG_BFS_STEPS) {
+            for (int i = 0; i < maze->rows; i++) {
+                for (int j = 0; j < maze->cols; j++) {
+                    long idx = mazegrid_index(grid, i, j);
+                    if (ecc_lo[idx] >= 0) {
+                        printf("LOG: (%d,%d) eccentricity %d to %d\n", i, j, ecc_lo[idx], ecc_hi[idx]);
+                    }
+                }
+            }
+        }
+        free(ecc_lo);
+        free(ecc_hi);
+        mazegrid_free(grid);
+        maze_free(maze);
+        return (diameter < 0) ? 1 : 0;
+    }
+
+    // Only count shortest paths if requested, listing the first few
+    // one at a time so that they are never all held in memory
+    if (list_paths >= 0) {
+        maze->movement = movement;
+        mazegrid_t *grid = mazegrid_from_maze(maze, GRID_LAYOUT_BLOCKED);
+        int *dist = malloc(sizeof(int) * grid->ncells);
+        unsigned long *counts = malloc(sizeof(unsigned long) * grid->ncells);
+        mazegrid_count_paths(grid, maze->start_row, maze->start_col, dist, counts);
+        pathenum_t *pe = pathenum_start(grid, dist, maze->end_row, maze->end_col);
+        if (pe == NULL) {
+            printf("NO SOLUTION FOUND\n");
+        } else {
+            unsigned long count = counts[mazegrid_index(grid, maze->end_row, maze->end_col)];
+            if (count == PATHS_SATURATED) {
+                printf("shortest paths: at least %lu\n", count);
+            } else {
+                printf("shortest paths: %lu\n", count);
+            }
+            printf("path length: %ld\n", pe->len);
+            for (long p = 0; p < list_paths && pathenum_next(pe); p++) {
+                for (long k = 0; k < pe->len; k++) {
+                    printf("%s", direction_compact_strs[pe->path[k]]);
+                }
+                printf("\n");
+            }
+        }
+        pathenum_free(pe);
+        free(dist);
+        free(counts);
+        mazegrid_free(grid);
+        maze_free(maze);
+        return 0;
+    }
+
+    // Only answer the queries in a file if requested; all threads
+    // share one read-only grid of the maze
+    if (query_fname != NULL) {
+        FILE *fin = fopen(query_fname, "r");
+        if (fin == NULL) {
+            printf("ERROR: could not open file %s\n", query_fname);
+            maze_free(maze);
+            return 1;
+        }
+        int count = 0, capacity = 16;
+        mazequery_t *queries = malloc(sizeof(mazequery_t) * capacity);
+        mazequery_t q;
+        while (fscanf(fin, "%d %d %d %d", &q.start_row, &q.start_col, &q.end_row, &q.end_col) == 4) {
+            if (count == capacity) {
+                capacity *= 2;
+                queries = realloc(queries, sizeof(mazequery_t) * capacity);
+            }
+            queries[count++] = q;
+        }
+        fclose(fin);
+        maze->movement = movement;
+        mazegrid_t *grid = mazegrid_from_maze(maze, GRID_LAYOUT_BLOCKED);
+        mazepool_solve_all(grid, queries, count, load_threads);
+        for (int k = 0; k < count; k++) {
+            printf("query %d: (%d,%d) to (%d,%d) length %ld\n", k, queries[k].start_row,
+                   queries[k].start_col, queries[k].end_row, queries[k].end_col, queries[k].length);
+        }
+        free(queries);
+        mazegrid_free(grid);
+        maze_free(maze);
+        return 0;
+    }
+
     // Print the unsolved maze tiles
     maze_print_tiles(maze);
     
-    // Solve the maze using BFS
-    maze_bfs_iterate(maze);
+    // Fill dead ends so the BFS only visits tiles that may lie on a
+    // path between START and END tiles
+    maze->movement = movement;
+    int *pruned_tiles = NULL;
+    long pruned = 0;
+    if (prune) {
+        pruned = maze_fill_dead_ends(maze, &pruned_tiles);
+        printf("pruned %ld dead-end tiles\n", pruned);
+    }
+
+    // Solve the maze using BFS; mazes with several START or END tiles
+    // use a single multi-source flood that stops at the nearest END
+    // while -graph runs Dijkstra on the corridors between junctions
+    maze->pack_paths = 1;       // 2-bit paths for 4-way movement
+    int found = 1;
+
+    // A solution stored by an earlier run on identical maze bytes is
+    // used without searching; HPA paths are not cached as they may be
+    // longer than the shortest path
+    mazecache_t *cache = NULL;
+    unsigned long cache_key = 0;
+    int cached = CACHE_MISS;
+    if (cache_dir != NULL && hpa_fname == NULL && maze->start_count <= 1 && maze->end_count <= 1) {
+        cache = mazecache_open(cache_dir, CACHE_MAX_BYTES);
+        cache_key = mazecache_key(filename, maze);
+        if (cache != NULL && cache_key != 0) {
+            cached = mazecache_lookup(cache, cache_key, maze);
+        }
+    }
+    if (cached != CACHE_MISS) {
+        found = cached;
+    } else if (hpa_fname != NULL && maze->start_count <= 1 && maze->end_count <= 1) {
+        // The abstraction is reused across runs on the same maze walls
+        // and rebuilt if the file was made from any other maze
+        mazehpa_t *hpa = mazehpa_read(hpa_fname, maze);
+        if (hpa == NULL) {
+            hpa = mazehpa_build(maze, HPA_CLUSTER_SIZE);
+            mazehpa_write(hpa, hpa_fname);
+        }
+        printf("abstraction: %d nodes %d edges\n", hpa->node_count, hpa->edge_count);
+        found = maze_solve_hpa(maze, hpa);
+        mazehpa_free(hpa);
+    } else if (alt_fname != NULL && maze->start_count <= 1 && maze->end_count <= 1) {
+        // Landmark distances are mapped rather than read as A* only
+        // looks at those of the tiles it expands; landmarks of any
+        // other maze are rebuilt as their bounds may be too large.
+        // Mazes too large for A* tile numbers are searched directly
+        mazealt_t *alt = maze_astar_fits(maze) ? mazealt_open(alt_fname, 1) : NULL;
+        if (alt != NULL && (alt->header->rows != maze->rows || alt->header->cols != maze->cols ||
+                            alt->header->movement != maze->movement ||
+                            alt->header->key != mazecache_maze_key(maze, 0))) {
+            mazealt_free(alt);
+            alt = NULL;
+        }
+        if (alt == NULL && (alt = mazealt_build(maze, ALT_LANDMARKS)) != NULL) {
+            mazealt_write(alt, alt_fname);
+        }
+        long expanded;
+        found = maze_solve_astar(maze, alt, &expanded);
+        if (found >= 0) {
+            printf("landmarks: %d, A* expanded %ld tiles\n",
+                   (alt != NULL) ? alt->header->count : 0, expanded);
+        } else {
+            found = 1;
+            maze_bfs_iterate(maze);
+        }
+        mazealt_free(alt);
+    } else if (ckpt_fname != NULL && maze->start_count <= 1 && maze->end_count <= 1) {
+        // Continue a search saved by an earlier run or start a new one,
+        // saving it every CHECKPOINT_STEPS steps; the checkpoint is
+        // removed once the search completes
+        if (maze_bfs_resume(maze, ckpt_fname)) {
+            printf("resumed search from %s\n", ckpt_fname);
+        } else {
+            maze_bfs_init(maze);
+        }
+        long step = 0;
+        while (maze->queue->count > 0) {
+            maze_bfs_step(maze);
+            if (++step % CHECKPOINT_STEPS == 0) {
+                maze_bfs_checkpoint(maze, ckpt_fname);
+            }
+        }
+        remove(ckpt_fname);
+    } else if (use_graph && maze->start_count <= 1 && maze->end_count <= 1) {
+        // Mazes too large for int node numbers are searched directly
+        mazegraph_t *graph = mazegraph_from_maze(maze);
+        if (graph != NULL) {
+            printf("junction graph: %d nodes %d edges\n", graph->node_count, graph->edge_count);
+            found = maze_solve_graph(maze, graph);
+            mazegraph_free(graph);
+        } else {
+            maze_bfs_iterate(maze);
+        }
+    } else if (csr_order >= 0 && maze->start_count <= 1 && maze->end_count <= 1) {
+        // Mazes too large for int node numbers are searched directly
+        mazecsr_t *csr = mazecsr_from_maze(maze, csr_order);
+        if (csr != NULL) {
+            printf("open tile graph: %d nodes %d neighbor entries\n",
+                   csr->node_count, csr->first[csr->node_count]);
+            found = maze_solve_csr(maze, csr);
+            mazecsr_free(csr);
+        } else {
+            maze_bfs_iterate(maze);
+        }
+    } else if (maze->start_count > 1 || maze->end_count > 1) {
+        found = maze_bfs_nearest(maze);
+    } else {
+        maze_bfs_iterate(maze);
+    }
+    if (cache != NULL && cache_key != 0 && cached == CACHE_MISS) {
+        mazecache_store(cache, cache_key, maze, found);
+    }
     
-    // Set the solution on the maze.
+    // Set the solution on the maze, reopening pruned tiles so the
+    // solved maze prints as it was read.
     // If a solution is found, print "SOLUTION:" then the solved maze and the path.
-    if (maze_set_solution(maze)) {
+    int solved = found && maze_set_solution(maze);
+    maze_restore_dead_ends(maze, pruned_tiles, pruned);
+    free(pruned_tiles);
+    if (solved) {
         printf("SOLUTION:\n");
         maze_print_tiles(maze);
-        // Print the solution path in verbose format.
-        tile_print_path(&(maze->tiles[maze->end_row][maze->end_col]), PATH_FORMAT_VERBOSE);
+        // Print the solution path in verbose format or, for long
+        // paths, compactly as runs like N12E3S40
+        tile_t *end_tile = &(maze->tiles[maze->end_row][maze->end_col]);
+        if (path_format == PATH_FORMAT_RLE) {
+            printf("path length: %ld\n", end_tile->path_len);
+            tile_print_path(end_tile, PATH_FORMAT_RLE);
+            printf("\n");
+        } else {
+            tile_print_path(end_tile, PATH_FORMAT_VERBOSE);
+        }
     } else {
         printf("NO SOLUTION FOUND\n");
     }
+    if (cache != NULL) {
+        long hits, misses;
+        mazecache_close(cache, &hits, &misses);
+        printf("cache %s: %ld hits %ld misses\n", (cached == CACHE_MISS) ? "miss" : "hit",
+               hits, misses);
+    }
     
     maze_free(maze);
     return 0;
@@ -1,4 +1,7 @@
 #include "mazesolve.h"
+#include <unistd.h>
+#include <utime.h>
+#include <sys/wait.h>
 // Fri Feb 14 10:43:47 AM EST 2025 Update to maze_bfs_step2; see
 // https://piazza.com/class/m69s0i6labk3eb/post/104
 
@@ -70,7 +73,7 @@ int main(int argc, char *argv[]){
   IF_TEST("rcqueue_allocate_free1") {
     // Allocate and free an empty queue.
     rcqueue_t *queue = rcqueue_allocate();
-    printf("queue->count: %d\n",queue->count);
+    printf("queue->count: %ld\n",queue->count);
     printf("queue->front: %p\n",queue->front);
     printf("queue->rear:  %p\n",queue->rear);
     rcqueue_free(queue);
@@ -81,7 +84,7 @@ int main(int argc, char *argv[]){
     // that the front/rear node is the same for a single element add.
     rcqueue_t *queue = rcqueue_allocate();
     rcqueue_add_rear(queue,5,9);
-    printf("queue->count: %d\n",queue->count);
+    printf("queue->count: %ld\n",queue->count);
     printf("queue->front->row: %d\n",queue->front->row);
     printf("queue->front->col: %d\n",queue->front->col);
     printf("queue->rear->row: %d\n",queue->rear->row);
@@ -96,7 +99,7 @@ int main(int argc, char *argv[]){
     rcqueue_add_rear(queue,10,2);
     rcqueue_add_rear(queue,9,3);
     rcqueue_add_rear(queue,11,4);
-    printf("queue->count: %d\n",queue->count);
+    printf("queue->count: %ld\n",queue->count);
     printf("queue->front->row: %d\n",queue->front->row);
     printf("queue->front->col: %d\n",queue->front->col);
     printf("queue->rear->row: %d\n",queue->rear->row);
@@ -128,7 +131,7 @@ int main(int argc, char *argv[]){
     rcqueue_add_rear(queue,11,4);
     ret = rcqueue_remove_front(queue);
     printf("ret: %d\n",ret);
-    printf("queue->count: %d\n",queue->count);
+    printf("queue->count: %ld\n",queue->count);
     printf("queue->front->row: %d\n",queue->front->row);
     printf("queue->front->col: %d\n",queue->front->col);
     printf("queue->rear->row: %d\n",queue->rear->row);
@@ -151,7 +154,7 @@ int main(int argc, char *argv[]){
     printf("ret: %d\n",ret);
     ret = rcqueue_remove_front(queue);
     printf("ret: %d\n",ret);
-    printf("queue->count: %d\n",queue->count);
+    printf("queue->count: %ld\n",queue->count);
     printf("queue->front->row: %d\n",queue->front->row);
     printf("queue->front->col: %d\n",queue->front->col);
     printf("queue->rear->row: %d\n",queue->rear->row);
@@ -186,8 +189,8 @@ int main(int argc, char *argv[]){
     printf("front row/col: (%d,%d)\n",row,col);
     ret = rcqueue_remove_front(queue);
     printf("remove ret: %d\n",ret);
-    printf("queue->count: %d\n",queue->count);
-    printf("queue->count: %d\n",queue->count);
+    printf("queue->count: %ld\n",queue->count);
+    printf("queue->count: %ld\n",queue->count);
     printf("queue->front: %p\n",queue->front);
     printf("queue->rear:  %p\n",queue->rear);
     ret = rcqueue_get_front(queue, &row, &col);
@@ -195,8 +198,8 @@ int main(int argc, char *argv[]){
     printf("front row/col: (%d,%d) //previous vals\n",row,col);
     ret = rcqueue_remove_front(queue);
     printf("remove ret: %d\n",ret);
-    printf("queue->count: %d\n",queue->count);
-    printf("queue->count: %d\n",queue->count);
+    printf("queue->count: %ld\n",queue->count);
+    printf("queue->count: %ld\n",queue->count);
     printf("queue->front: %p\n",queue->front);
     printf("queue->rear:  %p\n",queue->rear);
     rcqueue_free(queue);
@@ -327,7 +330,7 @@ int main(int argc, char *argv[]){
       for(int j=0; j<cols; j++){
         printf("maze->tiles[%d][%d]: ",i,j);
         tile_t *tile = &maze->tiles[i][j];
-        printf("type %d state %d path_len %d path %p\n",
+        printf("type %d state %d path_len %ld path %p\n",
                tile->type, tile->state,
                tile->path_len, tile->path);
       }
@@ -375,7 +378,7 @@ int main(int argc, char *argv[]){
       for(int j=0; j<cols; j++){
         printf("maze->tiles[%d][%d]: ",i,j);
         tile_t *tile = &maze->tiles[i][j];
-        printf("type %d state %d path_len %d path ",
+        printf("type %d state %d path_len %ld path ",
                tile->type, tile->state,
                tile->path_len);
         tile_print_path(tile,PATH_FORMAT_COMPACT);
@@ -1125,6 +1128,1792 @@ int main(int argc, char *argv[]){
     maze_free(maze);
   } // ENDTEST
 
+  ////////////////////////////////////////////////////////////////////////////////
+  // PROBLEM 5 TESTS: extensions
+  ////////////////////////////////////////////////////////////////////////////////
+
+  IF_TEST("maze_bfs_8way1") {
+    // Enable 8-way movement so that diagonal moves are allowed. The
+    // shortest path cuts diagonally across the open room and is
+    // shorter than the 4-way path.
+    char *maze_str =
+      "#######\n"
+      "#S    #\n"
+      "#     #\n"
+      "#   # #\n"
+      "#    E#\n"
+      "#######\n";
+    maze_t *maze = maze_from_string(maze_str);
+    maze->movement = MOVEMENT_8WAY;
+    maze_bfs_iterate(maze);
+    printf("Maze AFTER BFS iteration\n");
+    maze_print_state(maze);
+    int ret = maze_set_solution(maze);
+    printf("ret: %d\n",ret);
+    maze_print_tiles(maze);
+    tile_print_path(&maze->tiles[maze->end_row][maze->end_col],PATH_FORMAT_VERBOSE);
+    printf("COMPACT: {");
+    tile_print_path(&maze->tiles[maze->end_row][maze->end_col],PATH_FORMAT_COMPACT);
+    printf("}\n");
+    maze_free(maze);
+  } // ENDTEST
+
+  IF_TEST("maze_bfs_8way2") {
+    // 8-way steps from a tile on the edge of the maze: diagonal
+    // neighbors that are out of bounds are skipped as BLOCKED.
+    char *maze_str =
+      "S  \n"
+      " # \n"
+      "  E\n";
+    maze_t *maze = maze_from_string(maze_str);
+    maze->movement = MOVEMENT_8WAY;
+    maze_bfs_init(maze);
+    LOG_LEVEL = LOG_ALL;
+    int ret = maze_bfs_step(maze);
+    printf("step ret: %d\n",ret);
+    maze_free(maze);
+  } // ENDTEST
+
+  IF_TEST("maze_bfs_nearest1") {
+    // Multiple START and END tiles: a single multi-source BFS finds
+    // the END nearest to any START and sets the maze start/end to
+    // that pair so the solution can be set as usual.
+    char *maze_str =
+      "###########\n"
+      "#S       E#\n"
+      "# ####### #\n"
+      "#   E   # #\n"
+      "# ##### # #\n"
+      "#     S   #\n"
+      "###########\n";
+    maze_t *maze = maze_from_string(maze_str);
+    LOG_LEVEL = 0;
+    int ret = maze_bfs_nearest(maze);
+    printf("ret: %d\n",ret);
+    maze_set_solution(maze);
+    maze_print_tiles(maze);
+    tile_print_path(&maze->tiles[maze->end_row][maze->end_col],PATH_FORMAT_COMPACT);
+    printf("\n");
+    maze_free(maze);
+  } // ENDTEST
+
+  IF_TEST("maze_bfs_nearest2") {
+    // No END is reachable from either START so 0 is returned and the
+    // maze start/end are left alone.
+    char *maze_str =
+      "#######\n"
+      "#S#E# #\n"
+      "# ### #\n"
+      "#S    #\n"
+      "#######\n";
+    maze_t *maze = maze_from_string(maze_str);
+    LOG_LEVEL = LOG_BFS_STEPS;
+    int ret = maze_bfs_nearest(maze);
+    printf("ret: %d\n",ret);
+    printf("start (%d,%d) end (%d,%d)\n",
+           maze->start_row,maze->start_col,maze->end_row,maze->end_col);
+    maze_free(maze);
+  } // ENDTEST
+
+  IF_TEST("rlepath_roundtrip1") {
+    // Encode a path into runs, print it in RLE format both from the
+    // tile and the encoded form, then parse the text and expand it
+    // back to the original directions.
+    direction_t *path = malloc(sizeof(direction_t)*9);
+    direction_t dirs[9] = {NORTH,NORTH,NORTH,EAST,SOUTH,SOUTH,
+                           SOUTHEAST,SOUTHEAST,WEST};
+    memcpy(path, dirs, sizeof(direction_t)*9);
+    tile_t tile = {.type=OPEN, .path_len=9, .path=path};
+    printf("TILE RLE: {");
+    tile_print_path(&tile, PATH_FORMAT_RLE);
+    printf("}\n");
+    rlepath_t *rle = rlepath_from_tile(&tile);
+    printf("run_count: %ld path_len: %ld\n",rle->run_count,rle->path_len);
+    printf("RLEPATH: {");
+    rlepath_print(rle);
+    printf("}\n");
+    rlepath_t *parsed = rlepath_parse("N3E1S2se2W1");
+    direction_t *expanded = rlepath_expand(parsed);
+    tile_t copy = {.type=OPEN, .path_len=parsed->path_len, .path=expanded};
+    printf("EXPANDED: {");
+    tile_print_path(&copy, PATH_FORMAT_COMPACT);
+    printf("}\n");
+    printf("same: %d\n", memcmp(path,expanded,sizeof(direction_t)*9)==0);
+    free(expanded); free(path);
+    rlepath_free(parsed); rlepath_free(rle);
+  } // ENDTEST
+
+  IF_TEST("rlepath_special1") {
+    // Special cases: a length 0 path has no runs, a NULL path gives
+    // a NULL encoding, and malformed text fails to parse.
+    direction_t *path = malloc(sizeof(direction_t)*1);
+    tile_t tile = {.type=START, .path_len=0, .path=path};
+    rlepath_t *rle = rlepath_from_tile(&tile);
+    printf("run_count: %ld path_len: %ld\n",rle->run_count,rle->path_len);
+    printf("RLE: {");
+    tile_print_path(&tile, PATH_FORMAT_RLE);
+    printf("}\n");
+    rlepath_free(rle);
+    tile.path = NULL;
+    printf("NULL path rle: %p\n", rlepath_from_tile(&tile));
+    printf("parse 'N3X2': %p\n", rlepath_parse("N3X2"));
+    printf("parse 'N0': %p\n", rlepath_parse("N0"));
+    printf("parse 'NE': %p\n", rlepath_parse("NE"));
+    free(path);
+  } // ENDTEST
+
+  IF_TEST("tile_extend_path_packed1") {
+    // Extend a 2-bit packed path across a byte boundary: 4 moves fill
+    // the first byte so the 5th move starts a new byte.
+    unsigned char *src_packed = malloc(1);
+    src_packed[0] = 0;
+    tile_t src = {.type=OPEN, .path_len=0, .packed=src_packed};
+    tile_t dst = {.type=OPEN, .path_len=-1};
+    direction_t dirs[5] = {NORTH,EAST,EAST,SOUTH,WEST};
+    for(int i=0; i<5; i++){
+      tile_extend_path(&src,&dst,dirs[i]);
+      printf("len %ld bytes %ld path NULL? %d: ",
+             dst.path_len, PACKED_BYTES(dst.path_len), dst.path==NULL);
+      tile_print_path(&dst, PATH_FORMAT_COMPACT);
+      printf("\n");
+      free(src.packed);
+      src = dst;
+    }
+    printf("first byte: 0x%02x\n", src.packed[0]);
+    tile_print_path(&src, PATH_FORMAT_VERBOSE);
+    free(src.packed);
+  } // ENDTEST
+
+  IF_TEST("maze_bfs_packed1") {
+    // Solve a maze with packed paths turned on: tiles found in the
+    // BFS get packed paths rather than direction_t arrays and the
+    // solution is set and printed from the packed form.
+    char *maze_str =
+      "###########\n"
+      "#S       ##\n"
+      "# ### ## ##\n"
+      "# ### ## ##\n"
+      "# ###E## ##\n"
+      "#        ##\n"
+      "###########\n";
+    maze_t *maze = maze_from_string(maze_str);
+    maze->pack_paths = 1;
+    maze_bfs_iterate(maze);
+    tile_t *end_tile = &maze->tiles[maze->end_row][maze->end_col];
+    printf("end path NULL? %d packed NULL? %d\n",
+           end_tile->path==NULL, end_tile->packed==NULL);
+    LOG_LEVEL = LOG_SET_SOLUTION;
+    int ret = maze_set_solution(maze);
+    printf("ret: %d\n",ret);
+    maze_print_tiles(maze);
+    tile_print_path(end_tile, PATH_FORMAT_VERBOSE);
+    maze_free(maze);
+  } // ENDTEST
+
+  IF_TEST("mazegrid_bfs1") {
+    // Copy a maze into row-major and blocked grids and compute BFS
+    // distances from the Start in each. The distances printed through
+    // mazegrid_index() must match even though the cells are stored in
+    // a different order in memory.
+    char *maze_str =
+      "###########\n"
+      "#S       ##\n"
+      "# ### ## ##\n"
+      "# ### ## ##\n"
+      "# ###E## ##\n"
+      "#        ##\n"
+      "#### ######\n"
+      "#    #    #\n"
+      "# ## #  # #\n"
+      "#         #\n"
+      "###########\n";
+    maze_t *maze = maze_from_string(maze_str);
+    int layouts[2] = {GRID_LAYOUT_ROWMAJOR, GRID_LAYOUT_BLOCKED};
+    for(int l=0; l<2; l++){
+      mazegrid_t *grid = mazegrid_from_maze(maze, layouts[l]);
+      int *dist = malloc(sizeof(int)*grid->ncells);
+      long reached = mazegrid_bfs(grid, maze->start_row, maze->start_col, dist);
+      printf("layout %d ncells %ld reached %ld\n", grid->layout, grid->ncells, reached);
+      printf("index of (9,9): %ld\n", mazegrid_index(grid,9,9));
+      for(int i=0; i<grid->rows; i++){
+        for(int j=0; j<grid->cols; j++){
+          printf("%3d", dist[mazegrid_index(grid,i,j)]);
+        }
+        printf("\n");
+      }
+      free(dist);
+      mazegrid_free(grid);
+    }
+    maze_free(maze);
+  } // ENDTEST
+
+  IF_TEST("maze_allocate_border1") {
+    // Allocated mazes have a hidden border of WALL tiles around the
+    // visible tiles which is not printed but lets the BFS probe
+    // neighbors of edge tiles without bounds checks.
+    char *maze_str =
+      "S  \n"
+      "  E\n";
+    maze_t *maze = maze_from_string(maze_str);
+    printf("bordered: %d\n",maze->bordered);
+    for(int i=-1; i<=maze->rows; i++){
+      for(int j=-1; j<=maze->cols; j++){
+        printf("%d ",maze->tiles[i][j].type);
+      }
+      printf("\n");
+    }
+    maze_print_tiles(maze);
+    maze_bfs_iterate(maze);
+    maze_print_state(maze);
+    maze_free(maze);
+  } // ENDTEST
+
+  IF_TEST("maze_write_distances1") {
+    // Write the distance field of a maze to a file then map the file
+    // and look up distances. Small distances are stored as 16-bit
+    // values; unreachable tiles read back as -1.
+    char *maze_str =
+      "#######\n"
+      "#S  # #\n"
+      "# # # #\n"
+      "#   #E#\n"
+      "#######\n";
+    maze_t *maze = maze_from_string(maze_str);
+    long reached = maze_write_distances(maze, "test-dist1.tmp");
+    printf("reached: %ld\n",reached);
+    distmap_t *map = distmap_open("test-dist1.tmp");
+    printf("magic: %s rows: %d cols: %d elem_size: %d start: (%d,%d)\n",
+           map->header->magic, map->header->rows, map->header->cols,
+           map->header->elem_size, map->header->start_row, map->header->start_col);
+    printf("file bytes: %zu\n", map->map_len);
+    for(int i=0; i<maze->rows; i++){
+      for(int j=0; j<maze->cols; j++){
+        printf("%3d",distmap_get(map,i,j));
+      }
+      printf("\n");
+    }
+    printf("out of bounds: %d\n", distmap_get(map,-1,3));
+    distmap_close(map);
+    remove("test-dist1.tmp");
+    printf("missing file: %p\n", distmap_open("test-dist1.tmp"));
+    maze_free(maze);
+  } // ENDTEST
+
+  IF_TEST("maze_compute_masks1") {
+    // Compute per-tile open neighbor masks and print the 4-way bits
+    // for each open tile: corridor tiles have 2 bits set and dead
+    // ends 1. A BFS using the masks finds the same paths as one that
+    // probes every neighbor.
+    char *maze_str =
+      "#########\n"
+      "#S    # #\n"
+      "# ### # #\n"
+      "#   #   #\n"
+      "### ###E#\n"
+      "#########\n";
+    maze_t *maze = maze_from_string(maze_str);
+    maze_compute_masks(maze);
+    printf("masks_ready: %d\n",maze->masks_ready);
+    for(int i=0; i<maze->rows; i++){
+      for(int j=0; j<maze->cols; j++){
+        tile_t *tile = &maze->tiles[i][j];
+        if(tile->type == WALL){ printf(" ##"); }
+        else{ printf(" %2x", tile->open_mask & OPEN_MASK_4WAY); }
+      }
+      printf("\n");
+    }
+    LOG_LEVEL = LOG_BFS_PATHS;
+    maze_bfs_iterate(maze);
+    maze_print_state(maze);
+    maze_free(maze);
+  } // ENDTEST
+
+  IF_TEST("maze_from_file_parallel1") {
+    // Load a maze file with several threads which each classify a
+    // chunk of rows. The tiles and START/END found must match those
+    // loaded by maze_from_file(), including the last of several END
+    // tiles. Rows with a bad character or longer than the maze are
+    // reported as malformed by both loaders.
+    FILE *fout = fopen("test-load1.tmp","w");
+    fprintf(fout,
+            "rows: 7 cols: 9\n"
+            "tiles:\n"
+            "#########\n"
+            "#S  #  E#\n"
+            "# # # # #\n"
+            "# #   # #\n"
+            "# ##### #\n"
+            "#      E#\n"
+            "#########\n");
+    fclose(fout);
+    maze_t *seq = maze_from_file("test-load1.tmp");
+    maze_t *par = maze_from_file_parallel("test-load1.tmp", 3);
+    int same = 1;
+    for(int i=0; i<seq->rows; i++){
+      for(int j=0; j<seq->cols; j++){
+        same = same && seq->tiles[i][j].type == par->tiles[i][j].type &&
+          seq->tiles[i][j].open_mask == par->tiles[i][j].open_mask;
+      }
+    }
+    printf("same tiles: %d\n", same);
+    // Masks set row by row while loading, with chunks of any number
+    // of rows, match those computed over the whole maze afterwards
+    maze_t *ref = maze_from_file("test-load1.tmp");
+    maze_compute_masks(ref);
+    int masks_match = seq->masks_ready && par->masks_ready;
+    for(int nthreads=1; nthreads<=7; nthreads++){
+      maze_t *chunked = maze_from_file_parallel("test-load1.tmp", nthreads);
+      for(int i=0; i<ref->rows; i++){
+        for(int j=0; j<ref->cols; j++){
+          masks_match = masks_match &&
+            chunked->tiles[i][j].open_mask == ref->tiles[i][j].open_mask &&
+            seq->tiles[i][j].open_mask == ref->tiles[i][j].open_mask;
+        }
+      }
+      maze_free(chunked);
+    }
+    printf("masks match: %d\n", masks_match);
+    maze_free(ref);
+    printf("start: (%d,%d) count %ld\n",par->start_row,par->start_col,par->start_count);
+    printf("end: (%d,%d) count %ld\n",par->end_row,par->end_col,par->end_count);
+    maze_print_tiles(par);
+    maze_free(seq);
+    maze_free(par);
+
+    fout = fopen("test-load1.tmp","w");
+    fprintf(fout,
+            "rows: 4 cols: 5\n"
+            "tiles:\n"
+            "#####\n"
+            "#S E#\n"
+            "#x  #\n"
+            "#####\n");
+    fclose(fout);
+    par = maze_from_file_parallel("test-load1.tmp", 2);
+    seq = maze_from_file("test-load1.tmp");
+    printf("bad character: parallel %p sequential %p\n", par, seq);
+
+    fout = fopen("test-load1.tmp","w");
+    fprintf(fout,
+            "rows: 4 cols: 5\n"
+            "tiles:\n"
+            "#####\n"
+            "#S E#\n"
+            "#   ##\n"
+            "#####\n");
+    fclose(fout);
+    par = maze_from_file_parallel("test-load1.tmp", 2);
+    seq = maze_from_file("test-load1.tmp");
+    printf("long row: parallel %p sequential %p\n", par, seq);
+    remove("test-load1.tmp");
+  } // ENDTEST
+
+  IF_TEST("maze_fill_dead_ends1") {
+    // Fill the dead-end corridors of a maze. The bent corridor at the
+    // lower left is filled back to its junction one tile at a time as
+    // is the spur at the bottom, while the two routes through the top
+    // form a loop and remain. The BFS then finds the shortest path on
+    // the smaller maze and a second pass has nothing left to fill.
+    char *maze_str =
+      "###########\n"
+      "#S    #   #\n"
+      "# ### # # #\n"
+      "#   #   # #\n"
+      "### ##### #\n"
+      "#   #     #\n"
+      "# # # ### #\n"
+      "# #     #E#\n"
+      "###########\n";
+    maze_t *maze = maze_from_string(maze_str);
+    maze_compute_masks(maze);
+    long filled = maze_fill_dead_ends(maze, NULL);
+    printf("filled: %ld\n", filled);
+    maze_print_tiles(maze);
+    maze_bfs_iterate(maze);
+    maze_set_solution(maze);
+    tile_print_path(&maze->tiles[maze->end_row][maze->end_col], PATH_FORMAT_COMPACT);
+    printf("\n");
+    printf("filled again: %ld\n", maze_fill_dead_ends(maze, NULL));
+    maze_free(maze);
+  } // ENDTEST
+
+  IF_TEST("maze_restore_dead_ends1") {
+    // Reopen the tiles filled as dead ends after solving so that the
+    // solved maze prints with its corridors as they were read and
+    // only the path marked.
+    char *maze_str =
+      "###########\n"
+      "#S    #   #\n"
+      "# ### # # #\n"
+      "#   #   # #\n"
+      "### ##### #\n"
+      "#   #     #\n"
+      "# # # ### #\n"
+      "# #     #E#\n"
+      "###########\n";
+    maze_t *maze = maze_from_string(maze_str);
+    int *filled = NULL;
+    long count = maze_fill_dead_ends(maze, &filled);
+    printf("filled: %ld\n", count);
+    printf("first filled: (%d,%d)\n", filled[0], filled[1]);
+    maze_bfs_iterate(maze);
+    maze_set_solution(maze);
+    maze_restore_dead_ends(maze, filled, count);
+    free(filled);
+    maze_print_tiles(maze);
+    maze_free(maze);
+  } // ENDTEST
+
+  IF_TEST("mazegraph_from_maze1") {
+    // Contract the corridors of a maze into a graph of junctions, dead
+    // ends, and the START/END tiles. Each edge is printed with its
+    // length and direction runs. Dijkstra on the graph finds a path
+    // of the same length as BFS which maze_set_solution() can follow.
+    char *maze_str =
+      "#########\n"
+      "#S      #\n"
+      "# ##### #\n"
+      "#   #   #\n"
+      "### # ###\n"
+      "#     #E#\n"
+      "# ### # #\n"
+      "#       #\n"
+      "#########\n";
+    maze_t *maze = maze_from_string(maze_str);
+    mazegraph_t *graph = mazegraph_from_maze(maze);
+    printf("nodes: %d edges: %d runs: %d\n",
+           graph->node_count, graph->edge_count, graph->run_count);
+    for(int n=0; n<graph->node_count; n++){
+      graphnode_t *node = &graph->nodes[n];
+      printf("node %d (%d,%d):", n, node->row, node->col);
+      for(int e=node->first_edge; e<node->first_edge+node->edge_count; e++){
+        graphedge_t *edge = &graph->edges[e];
+        printf(" ->%d len %ld ", edge->target, edge->length);
+        for(int r=edge->first_run; r<edge->first_run+edge->run_count; r++){
+          printf("%s%d", direction_compact_strs[graph->runs[r].dir], graph->runs[r].count);
+        }
+      }
+      printf("\n");
+    }
+    printf("found: %d\n", maze_solve_graph(maze, graph));
+    tile_t *end_tile = &maze->tiles[maze->end_row][maze->end_col];
+    printf("path_len: %ld\n", end_tile->path_len);
+    tile_print_path(end_tile, PATH_FORMAT_COMPACT);
+    printf("\n");
+    maze_set_solution(maze);
+    maze_print_tiles(maze);
+    long len;
+    direction_t *path = mazegraph_shortest_path(graph, 3, 2, 1, 1, &len);
+    printf("not a node: %p %ld\n", path, len);
+    mazegraph_free(graph);
+    maze_free(maze);
+  } // ENDTEST
+
+  IF_TEST("mazehpa_build1") {
+    // Divide a maze into 4x4 clusters and find the entrances between
+    // them. The abstraction is written to a file and read back, then
+    // used to find a path from S to E which is refined cluster by
+    // cluster; here it is as short as the BFS path.
+    char *maze_str =
+      "############\n"
+      "#S     #   #\n"
+      "# ###### # #\n"
+      "#      # # #\n"
+      "###### # # #\n"
+      "#        # #\n"
+      "# ######## #\n"
+      "#         E#\n"
+      "############\n";
+    maze_t *maze = maze_from_string(maze_str);
+    mazehpa_t *built = mazehpa_build(maze, 4);
+    printf("clusters: %d x %d\n", built->cluster_rows, built->cluster_cols);
+    printf("written: %d\n", mazehpa_write(built, "test-hpa1.tmp"));
+    mazehpa_t *hpa = mazehpa_read("test-hpa1.tmp", maze);
+    remove("test-hpa1.tmp");
+    printf("nodes: %d edges: %d\n", hpa->node_count, hpa->edge_count);
+    for(int c=0; c<hpa->cluster_rows*hpa->cluster_cols; c++){
+      printf("cluster %d:", c);
+      for(int n=hpa->cluster_first[c]; n<hpa->cluster_first[c+1]; n++){
+        printf(" (%d,%d)", hpa->nodes[n].row, hpa->nodes[n].col);
+      }
+      printf("\n");
+    }
+    printf("found: %d\n", maze_solve_hpa(maze, hpa));
+    tile_t *end_tile = &maze->tiles[maze->end_row][maze->end_col];
+    printf("path_len: %ld\n", end_tile->path_len);
+    tile_print_path(end_tile, PATH_FORMAT_COMPACT);
+    printf("\n");
+    maze_set_solution(maze);
+    maze_print_tiles(maze);
+    long len;
+    direction_t *path = mazehpa_find_path(maze, hpa, 1, 1, 0, 0, &len);
+    printf("blocked end: %p %ld\n", path, len);
+    mazehpa_free(built);
+    mazehpa_free(hpa);
+    maze_free(maze);
+  } // ENDTEST
+
+  IF_TEST("mazehpa_read1") {
+    // An abstraction file is only used for the maze it was built
+    // from: a maze of the same size with other walls, or a file
+    // whose edges lead outside the nodes, reads as NULL. Mazes with
+    // 8-way movement get no abstraction at all.
+    char *maze_str =
+      "##########\n"
+      "#S   #   #\n"
+      "# ## # # #\n"
+      "#  #   #E#\n"
+      "##########\n";
+    char *other_str =
+      "##########\n"
+      "#S       #\n"
+      "# ## # # #\n"
+      "#  # # #E#\n"
+      "##########\n";
+    maze_t *maze = maze_from_string(maze_str);
+    maze_t *other = maze_from_string(other_str);
+    mazehpa_t *built = mazehpa_build(maze, 4);
+    printf("written: %d\n", mazehpa_write(built, "test-hpa2.tmp"));
+    mazehpa_t *hpa = mazehpa_read("test-hpa2.tmp", maze);
+    printf("same maze: %d nodes\n", hpa != NULL ? hpa->node_count : -1);
+    mazehpa_free(hpa);
+    printf("other maze: %p\n", mazehpa_read("test-hpa2.tmp", other));
+    FILE *fout = fopen("test-hpa2.tmp", "r+b");
+    long offset = sizeof(hpafile_header_t) +
+      sizeof(int) * (built->cluster_rows * built->cluster_cols + 1) +
+      sizeof(graphnode_t) * built->node_count;
+    graphedge_t edge = built->edges[0];
+    edge.target = built->node_count;
+    fseek(fout, offset, SEEK_SET);
+    fwrite(&edge, sizeof(edge), 1, fout);
+    fclose(fout);
+    printf("bad edge target: %p\n", mazehpa_read("test-hpa2.tmp", maze));
+    remove("test-hpa2.tmp");
+    other->movement = MOVEMENT_8WAY;
+    printf("8-way: %p\n", mazehpa_build(other, 4));
+    mazehpa_free(built);
+    maze_free(maze);
+    maze_free(other);
+  } // ENDTEST
+
+  IF_TEST("mazehpa_read2") {
+    // A file whose transitions are longer than one move or join tiles
+    // that are not neighbors, or whose cluster size could overflow the
+    // cluster scratch space, reads as NULL. Lengths within clusters
+    // that do not match the maze pass the read but fail the query in
+    // refinement rather than writing past the path. Building with an
+    // oversized cluster uses HPA_CLUSTER_MAX.
+    char *maze_str =
+      "##########\n"
+      "#S   #   #\n"
+      "# ## # # #\n"
+      "#  #   #E#\n"
+      "##########\n";
+    maze_t *maze = maze_from_string(maze_str);
+    mazehpa_t *hpa = mazehpa_build(maze, 4);
+    long len;
+    direction_t *path = mazehpa_find_path(maze, hpa, 1, 1, 3, 8, &len);
+    printf("built: path length %ld\n", len);
+    free(path);
+    for(int t=0; t<4; t++){
+      mazehpa_t *bad = mazehpa_build(maze, 4);
+      for(int n=0; n<bad->node_count; n++){
+        graphnode_t *node = &bad->nodes[n];
+        for(int e=node->first_edge; e<node->first_edge + node->edge_count; e++){
+          graphnode_t *next = &bad->nodes[bad->edges[e].target];
+          int cross = (node->row / 4 != next->row / 4) || (node->col / 4 != next->col / 4);
+          if(t == 0 && cross){
+            bad->edges[e].length = 2;
+          }
+          if(t == 1 && cross){
+            bad->edges[e].target = (bad->edges[e].target + 1) % bad->node_count;
+          }
+          if(t == 2 && !cross){
+            bad->edges[e].length = 0;
+          }
+        }
+      }
+      if(t == 3){
+        bad->cluster_size = HPA_CLUSTER_MAX + 1;
+      }
+      mazehpa_write(bad, "test-hpa3.tmp");
+      mazehpa_free(bad);
+      char *names[4] = {"long transitions", "moved transitions",
+                        "short cluster edges", "oversized clusters"};
+      printf("%s:\n", names[t]);
+      bad = mazehpa_read("test-hpa3.tmp", maze);
+      printf("  read: %s\n", bad == NULL ? "NULL" : "ok");
+      if(bad != NULL){
+        path = mazehpa_find_path(maze, bad, 1, 1, 3, 8, &len);
+        printf("  path: %s length %ld solved: %d\n", path == NULL ? "NULL" : "found", len,
+               maze_solve_hpa(maze, bad));
+        free(path);
+        mazehpa_free(bad);
+      }
+    }
+    remove("test-hpa3.tmp");
+    mazehpa_t *big = mazehpa_build(maze, 1 << 20);
+    printf("cluster size: %d of at most %d\n", big->cluster_size, HPA_CLUSTER_MAX);
+    mazehpa_free(big);
+    mazehpa_free(hpa);
+    maze_free(maze);
+  } // ENDTEST
+
+  IF_TEST("maze_bfs_checkpoint1") {
+    // Pause a BFS after a few steps and save it to a checkpoint, then
+    // resume the search in a freshly loaded copy of the maze. Both
+    // copies are stepped to completion: every tile ends with the same
+    // path and the resumed state is printed.
+    char *maze_str =
+      "##########\n"
+      "#S   #   #\n"
+      "# ## # # #\n"
+      "#  #   #E#\n"
+      "##########\n";
+    maze_t *maze = maze_from_string(maze_str);
+    maze->pack_paths = 1;
+    maze_bfs_init(maze);
+    for(int i=0; i<6; i++){
+      maze_bfs_step(maze);
+    }
+    printf("written: %d\n", maze_bfs_checkpoint(maze, "test-ckpt1.tmp"));
+    while(maze->queue->count > 0){
+      maze_bfs_step(maze);
+    }
+    maze_t *resumed = maze_from_string(maze_str);
+    printf("resumed: %d\n", maze_bfs_resume(resumed, "test-ckpt1.tmp"));
+    printf("pack_paths: %d queue count: %ld\n", resumed->pack_paths, resumed->queue->count);
+    maze_print_state(resumed);
+    while(resumed->queue->count > 0){
+      maze_bfs_step(resumed);
+    }
+    int same = 1;
+    for(int i=0; i<maze->rows; i++){
+      for(int j=0; j<maze->cols; j++){
+        tile_t *a = &maze->tiles[i][j], *b = &resumed->tiles[i][j];
+        same = same && a->state == b->state && a->path_len == b->path_len;
+        for(int k=0; same && k<a->path_len; k++){
+          same = tile_path_dir(a,k) == tile_path_dir(b,k);
+        }
+      }
+    }
+    printf("same paths: %d\n", same);
+    tile_print_path(&resumed->tiles[resumed->end_row][resumed->end_col], PATH_FORMAT_COMPACT);
+    printf("\n");
+    maze_t *small = maze_from_string("###\n#S#\n###\n");
+    printf("wrong size: %d\n", maze_bfs_resume(small, "test-ckpt1.tmp"));
+    remove("test-ckpt1.tmp");
+    printf("missing: %d\n", maze_bfs_resume(small, "test-ckpt1.tmp"));
+    maze_free(small);
+    maze_free(resumed);
+    maze_free(maze);
+  } // ENDTEST
+
+  IF_TEST("maze_bfs_resume1") {
+    // Checkpoints that BFS could not have written are rejected and
+    // leave the maze as it was: moves forming a cycle, a move from
+    // outside the maze, a move from a tile that was not found, a
+    // queued tile outside the maze, an unknown movement, and a
+    // checkpoint of a maze with other walls.
+    char *maze_str =
+      "##########\n"
+      "#S   #   #\n"
+      "# ## # # #\n"
+      "#  #   #E#\n"
+      "##########\n";
+    char *other_str =
+      "##########\n"
+      "#S       #\n"
+      "# ## # # #\n"
+      "#  #   #E#\n"
+      "##########\n";
+    maze_t *maze = maze_from_string(maze_str);
+    maze_bfs_init(maze);
+    for(int i=0; i<4; i++){
+      maze_bfs_step(maze);
+    }
+    maze_bfs_checkpoint(maze, "test-ckpt2.tmp");
+    FILE *fin = fopen("test-ckpt2.tmp", "rb");
+    long hdr = sizeof(ckptfile_header_t), ntiles = (long)maze->rows * maze->cols;
+    long size = hdr + ntiles + sizeof(int) * 2 * maze->queue->count;
+    unsigned char *good = malloc(size), *bad = malloc(size);
+    printf("read: %d\n", fread(good, 1, size, fin) == (size_t)size);
+    fclose(fin);
+    maze_t *resumed = maze_from_string(maze_str);
+    maze_bfs_init(resumed);
+    int cols = maze->cols;
+    for(int c=0; c<6; c++){
+      memcpy(bad, good, size);
+      char *what = NULL;
+      if(c == 0){
+        what = "cycle";
+        bad[hdr + 1*cols + 2] = CKPT_TILE(FOUND, WEST);
+        bad[hdr + 1*cols + 3] = CKPT_TILE(FOUND, EAST);
+      } else if(c == 1){
+        what = "move from outside";
+        bad[hdr + 0*cols + 1] = CKPT_TILE(FOUND, SOUTH);
+      } else if(c == 2){
+        what = "move from a tile not found";
+        bad[hdr + 3*cols + 8] = CKPT_TILE(FOUND, SOUTH);
+      } else if(c == 3){
+        what = "queued tile outside";
+        int row = maze->rows;
+        memcpy(bad + hdr + ntiles, &row, sizeof(int));
+      } else if(c == 4){
+        what = "movement";
+        ((ckptfile_header_t *) bad)->movement = 7;
+      } else {
+        what = "other maze";
+      }
+      FILE *fout = fopen("test-ckpt2.tmp", "wb");
+      fwrite(bad, 1, size, fout);
+      fclose(fout);
+      maze_t *target = resumed;
+      if(c == 5){
+        target = maze_from_string(other_str);
+        maze_bfs_init(target);
+      }
+      printf("%s: %d", what, maze_bfs_resume(target, "test-ckpt2.tmp"));
+      printf(" queue count %ld\n", target->queue->count);
+      if(target != resumed){
+        maze_free(target);
+      }
+    }
+    memcpy(bad, good, size);
+    FILE *fout = fopen("test-ckpt2.tmp", "wb");
+    fwrite(bad, 1, size, fout);
+    fclose(fout);
+    printf("unchanged file: %d queue count %ld\n",
+           maze_bfs_resume(resumed, "test-ckpt2.tmp"), resumed->queue->count);
+    remove("test-ckpt2.tmp");
+    free(good);
+    free(bad);
+    maze_free(resumed);
+    maze_free(maze);
+  } // ENDTEST
+
+  IF_TEST("maze_bfs_advance1") {
+    // Interleave the searches of two mazes, advancing each by at most
+    // 4 BFS steps per call until both are finished. The results match
+    // maze_bfs_iterate(). A third search is cancelled part way, which
+    // clears its state so it can be searched again from scratch.
+    char *maze_str =
+      "#########\n"
+      "#S   #  #\n"
+      "# ## # ##\n"
+      "#  #   E#\n"
+      "#########\n";
+    maze_t *a = maze_from_string(maze_str);
+    maze_t *b = maze_from_string(maze_str);
+    b->movement = MOVEMENT_8WAY;
+    maze_bfs_init(a);
+    maze_bfs_init(b);
+    int a_done = 0, b_done = 0, calls = 0;
+    while(!a_done || !b_done){
+      if(!a_done){ a_done = maze_bfs_advance(a, 4, 0); calls++; }
+      if(!b_done){ b_done = maze_bfs_advance(b, 4, 0); calls++; }
+    }
+    printf("calls: %d\n", calls);
+    maze_t *whole = maze_from_string(maze_str);
+    maze_bfs_iterate(whole);
+    printf("4-way end path_len: %ld iterate: %ld\n",
+           a->tiles[a->end_row][a->end_col].path_len,
+           whole->tiles[whole->end_row][whole->end_col].path_len);
+    printf("8-way end path_len: %ld\n", b->tiles[b->end_row][b->end_col].path_len);
+    maze_print_state(a);
+
+    maze_t *c = maze_from_string(maze_str);
+    maze_bfs_init(c);
+    printf("done after 2 steps: %d\n", maze_bfs_advance(c, 2, 0));
+    maze_bfs_cancel(c);
+    printf("done after cancel: %d\n", maze_bfs_advance(c, 2, 0));
+    maze_print_state(c);
+    maze_bfs_init(c);
+    printf("done with time limit: %d\n", maze_bfs_advance(c, 0, 1000000));
+    printf("end path_len: %ld\n", c->tiles[c->end_row][c->end_col].path_len);
+    maze_free(a);
+    maze_free(b);
+    maze_free(c);
+    maze_free(whole);
+  } // ENDTEST
+
+  IF_TEST("mazesearch_solve1") {
+    // Answer several queries on one read-only grid. A pool of two
+    // search contexts hands out each at most once at a time and each
+    // context is reused by advancing its epoch rather than clearing
+    // it. Queries solved on 4 threads at once match the distances of
+    // a single BFS from the same start.
+    char *maze_str =
+      "##########\n"
+      "#S   #   #\n"
+      "# ## # # #\n"
+      "#  #   #E#\n"
+      "##########\n";
+    maze_t *maze = maze_from_string(maze_str);
+    mazegrid_t *grid = mazegrid_from_maze(maze, GRID_LAYOUT_BLOCKED);
+    mazepool_t *pool = mazepool_allocate(grid, 2);
+    mazesearch_t *a = mazepool_acquire(pool);
+    mazesearch_t *b = mazepool_acquire(pool);
+    printf("third acquire: %p\n", mazepool_acquire(pool));
+    long len = mazesearch_solve(a, grid, 1, 1, 3, 8);
+    printf("len %ld epoch %u expanded %ld path: ", len, a->epoch, a->expanded);
+    for(int k=0; k<len; k++){
+      printf("%s", direction_compact_strs[a->path[k]]);
+    }
+    printf("\n");
+    len = mazesearch_solve(a, grid, 3, 8, 1, 1);
+    printf("reverse len %ld epoch %u\n", len, a->epoch);
+    printf("to a wall: %ld\n", mazesearch_solve(b, grid, 1, 1, 0, 0));
+    printf("same tile: %ld\n", mazesearch_solve(b, grid, 2, 1, 2, 1));
+    mazepool_release(pool, a);
+    printf("reacquired: %d\n", mazepool_acquire(pool) == a);
+
+    int *dist = malloc(sizeof(int) * grid->ncells);
+    mazegrid_bfs(grid, 1, 1, dist);
+    mazequery_t queries[40];
+    for(int k=0; k<40; k++){
+      queries[k] = (mazequery_t){1, 1, 1 + k % 3, 1 + k % 8, 0};
+    }
+    mazepool_solve_all(grid, queries, 40, 4);
+    int match = 1;
+    for(int k=0; k<40; k++){
+      match = match && queries[k].length ==
+        dist[mazegrid_index(grid, queries[k].end_row, queries[k].end_col)];
+    }
+    printf("all match: %d\n", match);
+    free(dist);
+    mazepool_free(pool);
+    mazegrid_free(grid);
+    maze_free(maze);
+  } // ENDTEST
+
+  IF_TEST("mazerle_reach1") {
+    // Store a maze as runs of open tiles in each row and find the
+    // tiles reachable from the start with BFS over runs. The rooms on
+    // the right touch only diagonally so they are reached with 8-way
+    // but not 4-way movement; tile counts match a BFS over tiles.
+    char *maze_str =
+      "############\n"
+      "#S  # #    #\n"
+      "# #    #####\n"
+      "#  ##   E  #\n"
+      "######## ###\n"
+      "############\n";
+    maze_t *maze = maze_from_string(maze_str);
+    mazerle_t *rle = mazerle_from_maze(maze);
+    printf("rows %d cols %d runs %ld\n", rle->rows, rle->cols, rle->run_count);
+    for(int i=0; i<rle->rows; i++){
+      printf("row %d:", i);
+      for(long r=rle->row_first[i]; r<rle->row_first[i+1]; r++){
+        printf(" [%d,%d]", rle->runs[r].lo, rle->runs[r].hi);
+      }
+      printf("\n");
+    }
+    printf("run of (1,3): %ld  run of (2,2): %ld  run of (0,40): %ld\n",
+           mazerle_find_run(rle, 1, 3), mazerle_find_run(rle, 2, 2), mazerle_find_run(rle, 0, 40));
+
+    unsigned char *reached = malloc(rle->run_count);
+    for(int movement=MOVEMENT_4WAY; movement<=MOVEMENT_8WAY; movement++){
+      rle->movement = maze->movement = movement;
+      long tiles = mazerle_reach(rle, rle->start_row, rle->start_col, reached);
+      long end_run = mazerle_find_run(rle, rle->end_row, rle->end_col);
+      mazegrid_t *grid = mazegrid_from_maze(maze, GRID_LAYOUT_BLOCKED);
+      int *dist = malloc(sizeof(int) * grid->ncells);
+      mazegrid_bfs(grid, rle->start_row, rle->start_col, dist);
+      long bfs_tiles = 0;
+      for(long k=0; k<grid->ncells; k++){
+        bfs_tiles += dist[k] >= 0;
+      }
+      printf("%s: reached %ld tiles (bfs %ld) END reached %d\n",
+             movement == MOVEMENT_8WAY ? "8-way" : "4-way", tiles, bfs_tiles, reached[end_run]);
+      free(dist);
+      mazegrid_free(grid);
+    }
+    printf("from a wall: %ld\n", mazerle_reach(rle, 0, 0, reached));
+    free(reached);
+    mazerle_free(rle);
+    maze_free(maze);
+  } // ENDTEST
+
+  IF_TEST("mazerle_from_file1") {
+    // Read a maze file straight into runs as -reach does. The runs and
+    // start/end must match those made from maze_from_file() of the
+    // same file, including a short row that is open past its end.
+    // Files maze_from_file() rejects must be rejected with the same
+    // errors: negative and oversized dimensions, a row with a
+    // character that is not a tile and a row longer than the maze.
+    FILE *fout = fopen("test-rle1.tmp","w");
+    fprintf(fout,
+            "rows: 5 cols: 9\n"
+            "tiles:\n"
+            "#########\n"
+            "#S  #   #\n"
+            "# # #\n"
+            "#   # E #\n"
+            "#########\n");
+    fclose(fout);
+    mazerle_t *rle = mazerle_from_file("test-rle1.tmp");
+    maze_t *maze = maze_from_file("test-rle1.tmp");
+    mazerle_t *ref = mazerle_from_maze(maze);
+    int same = rle->rows == ref->rows && rle->cols == ref->cols &&
+      rle->run_count == ref->run_count;
+    for(int i=0; same && i<=rle->rows; i++){
+      same = rle->row_first[i] == ref->row_first[i];
+    }
+    for(long r=0; same && r<rle->run_count; r++){
+      same = rle->runs[r].lo == ref->runs[r].lo && rle->runs[r].hi == ref->runs[r].hi;
+    }
+    printf("runs %ld match maze_from_file: %d start (%d,%d) end (%d,%d)\n",
+           rle->run_count, same, rle->start_row, rle->start_col, rle->end_row, rle->end_col);
+    mazerle_free(ref);
+    mazerle_free(rle);
+    maze_free(maze);
+
+    char *bad_files[4] = {
+      "rows: -3 cols: 4\ntiles:\n####\n",
+      "rows: 3 cols: 2147483647\ntiles:\n####\n",
+      "rows: 3 cols: 4\ntiles:\n####\n#SxE\n####\n",
+      "rows: 3 cols: 4\ntiles:\n####\n#S E #\n####\n",
+    };
+    for(int f=0; f<4; f++){
+      fout = fopen("test-rle1.tmp","w");
+      fprintf(fout, "%s", bad_files[f]);
+      fclose(fout);
+      printf("bad file %d\n", f);
+      maze = maze_from_file("test-rle1.tmp");
+      rle = mazerle_from_file("test-rle1.tmp");
+      printf("  maze %s rle %s\n", maze == NULL ? "NULL" : "loaded", rle == NULL ? "NULL" : "loaded");
+      maze_free(maze);
+      mazerle_free(rle);
+    }
+    remove("test-rle1.tmp");
+  } // ENDTEST
+
+  IF_TEST("mazecache1") {
+    // Store solutions in a cache directory and look them up again by
+    // key. A miss leaves the maze unsolved while a hit puts the stored
+    // path in the END tile. Keys depend on the movement as well as
+    // the file bytes. Mazes with no solution are cached as such and
+    // the least recently used entry is evicted first.
+    FILE *fout = fopen("test-cache1-a.tmp","w");
+    fprintf(fout,
+            "rows: 5 cols: 9\n"
+            "tiles:\n"
+            "#########\n"
+            "#S  #   #\n"
+            "# # # # #\n"
+            "# #   #E#\n"
+            "#########\n");
+    fclose(fout);
+    fout = fopen("test-cache1-b.tmp","w");
+    fprintf(fout,
+            "rows: 3 cols: 6\n"
+            "tiles:\n"
+            "######\n"
+            "#S#E #\n"
+            "######\n");
+    fclose(fout);
+    mazecache_t *cache = mazecache_open("test-cache1.tmp", 0);
+    printf("max bytes: %ld\n", cache->max_bytes);
+
+    maze_t *maze = maze_from_file("test-cache1-a.tmp");
+    unsigned long key_a = mazecache_key("test-cache1-a.tmp", maze);
+    printf("first lookup: %d\n", mazecache_lookup(cache, key_a, maze));
+    maze_bfs_iterate(maze);
+    printf("stored: %d\n", mazecache_store(cache, key_a, maze, 1));
+    maze->movement = MOVEMENT_8WAY;
+    printf("8-way key differs: %d\n", mazecache_key("test-cache1-a.tmp", maze) != key_a);
+    printf("8-way lookup: %d\n", mazecache_lookup(cache, key_a, maze));
+    maze_free(maze);
+
+    maze = maze_from_file("test-cache1-a.tmp");
+    printf("second lookup: %d\n", mazecache_lookup(cache, key_a, maze));
+    tile_t *end_tile = &maze->tiles[maze->end_row][maze->end_col];
+    printf("path length %ld: ", end_tile->path_len);
+    tile_print_path(end_tile, PATH_FORMAT_RLE);
+    printf("\n");
+    maze_set_solution(maze);
+    maze_print_tiles(maze);
+    maze_free(maze);
+
+    maze = maze_from_file("test-cache1-b.tmp");
+    unsigned long key_b = mazecache_key("test-cache1-b.tmp", maze);
+    printf("no solution stored: %d\n", mazecache_store(cache, key_b, maze, 0));
+    printf("no solution lookup: %d\n", mazecache_lookup(cache, key_b, maze));
+
+    // Make entry a the least recently used and leave room for only b
+    char fname[256];
+    snprintf(fname, sizeof(fname), "test-cache1.tmp/%016lx.sol", key_a);
+    struct utimbuf times = {1, 1};
+    utime(fname, &times);
+    cache->max_bytes = sizeof(cachefile_header_t);
+    printf("evicted: %ld\n", mazecache_evict(cache));
+    printf("b after eviction: %d\n", mazecache_lookup(cache, key_b, maze));
+    maze_free(maze);
+    maze = maze_from_file("test-cache1-a.tmp");
+    printf("a after eviction: %d\n", mazecache_lookup(cache, key_a, maze));
+    maze_free(maze);
+
+    printf("this cache: %ld hits %ld misses\n", cache->hits, cache->misses);
+    long hits, misses;
+    mazecache_close(cache, &hits, &misses);
+    printf("totals: %ld hits %ld misses\n", hits, misses);
+    cache = mazecache_open("test-cache1.tmp", 0);
+    maze = maze_from_file("test-cache1-b.tmp");
+    mazecache_lookup(cache, key_b, maze);
+    mazecache_close(cache, &hits, &misses);
+    printf("totals after reopening: %ld hits %ld misses\n", hits, misses);
+    maze_free(maze);
+
+    snprintf(fname, sizeof(fname), "test-cache1.tmp/%016lx.sol", key_b);
+    remove(fname);
+    remove("test-cache1.tmp/stats");
+    rmdir("test-cache1.tmp");
+    remove("test-cache1-a.tmp");
+    remove("test-cache1-b.tmp");
+  } // ENDTEST
+
+  IF_TEST("mazecache_lookup1") {
+    // A cached path is followed with no checks once it is in the END
+    // tile, so lookups replay it from START first. Entries whose runs
+    // have valid directions and add up to the stored length but run
+    // into a wall, up through the border, or end away from END are
+    // misses that leave the END tile unsolved. The untouched entry is
+    // still a hit.
+    FILE *fout = fopen("test-cache3-a.tmp","w");
+    fprintf(fout,
+            "rows: 5 cols: 9\n"
+            "tiles:\n"
+            "#########\n"
+            "#S  #   #\n"
+            "# # # # #\n"
+            "# #   #E#\n"
+            "#########\n");
+    fclose(fout);
+    mazecache_t *cache = mazecache_open("test-cache3.tmp", 0);
+    maze_t *maze = maze_from_file("test-cache3-a.tmp");
+    unsigned long key = mazecache_key("test-cache3-a.tmp", maze);
+    maze_bfs_iterate(maze);
+    mazecache_store(cache, key, maze, 1);
+    maze_free(maze);
+
+    char fname[256];
+    snprintf(fname, sizeof(fname), "test-cache3.tmp/%016lx.sol", key);
+    cachefile_header_t header;
+    dirrun_t stored[6];
+    FILE *fin = fopen(fname, "rb");
+    fread(&header, sizeof(header), 1, fin);
+    fread(stored, sizeof(dirrun_t), header.run_count, fin);
+    fclose(fin);
+    dirrun_t tampered[4][6] = {
+      {{EAST, 12}},
+      {{NORTH, 12}},
+      {{SOUTH, 2}, {NORTH, 2}, {SOUTH, 2}, {NORTH, 2}, {SOUTH, 2}, {NORTH, 2}},
+      {{EAST, 2}, {SOUTH, 2}, {EAST, 2}, {NORTH, 2}, {EAST, 2}, {SOUTH, 2}},
+    };
+    long run_counts[4] = {1, 1, 6, 6};
+    char *names[4] = {"into a wall", "out the top", "away from END", "original"};
+    for(int t=0; t<4; t++){
+      header.run_count = run_counts[t];
+      fout = fopen(fname, "wb");
+      fwrite(&header, sizeof(header), 1, fout);
+      fwrite(tampered[t], sizeof(dirrun_t), run_counts[t], fout);
+      fclose(fout);
+      maze = maze_from_file("test-cache3-a.tmp");
+      int ret = mazecache_lookup(cache, key, maze);
+      printf("%-13s lookup %2d END state %d\n", names[t], ret,
+             maze->tiles[maze->end_row][maze->end_col].state);
+      maze_free(maze);
+    }
+    printf("stored runs match original: %d\n",
+           memcmp(stored, tampered[3], sizeof(dirrun_t) * 6) == 0);
+    mazecache_close(cache, NULL, NULL);
+    remove(fname);
+    remove("test-cache3.tmp/stats");
+    rmdir("test-cache3.tmp");
+    remove("test-cache3-a.tmp");
+  } // ENDTEST
+
+  IF_TEST("mazecache_close1") {
+    // Several runs closing the same cache at once each add their
+    // counts to the stats file; none of the updates are lost.
+    int nprocs = 4, closes = 50;
+    for(int p=0; p<nprocs; p++){
+      if(fork() == 0){
+        for(int k=0; k<closes; k++){
+          mazecache_t *cache = mazecache_open("test-cache2.tmp", 0);
+          cache->hits = 1;
+          cache->misses = 2;
+          mazecache_close(cache, NULL, NULL);
+        }
+        exit(0);
+      }
+    }
+    for(int p=0; p<nprocs; p++){
+      wait(NULL);
+    }
+    long hits, misses;
+    mazecache_close(mazecache_open("test-cache2.tmp", 0), &hits, &misses);
+    printf("totals: %ld hits %ld misses\n", hits, misses);
+    remove("test-cache2.tmp/stats");
+    rmdir("test-cache2.tmp");
+  } // ENDTEST
+
+  IF_TEST("mazegrid_msbfs1") {
+    // Find distances from many sources at once. The 70 sources span
+    // two batches and include a wall and a repeated tile; every
+    // distance must match a separate BFS from that source with 4-way
+    // movement on a row-major grid and 8-way on a blocked grid, as
+    // must the distances to END alone.
+    char *maze_str =
+      "############\n"
+      "#S   #     #\n"
+      "# ## # ### #\n"
+      "#  #   # # #\n"
+      "## ##### # #\n"
+      "#      #  E#\n"
+      "############\n";
+    maze_t *maze = maze_from_string(maze_str);
+    int count = 70;
+    int rows[70], cols[70];
+    for(int k=0; k<count; k++){
+      rows[k] = 1 + (k * 7) % 5;
+      cols[k] = 1 + (k * 3) % 10;
+    }
+    rows[5] = 0; cols[5] = 0;         // a wall
+    rows[9] = 1; cols[9] = 1;         // START, also source 0
+    for(int movement=MOVEMENT_4WAY; movement<=MOVEMENT_8WAY; movement++){
+      maze->movement = movement;
+      mazegrid_t *grid = mazegrid_from_maze(maze, movement == MOVEMENT_8WAY ?
+                                            GRID_LAYOUT_BLOCKED : GRID_LAYOUT_ROWMAJOR);
+      int *dist = malloc(sizeof(int) * count * grid->ncells);
+      int *single = malloc(sizeof(int) * grid->ncells);
+      int to_end[70];
+      long reached = mazegrid_msbfs(grid, count, rows, cols, dist);
+      mazegrid_msbfs_to(grid, count, rows, cols, maze->end_row, maze->end_col, to_end);
+      long single_reached = 0;
+      int match = 1;
+      long end_idx = mazegrid_index(grid, maze->end_row, maze->end_col);
+      for(int k=0; k<count; k++){
+        single_reached += mazegrid_bfs(grid, rows[k], cols[k], single);
+        for(long i=0; i<grid->ncells; i++){
+          match = match && dist[k * grid->ncells + i] == single[i];
+        }
+        match = match && to_end[k] == single[end_idx];
+      }
+      printf("%s: reached %ld (separate %ld) match %d\n",
+             movement == MOVEMENT_8WAY ? "8-way" : "4-way", reached, single_reached, match);
+      printf("  to END:");
+      for(int k=0; k<10; k++){
+        printf(" %d", to_end[k]);
+      }
+      printf("\n");
+      free(dist);
+      free(single);
+      mazegrid_free(grid);
+    }
+    maze_free(maze);
+  } // ENDTEST
+
+  IF_TEST("mazegrid_msbfs2") {
+    // Sources are searched bit-parallel only while their bounding box
+    // spans at most MSBFS_SPREAD rows plus cols; walls do not count
+    // towards the spread. Forcing either kernel must give the same
+    // distances.
+    char *maze_str =
+      "############\n"
+      "#S   #     #\n"
+      "# ## # ### #\n"
+      "#  #   # # #\n"
+      "## ##### # #\n"
+      "#      #  E#\n"
+      "############\n";
+    maze_t *maze = maze_from_string(maze_str);
+    mazegrid_t *grid = mazegrid_from_maze(maze, GRID_LAYOUT_ROWMAJOR);
+    int rows[4] = {1, 5, 0, 3};
+    int cols[4] = {1, 10, 11, 2};
+    printf("spread of 4 sources: %d\n", mazegrid_source_spread(grid, 4, rows, cols));
+    printf("spread of 2 sources: %d\n", mazegrid_source_spread(grid, 2, rows + 2, cols + 2));
+    printf("spread of the wall: %d\n", mazegrid_source_spread(grid, 1, rows + 2, cols + 2));
+    printf("default MSBFS_SPREAD: %d\n", MSBFS_SPREAD);
+    int *parallel = malloc(sizeof(int) * 4 * grid->ncells);
+    int *separate = malloc(sizeof(int) * 4 * grid->ncells);
+    MSBFS_SPREAD = INT_MAX;
+    long parallel_reached = mazegrid_msbfs(grid, 4, rows, cols, parallel);
+    MSBFS_SPREAD = 0;
+    long separate_reached = mazegrid_msbfs(grid, 4, rows, cols, separate);
+    MSBFS_SPREAD = MSBFS_SPREAD_DEFAULT;
+    int match = memcmp(parallel, separate, sizeof(int) * 4 * grid->ncells) == 0;
+    printf("reached %ld bit-parallel, %ld separate, match %d\n",
+           parallel_reached, separate_reached, match);
+    free(parallel);
+    free(separate);
+    mazegrid_free(grid);
+    maze_free(maze);
+  } // ENDTEST
+
+  IF_TEST("mazealt_build1") {
+    // Choose landmarks in a winding maze and use them as A* bounds.
+    // Every bound must be at most the true distance between the two
+    // tiles; landmarks read back from a file, mapped or not, give the
+    // same bounds. A* finds a path as long as BFS does with either
+    // heuristic but expands fewer tiles with landmarks.
+    char *maze_str =
+      "#############\n"
+      "#S          #\n"
+      "### # ##### #\n"
+      "#   #   #   #\n"
+      "# ##### # ###\n"
+      "#     # #   #\n"
+      "##### # ### #\n"
+      "#E    #     #\n"
+      "#############\n";
+    maze_t *maze = maze_from_string(maze_str);
+    mazealt_t *alt = mazealt_build(maze, 3);
+    printf("landmarks: %d elem_size: %d\n", alt->header->count, alt->header->elem_size);
+    for(int k=0; k<alt->header->count; k++){
+      printf("  (%d,%d)", alt->header->landmarks[2*k], alt->header->landmarks[2*k+1]);
+    }
+    printf("\n");
+    printf("dist from landmark 0 to START: %ld, to a wall: %ld\n",
+           mazealt_dist(alt, 0, 1, 1), mazealt_dist(alt, 0, 0, 0));
+
+    mazealt_write(alt, "test-alt1.tmp");
+    mazealt_t *mapped = mazealt_open("test-alt1.tmp", 1);
+    mazealt_t *loaded = mazealt_open("test-alt1.tmp", 0);
+    printf("key of this maze: %d\n", mapped->header->key == mazecache_maze_key(maze, 0));
+    maze->tiles[2][1].type = OPEN;
+    printf("key after opening a wall: %d\n", mapped->header->key == mazecache_maze_key(maze, 0));
+    maze->tiles[2][1].type = WALL;
+    mazegrid_t *grid = mazegrid_from_maze(maze, GRID_LAYOUT_ROWMAJOR);
+    int *dist = malloc(sizeof(int) * grid->ncells);
+    int admissible = 1, same = 1, exact = 0, pairs = 0;
+    for(int i=0; i<maze->rows; i++){
+      for(int j=0; j<maze->cols; j++){
+        if(maze_tile_blocked(maze, i, j)){
+          continue;
+        }
+        mazegrid_bfs(grid, i, j, dist);
+        for(int r=0; r<maze->rows; r++){
+          for(int c=0; c<maze->cols; c++){
+            int d = dist[mazegrid_index(grid, r, c)];
+            if(d < 0){
+              continue;
+            }
+            long bound = mazealt_bound(alt, i, j, r, c);
+            admissible = admissible && bound <= d;
+            same = same && bound == mazealt_bound(mapped, i, j, r, c) &&
+              bound == mazealt_bound(loaded, i, j, r, c);
+            exact += bound == d;
+            pairs++;
+          }
+        }
+      }
+    }
+    printf("admissible: %d same from file: %d exact for %d of %d pairs\n",
+           admissible, same, exact, pairs);
+
+    long len;
+    long plain, with_alt;
+    direction_t *path = maze_astar_path(maze, NULL, 1, 10, 7, 1, &len, &plain);
+    printf("manhattan: length %ld expanded %ld\n", len, plain);
+    free(path);
+    path = maze_astar_path(maze, mapped, 1, 10, 7, 1, &len, &with_alt);
+    printf("landmarks: length %ld expanded %ld fewer: %d\n", len, with_alt, with_alt < plain);
+    free(path);
+    mazegrid_bfs(grid, 1, 10, dist);
+    printf("bfs length: %d\n", dist[mazegrid_index(grid, 7, 1)]);
+
+    maze->movement = MOVEMENT_8WAY;
+    printf("solved 8-way with 4-way landmarks: %d\n", maze_solve_astar(maze, mapped, &with_alt));
+    maze_set_solution(maze);
+    maze_print_tiles(maze);
+    printf("wall path: %p\n", maze_astar_path(maze, alt, 0, 0, 7, 1, &len, NULL));
+    printf("not a landmark file: %p\n", mazealt_open("test_mazesolve_funcs.c", 1));
+    printf("missing file: %p\n", mazealt_open("test-alt1.tmp.missing", 1));
+    free(dist);
+    mazegrid_free(grid);
+    mazealt_free(alt);
+    mazealt_free(mapped);
+    mazealt_free(loaded);
+    maze_free(maze);
+    remove("test-alt1.tmp");
+  } // ENDTEST
+
+  IF_TEST("mazegrid_diameter1") {
+    // Find the diameter of a maze with open rooms and a separate
+    // region using few BFS passes. It must match the largest distance
+    // from a BFS at every tile reachable from START, with 4-way and
+    // 8-way movement, and the eccentricity of every such tile must lie
+    // within its bounds. Tiles of the separate region get no bounds
+    // and a wall start gives -1.
+    char *maze_str =
+      "############\n"
+      "#S   #     #\n"
+      "# ## # ### #\n"
+      "#      #   #\n"
+      "## ### #####\n"
+      "#    #  ## #\n"
+      "# E  #  #  #\n"
+      "############\n";
+    maze_t *maze = maze_from_string(maze_str);
+    for(int movement=MOVEMENT_4WAY; movement<=MOVEMENT_8WAY; movement++){
+      maze->movement = movement;
+      mazegrid_t *grid = mazegrid_from_maze(maze, GRID_LAYOUT_BLOCKED);
+      int *lo = malloc(sizeof(int) * grid->ncells);
+      int *hi = malloc(sizeof(int) * grid->ncells);
+      int *dist = malloc(sizeof(int) * grid->ncells);
+      int sweeps;
+      long diameter = mazegrid_diameter(grid, 1, 1, &sweeps, lo, hi);
+      mazegrid_bfs(grid, 1, 1, dist);
+      int *from_start = malloc(sizeof(int) * grid->ncells);
+      memcpy(from_start, dist, sizeof(int) * grid->ncells);
+      long expect = 0;
+      int bounded = 1, exact = 0, tiles = 0, unbounded = 1;
+      for(int i=0; i<maze->rows; i++){
+        for(int j=0; j<maze->cols; j++){
+          long idx = mazegrid_index(grid, i, j);
+          if(from_start[idx] < 0){
+            unbounded = unbounded && lo[idx] == -1 && hi[idx] == -1;
+            continue;
+          }
+          mazegrid_bfs(grid, i, j, dist);
+          int ecc = 0;
+          for(long k=0; k<grid->ncells; k++){
+            ecc = (dist[k] > ecc) ? dist[k] : ecc;
+          }
+          expect = (ecc > expect) ? ecc : expect;
+          bounded = bounded && lo[idx] <= ecc && ecc <= hi[idx];
+          exact += lo[idx] == hi[idx];
+          tiles++;
+        }
+      }
+      printf("%s: diameter %ld expect %ld\n",
+             movement == MOVEMENT_8WAY ? "8-way" : "4-way", diameter, expect);
+      printf("  bounded: %d exact for %d of %d tiles, fewer sweeps: %d, other region unbounded: %d\n",
+             bounded, exact, tiles, sweeps < tiles, unbounded);
+      printf("  without bounds: %ld\n", mazegrid_diameter(grid, 6, 2, &sweeps, NULL, NULL));
+      diameter = mazegrid_diameter(grid, 0, 0, &sweeps, lo, hi);
+      printf("  wall start: %ld sweeps %d\n", diameter, sweeps);
+      free(lo);
+      free(hi);
+      free(dist);
+      free(from_start);
+      mazegrid_free(grid);
+    }
+    maze_free(maze);
+  } // ENDTEST
+
+  IF_TEST("mazegrid_diameter2") {
+    // A start that is not open reaches nothing: the diameter is -1, no
+    // sweeps run, and every tile of caller arrays holding stale values
+    // gets -1 bounds, as the -diameter mode counts tiles from them. A
+    // maze without START has its start outside the grid.
+    char *maze_str =
+      "######\n"
+      "#   E#\n"
+      "# ## #\n"
+      "######\n";
+    maze_t *maze = maze_from_string(maze_str);
+    mazegrid_t *grid = mazegrid_from_maze(maze, GRID_LAYOUT_BLOCKED);
+    int *lo = malloc(sizeof(int) * grid->ncells);
+    int *hi = malloc(sizeof(int) * grid->ncells);
+    int starts[3][2] = {{maze->start_row, maze->start_col}, {0, 0}, {2, 2}};
+    for(int s=0; s<3; s++){
+      for(long k=0; k<grid->ncells; k++){
+        lo[k] = 7;
+        hi[k] = 9;
+      }
+      int sweeps = 99;
+      long diameter = mazegrid_diameter(grid, starts[s][0], starts[s][1], &sweeps, lo, hi);
+      int cleared = 1;
+      for(long k=0; k<grid->ncells; k++){
+        cleared = cleared && lo[k] == -1 && hi[k] == -1;
+      }
+      printf("start (%d,%d): diameter %ld sweeps %d all bounds -1: %d\n",
+             starts[s][0], starts[s][1], diameter, sweeps, cleared);
+    }
+    free(lo);
+    free(hi);
+    mazegrid_free(grid);
+    maze_free(maze);
+  } // ENDTEST
+
+  IF_TEST("mazecsr_from_maze1") {
+    // Number the open tiles of a maze in BFS and Hilbert order and
+    // list each tile's neighbors; the bottom right corner is only
+    // reached with 8-way movement. Every order and movement must give
+    // the same distances as a grid BFS and each neighbor must list the
+    // node back. Solving on the graph gives the path found by BFS on
+    // the maze.
+    char *maze_str =
+      "#########\n"
+      "#S  #   #\n"
+      "# # # # #\n"
+      "# #   # #\n"
+      "# ##### #\n"
+      "#   #  E#\n"
+      "######## \n";
+    maze_t *maze = maze_from_string(maze_str);
+    for(int movement=MOVEMENT_4WAY; movement<=MOVEMENT_8WAY; movement++){
+      maze->movement = movement;
+      mazegrid_t *grid = mazegrid_from_maze(maze, GRID_LAYOUT_ROWMAJOR);
+      int *grid_dist = malloc(sizeof(int) * grid->ncells);
+      mazegrid_bfs(grid, 1, 1, grid_dist);
+      for(int order=CSR_ORDER_BFS; order<=CSR_ORDER_HILBERT; order++){
+        mazecsr_t *csr = mazecsr_from_maze(maze, order);
+        printf("%s %s: nodes %d neighbor entries %d\n",
+               movement == MOVEMENT_8WAY ? "8-way" : "4-way",
+               order == CSR_ORDER_HILBERT ? "hilbert" : "bfs",
+               csr->node_count, csr->first[csr->node_count]);
+        for(int i=0; i<maze->rows; i++){
+          printf("  ");
+          for(int j=0; j<maze->cols; j++){
+            printf("%3d", mazecsr_node(csr, i, j));
+          }
+          printf("\n");
+        }
+        int *dist = malloc(sizeof(int) * csr->node_count);
+        int *parent = malloc(sizeof(int) * csr->node_count);
+        int reached = mazecsr_bfs(csr, mazecsr_node(csr, 1, 1), dist, parent);
+        int match = 1, symmetric = 1;
+        for(int n=0; n<csr->node_count; n++){
+          long idx = mazegrid_index(grid, csr->node_row[n], csr->node_col[n]);
+          match = match && dist[n] == grid_dist[idx];
+          match = match && (dist[n] <= 0 || dist[parent[n]] == dist[n] - 1);
+          for(int e=csr->first[n]; e<csr->first[n+1]; e++){
+            int back = 0;
+            int m = csr->targets[e];
+            for(int f=csr->first[m]; f<csr->first[m+1]; f++){
+              back = back || csr->targets[f] == n;
+            }
+            symmetric = symmetric && back;
+          }
+        }
+        printf("  reached: %d match grid bfs: %d symmetric: %d\n", reached, match, symmetric);
+        long len = -1;
+        direction_t *path = mazecsr_shortest_path(csr, 1, 1, 5, 7, &len);
+        printf("  path:");
+        for(int k=0; k<len; k++){
+          printf(" %s", direction_compact_strs[path[k]]);
+        }
+        printf("\n");
+        free(path);
+        path = mazecsr_shortest_path(csr, 1, 1, 6, 8, &len);
+        printf("  corner found: %d", path != NULL);
+        free(path);
+        path = mazecsr_shortest_path(csr, 0, 0, 5, 7, &len);
+        printf(" wall found: %d\n", path != NULL);
+        free(dist);
+        free(parent);
+        mazecsr_free(csr);
+      }
+      free(grid_dist);
+      mazegrid_free(grid);
+    }
+
+    maze->movement = MOVEMENT_4WAY;
+    mazecsr_t *csr = mazecsr_from_maze(maze, CSR_ORDER_HILBERT);
+    printf("found: %d\n", maze_solve_csr(maze, csr));
+    tile_t *end_tile = &maze->tiles[maze->end_row][maze->end_col];
+    printf("path_len: %ld\n", end_tile->path_len);
+    tile_print_path(end_tile, PATH_FORMAT_COMPACT);
+    printf("\n");
+    maze_set_solution(maze);
+    maze_print_tiles(maze);
+    mazecsr_free(csr);
+    maze_free(maze);
+  } // ENDTEST
+
+  IF_TEST("mazegrid_count_paths1") {
+    // Count the shortest paths to every tile of a maze with an open
+    // room and list all of those to END with 4-way and 8-way movement.
+    // Each listed path must be distinct, as long as the distance to
+    // END, and as many as counted. In a large open maze the count
+    // saturates while paths are still listed one at a time.
+    char *maze_str =
+      "#########\n"
+      "#S      #\n"
+      "# ##### #\n"
+      "#       #\n"
+      "#  #    #\n"
+      "#     #E#\n"
+      "#########\n";
+    maze_t *maze = maze_from_string(maze_str);
+    for(int movement=MOVEMENT_4WAY; movement<=MOVEMENT_8WAY; movement++){
+      maze->movement = movement;
+      mazegrid_t *grid = mazegrid_from_maze(maze, GRID_LAYOUT_ROWMAJOR);
+      int *dist = malloc(sizeof(int) * grid->ncells);
+      unsigned long *counts = malloc(sizeof(unsigned long) * grid->ncells);
+      long reached = mazegrid_count_paths(grid, 1, 1, dist, counts);
+      printf("%s: reached %ld\n", movement == MOVEMENT_8WAY ? "8-way" : "4-way", reached);
+      for(int i=0; i<maze->rows; i++){
+        printf("  ");
+        for(int j=0; j<maze->cols; j++){
+          printf("%3lu", counts[mazegrid_index(grid, i, j)]);
+        }
+        printf("\n");
+      }
+      pathenum_t *pe = pathenum_start(grid, dist, maze->end_row, maze->end_col);
+      char seen[64][32];
+      int listed = 0, distinct = 1;
+      while(listed < 64 && pathenum_next(pe)){
+        for(int k=0; k<pe->len; k++){
+          strcpy(seen[listed] + k, direction_compact_strs[pe->path[k]]);
+        }
+        for(int p=0; p<listed; p++){
+          distinct = distinct && strcmp(seen[p], seen[listed]) != 0;
+        }
+        printf("  %s\n", seen[listed++]);
+      }
+      printf("  listed %d of %lu distinct: %d length %ld\n", listed,
+             counts[mazegrid_index(grid, maze->end_row, maze->end_col)], distinct, pe->len);
+      pathenum_free(pe);
+      printf("  to a wall: %p\n", pathenum_start(grid, dist, 0, 0));
+      free(dist);
+      free(counts);
+      mazegrid_free(grid);
+    }
+    maze_free(maze);
+
+    mazegrid_t *grid = mazegrid_allocate(70, 70, GRID_LAYOUT_BLOCKED);
+    for(int i=0; i<70; i++){
+      for(int j=0; j<70; j++){
+        grid->cells[mazegrid_index(grid, i, j)] = GRID_OPEN;
+      }
+    }
+    int *dist = malloc(sizeof(int) * grid->ncells);
+    unsigned long *counts = malloc(sizeof(unsigned long) * grid->ncells);
+    mazegrid_count_paths(grid, 0, 0, dist, counts);
+    printf("open 70x70: to (30,30) %lu saturated %d, to (69,69) saturated %d\n",
+           counts[mazegrid_index(grid, 30, 30)],
+           counts[mazegrid_index(grid, 30, 30)] == PATHS_SATURATED,
+           counts[mazegrid_index(grid, 69, 69)] == PATHS_SATURATED);
+    pathenum_t *pe = pathenum_start(grid, dist, 69, 69);
+    for(int p=0; p<2 && pathenum_next(pe); p++){
+      printf("  path %d: length %ld ", p, pe->len);
+      for(int k=0; k<pe->len; k++){
+        printf("%s", direction_compact_strs[pe->path[k]]);
+      }
+      printf("\n");
+    }
+    pathenum_free(pe);
+    free(dist);
+    free(counts);
+    mazegrid_free(grid);
+  } // ENDTEST
+
+  IF_TEST("maze_allocate_lazy1") {
+    // Lazily allocated mazes start with every visible tile all zero:
+    // type NOTSET, state UNKNOWN, no path, and path_len 0, inside a
+    // border of WALL tiles. Small mazes are calloc()'d and large ones
+    // mmap()'d. Setting only the tile types is enough for a search,
+    // which treats UNKNOWN tiles as not found; NOTSET tiles are not
+    // blocked so the large maze is open apart from a wall with a gap.
+    maze_t *maze = maze_allocate_lazy(2, 3);
+    printf("alloc: %d bordered: %d start: (%d,%d) end: (%d,%d)\n", maze->alloc, maze->bordered,
+           maze->start_row, maze->start_col, maze->end_row, maze->end_col);
+    for(int i=-1; i<=maze->rows; i++){
+      for(int j=-1; j<=maze->cols; j++){
+        tile_t *tile = &maze->tiles[i][j];
+        printf("%d/%d/%ld/%d ", tile->type, tile->state, tile->path_len,
+               tile->path == NULL && tile->packed == NULL);
+      }
+      printf("\n");
+    }
+    maze_free(maze);
+
+    maze = maze_allocate_lazy(300, 400);
+    printf("alloc: %d\n", maze->alloc);
+    for(int i=0; i<maze->rows; i++){
+      maze->tiles[i][200].type = (i == 150) ? OPEN : WALL;
+    }
+    maze->tiles[9][300].type = maze->tiles[11][300].type = WALL;
+    maze->tiles[10][299].type = maze->tiles[10][301].type = WALL;
+    maze->tiles[0][0].type = START;
+    maze->tiles[299][399].type = END;
+    maze->start_row = maze->start_col = 0;
+    maze->end_row = 299;
+    maze->end_col = 399;
+    maze_bfs_iterate(maze);
+    tile_t *end_tile = &maze->tiles[maze->end_row][maze->end_col];
+    printf("state: %d path_len: %ld enclosed state: %d\n",
+           end_tile->state, end_tile->path_len, maze->tiles[10][300].state);
+    maze_free(maze);
+
+    // A search inside a walled room only gives paths to its tiles, so
+    // maze_free() only looks for paths within the room
+    maze = maze_allocate_lazy(300, 400);
+    for(int i=100; i<=104; i++){
+      for(int j=50; j<=54; j++){
+        int wall = (i == 100 || i == 104 || j == 50 || j == 54);
+        maze->tiles[i][j].type = wall ? WALL : OPEN;
+      }
+    }
+    maze->start_row = 101;
+    maze->start_col = 51;
+    maze->end_row = 103;
+    maze->end_col = 53;
+    maze->tiles[101][51].type = START;
+    maze_bfs_iterate(maze);
+    printf("paths in rows %d-%d cols %d-%d\n", maze->path_top, maze->path_bottom,
+           maze->path_left, maze->path_right);
+    maze_free(maze);
+  } // ENDTEST
+
+  IF_TEST("maze_bfs_cancel2") {
+    // Cancelling a search of an mmap()'d maze only resets the tiles in
+    // the box of tiles with paths, which is then empty, so a search
+    // inside a walled room never reads the rest of the mapping. The
+    // room can be searched again afterwards.
+    maze_t *maze = maze_allocate_lazy(300, 400);
+    for(int i=100; i<=104; i++){
+      for(int j=50; j<=54; j++){
+        int wall = (i == 100 || i == 104 || j == 50 || j == 54);
+        maze->tiles[i][j].type = wall ? WALL : OPEN;
+      }
+    }
+    maze->start_row = 101;
+    maze->start_col = 51;
+    maze->end_row = 103;
+    maze->end_col = 53;
+    maze->tiles[101][51].type = START;
+    maze_bfs_init(maze);
+    maze_bfs_advance(maze, 3, 0);
+    printf("alloc: %d paths in rows %d-%d cols %d-%d\n", maze->alloc, maze->path_top,
+           maze->path_bottom, maze->path_left, maze->path_right);
+    maze_bfs_cancel(maze);
+    printf("after cancel: rows %d-%d cols %d-%d start state %d path_len %ld\n",
+           maze->path_top, maze->path_bottom, maze->path_left, maze->path_right,
+           maze->tiles[101][51].state, maze->tiles[101][51].path_len);
+    maze_bfs_iterate(maze);
+    printf("end path_len: %ld\n", maze->tiles[103][53].path_len);
+    maze_free(maze);
+  } // ENDTEST
+
+  IF_TEST("maze_astar_fits1") {
+    // A* and the junction graph number tiles and nodes with ints, so
+    // a lazily allocated maze of more than INT_MAX tiles is refused
+    // rather than searched: landmarks and the graph are NULL and the
+    // A* solve returns -1 so callers search with BFS instead. A maze
+    // just under the limit fits.
+    maze_t *maze = maze_allocate_lazy(46340, 46340);
+    printf("%d x %d fits: %d\n", maze->rows, maze->cols, maze_astar_fits(maze));
+    maze_free(maze);
+    maze = maze_allocate_lazy(46341, 46341);
+    maze->tiles[1][1].type = START;
+    maze->tiles[1][5].type = END;
+    maze->start_row = maze->end_row = 1;
+    maze->start_col = 1;
+    maze->end_col = 5;
+    long len, expanded = 99;
+    printf("%d x %d fits: %d\n", maze->rows, maze->cols, maze_astar_fits(maze));
+    printf("landmarks: %p\n", (void *)mazealt_build(maze, 4));
+    printf("graph: %p\n", (void *)mazegraph_from_maze(maze));
+    direction_t *path = maze_astar_path(maze, NULL, 1, 1, 1, 5, &len, NULL);
+    printf("path: %p len %ld\n", (void *)path, len);
+    int solved = maze_solve_astar(maze, NULL, &expanded);
+    printf("solve: %d expanded %ld end state %d\n", solved, expanded, maze->tiles[1][5].state);
+    maze_free(maze);
+  } // ENDTEST
+
+  IF_TEST("maze_from_file_wide1") {
+    // Load a maze with rows far wider than a fixed line buffer: a
+    // corridor along the top leads to the END at the far right. Both
+    // loaders must read the whole row. Negative dimensions and RLE
+    // runs too long for a dirrun_t are rejected.
+    int cols = 3000;
+    FILE *fout = fopen("test-wide1.tmp","w");
+    fprintf(fout, "rows: 3 cols: %d\ntiles:\n", cols);
+    for(int i=0; i<3; i++){
+      for(int j=0; j<cols; j++){
+        fputc((i == 1 && j == 1) ? 'S' : (i == 1 && j == cols-2) ? 'E' :
+              (i == 1 && j > 0 && j < cols-1) ? ' ' : '#', fout);
+      }
+      fputc('\n', fout);
+    }
+    fclose(fout);
+    maze_t *seq = maze_from_file("test-wide1.tmp");
+    maze_t *par = maze_from_file_parallel("test-wide1.tmp", 2);
+    printf("start: (%d,%d) end: (%d,%d)\n",seq->start_row,seq->start_col,seq->end_row,seq->end_col);
+    printf("parallel end: (%d,%d)\n",par->end_row,par->end_col);
+    maze_bfs_iterate(seq);
+    tile_t *end_tile = &seq->tiles[seq->end_row][seq->end_col];
+    printf("path_len: %ld\n", end_tile->path_len);
+    maze_free(seq);
+    maze_free(par);
+
+    fout = fopen("test-wide1.tmp","w");
+    fprintf(fout, "rows: -3 cols: 5\ntiles:\n");
+    fclose(fout);
+    printf("negative rows: %p\n", maze_from_file("test-wide1.tmp"));
+    remove("test-wide1.tmp");
+
+    printf("overlong run: %p\n", rlepath_parse("N4294967296"));
+  } // ENDTEST
+
+  IF_TEST("maze_bfs_prefetch1") {
+    // Prefetching tiles ahead in the queue only changes timing: BFS
+    // of an open room, whose frontier holds many more entries than
+    // the prefetch distance, must find the same paths with it off, at
+    // the default distance, and looking further ahead than the queue
+    // ever holds.
+    int distances[3] = {0, BFS_PREFETCH_DISTANCE, 1000};
+    for(int p=0; p<3; p++){
+      BFS_PREFETCH = distances[p];
+      maze_t *maze = maze_allocate(30, 40);
+      for(int i=0; i<maze->rows; i++){
+        for(int j=0; j<maze->cols; j++){
+          maze->tiles[i][j].type = ((i % 6 == 3) && (j % 8 != 4)) ? WALL : OPEN;
+        }
+      }
+      maze->start_row = maze->start_col = 0;
+      maze->end_row = 29;
+      maze->end_col = 39;
+      maze->tiles[0][0].type = START;
+      maze->tiles[29][39].type = END;
+      maze_bfs_iterate(maze);
+      tile_t *end_tile = &maze->tiles[maze->end_row][maze->end_col];
+      printf("prefetch %4d: path ", BFS_PREFETCH);
+      tile_print_path(end_tile, PATH_FORMAT_RLE);
+      printf("\n");
+      maze_free(maze);
+    }
+    BFS_PREFETCH = BFS_PREFETCH_DISTANCE;
+  } // ENDTEST
+
+  IF_TEST("rcqueue_set_lead1") {
+    // The ahead node must stay `lead` places behind the front as nodes
+    // are added and removed, be NULL while there are no more than lead
+    // nodes, and be found by walking when the lead is set on a queue
+    // that already holds nodes or changes.
+    rcqueue_t *queue = rcqueue_allocate();
+    rcqueue_set_lead(queue, 2);
+    for(int i=0; i<5; i++){
+      rcqueue_add_rear(queue, i, 10*i);
+      printf("add    count %ld ahead ", queue->count);
+      if(queue->ahead == NULL){ printf("NULL\n"); }
+      else{ printf("(%d,%d)\n", queue->ahead->row, queue->ahead->col); }
+    }
+    rcqueue_set_lead(queue, 3);
+    printf("lead 3 ahead (%d,%d)\n", queue->ahead->row, queue->ahead->col);
+    rcqueue_set_lead(queue, 1);
+    printf("lead 1 ahead (%d,%d)\n", queue->ahead->row, queue->ahead->col);
+    rcqueue_add_rear(queue, 5, 50);
+    for(int i=0; i<6; i++){
+      rcqueue_remove_front(queue);
+      printf("remove count %ld ahead ", queue->count);
+      if(queue->ahead == NULL){ printf("NULL\n"); }
+      else{ printf("(%d,%d)\n", queue->ahead->row, queue->ahead->col); }
+    }
+    rcqueue_add_rear(queue, 6, 60);
+    rcqueue_add_rear(queue, 7, 70);
+    printf("refill ahead (%d,%d)\n", queue->ahead->row, queue->ahead->col);
+    rcqueue_set_lead(queue, 0);
+    printf("lead 0 ahead %s\n", queue->ahead == NULL ? "NULL" : "set");
+    rcqueue_free(queue);
+  } // ENDTEST
+
   ////////////////////////////////////////////////////////////////////////////////
   // END MATTER
   ////////////////////////////////////////////////////////////////////////////////